@@ -16,30 +16,12 @@
 /** Set the device name, max length is 10 characters */
 char g_ble_dev_name[10] = "RAK-GNSS";
 
-/** Timer since last position message was sent */
-time_t last_pos_send = 0;
-/** Timer for delayed sending to keep duty cycle */
-SoftwareTimer delayed_sending;
-
-/** Battery level uinion */
-batt_s batt_level;
-
-/** Flag if delayed sending is already activated */
-bool delayed_active = false;
-
-/** Minimum delay between sending new locations, set to 45 seconds */
-time_t min_delay = 45000;
-
 // Forward declaration
-void send_delayed(TimerHandle_t unused);
 void at_settings(void);
 
 /** Send Fail counter **/
 uint8_t send_fail = 0;
 
-/** Flag for low battery protection */
-bool low_batt_protection = false;
-
 /** Initialization result */
 bool init_result = true;
 
@@ -49,6 +31,25 @@ bool g_gps_prec_6 = true;
 /** Switch between Cayenne LPP and Helium Mapper data packet */
 bool g_is_helium = false;
 
+/** Switch between Cayenne LPP and compact data packet */
+bool g_is_compact = false;
+
+/** Keyframe interval of the delta mode, 0 = delta mode off */
+uint8_t g_delta_interval = 0;
+
+/** Number of locations sent in one batch frame, 0 = batch mode off */
+uint8_t g_batch_size = 0;
+
+/** Tolerance of the track simplification in m, 0 = off */
+uint16_t g_simplify_tolerance = 0;
+
+/** Airtime budget in ms per rolling window, 0 = no budget */
+uint32_t g_airtime_budget = 0;
+/** Length of the rolling airtime window in minutes */
+uint16_t g_airtime_window = 60;
+/** Flag if the used airtime is added to the payload */
+bool g_airtime_payload = false;
+
 /** Flag if GNSS module was found */
 bool gnss_ok = true;
 /** Flag if ACC module was found */
@@ -61,6 +62,35 @@ bool battery_check_enabled = false;
 /** Packet buffer */
 WisCayenne g_data_packet(255);
 
+/** Maximum number of received bytes in the debug log */
+#define LOG_HEX_MAX 64
+
+#if STATIC_MEM > 0
+/** Heap in use at the end of init_app(), the application does not allocate after that */
+static int heap_after_init = 0;
+/** Heap in use at the last check */
+static int heap_last_check = 0;
+
+/**
+ * @brief Check that the heap did not grow since init_app().
+ *        Allocations by the libraries are reported, not blocked.
+ *
+ */
+static void heap_check(void)
+{
+	int heap_used = dbgHeapUsed();
+	if (heap_used == heap_last_check)
+	{
+		return;
+	}
+	heap_last_check = heap_used;
+	if (heap_used > heap_after_init)
+	{
+		AT_PRINTF("+EVT:HEAP %d bytes allocated after init\n", heap_used - heap_after_init);
+	}
+}
+#endif
+
 /**
  * @brief Application specific setup functions
  *
@@ -116,6 +146,15 @@ bool init_app(void)
 	// Get precision settings
 	read_gps_settings();
 
+	// Get the unsent locations from flash
+	init_fix_queue();
+
+	// Get the geofence index from flash
+	init_geofence();
+
+	// One timer for all deadlines
+	init_sched();
+
 	AT_PRINTF("============================\n");
 	if (g_is_helium)
 	{
@@ -134,12 +173,20 @@ bool init_app(void)
 	// Add User AT commands
 	init_user_at();
 
+	// Start the energy accounting before the first power state changes
+	init_energy();
+
 	pinMode(WB_IO2, OUTPUT);
 	digitalWrite(WB_IO2, HIGH);
+	energy_on(ENERGY_GNSS);
 
-	// Start the I2C bus
-	Wire.begin();
-	Wire.setClock(400000);
+	// Start the I2C bus, it is shared by the GNSS task and the app loop
+	init_i2c_bus();
+
+#if TRACE_SIZE > 0
+	// Start the cycle counter of the latency trace
+	init_trace();
+#endif
 
 	// Initialize GNSS module
 	gnss_ok = init_gnss();
@@ -148,39 +195,23 @@ bool init_app(void)
 	if (!g_lorawan_settings.lorawan_enable)
 	{
 		// Prepare GNSS task
-		// Create the GNSS event semaphore
-		g_gnss_sem = xSemaphoreCreateBinary();
-		// Initialize semaphore
-		xSemaphoreGive(g_gnss_sem);
-		// Take semaphore
-		xSemaphoreTake(g_gnss_sem, 10);
-		if (!xTaskCreate(gnss_task, "LORA", 4096, NULL, TASK_PRIO_LOW, &gnss_task_handle))
-		{
-			MYLOG("APP", "Failed to start GNSS task");
-		}
-		last_pos_send = millis();
+		start_gnss_task();
 		g_lpwan_has_joined = true;
+		cycle_start();
 	}
 
 	// Initialize ACC sensor
 	acc_ok = init_acc();
+	if (acc_ok)
+	{
+		energy_on(ENERGY_ACC);
+	}
 
 	// Initialize Environment sensor
 	has_env_sensor = init_bme();
 
-	if (g_lorawan_settings.send_repeat_time != 0)
-	{
-		// Set delay for sending to 1/2 of scheduled sending
-		min_delay = g_lorawan_settings.send_repeat_time / 2;
-	}
-	else
-	{
-		// Send repeat time is 0, set delay to 30 seconds
-		min_delay = 30000;
-	}
-
-	// Set delayed sending to 1/2 of programmed send interval or 30 seconds
-	delayed_sending.begin(min_delay, send_delayed, NULL, false);
+	// Minimum delay between two locations
+	init_cycle();
 
 	AT_PRINTF("============================\n");
 	AT_PRINTF("GNSS Precision:\n");
@@ -201,10 +232,48 @@ bool init_app(void)
 	{
 		AT_PRINTF("   Helium Mapper data format\n");
 	}
+	else if (g_is_compact)
+	{
+		AT_PRINTF("   Compact data format\n");
+		if (g_delta_interval != 0)
+		{
+			AT_PRINTF("   Delta locations, keyframe every %d\n", g_delta_interval);
+		}
+		if (g_batch_size != 0)
+		{
+			AT_PRINTF("   Batch of %d locations\n", g_batch_size);
+			if (g_simplify_tolerance != 0)
+			{
+				AT_PRINTF("   Track simplification %d m\n", g_simplify_tolerance);
+			}
+		}
+	}
 	else
 	{
 		AT_PRINTF("   Cayenne LPP data format\n");
 	}
+	if (g_is_helium && (g_mapper_res != 0))
+	{
+		AT_PRINTF("   Mapped cells resolution %d, %d min\n", g_mapper_res, g_mapper_window);
+	}
+	if (g_cache_max_age != 0)
+	{
+		AT_PRINTF("   Cached location up to %d min\n", g_cache_max_age);
+	}
+	if (g_filter_distance != 0)
+	{
+		AT_PRINTF("   Distance filter %d m, max %d min\n", g_filter_distance, g_filter_time);
+	}
+	if (g_adapt_settings.steps_num != 0)
+	{
+		char adapt_buf[128];
+		adapt_status(adapt_buf, sizeof(adapt_buf));
+		AT_PRINTF("   Adaptive interval %s\n", adapt_buf);
+	}
+	if (g_airtime_budget != 0)
+	{
+		AT_PRINTF("   Airtime budget %ld ms in %d min\n", (long)g_airtime_budget, g_airtime_window);
+	}
 	if (g_submit_acc)
 	{
 		AT_PRINTF("   Add ACC values to payload\n");
@@ -242,6 +311,12 @@ bool init_app(void)
 	}
 
 	g_data_packet.reset();
+	g_tracker_data.valid = 0;
+
+#if STATIC_MEM > 0
+	heap_after_init = dbgHeapUsed();
+	heap_last_check = heap_after_init;
+#endif
 
 	return init_result;
 }
@@ -253,12 +328,28 @@ bool init_app(void)
  */
 void app_event_handler(void)
 {
+	TRACE(TRACE_LOOP_WAKE);
+	energy_sample();
+
+	// Scheduler deadlines, due jobs can set the STATUS event
+	if (app_event_take(SCHED_DUE))
+	{
+		sched_run();
+	}
+
 	// Timer triggered event
-	if ((g_task_event_type & STATUS) == STATUS)
+	if (app_event_take(STATUS))
 	{
-		g_task_event_type &= N_STATUS;
 		MYLOG("APP", "Timer wakeup");
 
+		// Take over the periodic send if the WisBlock API restarted its timer
+		sched_send_check();
+
+#if STATIC_MEM > 0
+		heap_check();
+#endif
+		mem_sample();
+
 		// Initialization failed, report error over AT interface */
 		if (!init_result)
 		{
@@ -272,215 +363,23 @@ void app_event_handler(void)
 			restart_advertising(15);
 		}
 
-		if (!low_batt_protection)
-		{
-			if (init_result)
-			{
-				if (has_env_sensor)
-				{
-					// Wake up the temperature sensor and start measurements
-					start_bme();
-				}
-			}
-			if (gnss_option != NO_GNSS_INIT)
-			{
-				// Start the GNSS location tracking
-				xSemaphoreGive(g_gnss_sem);
-			}
-		}
-
-		// Get battery level
-		batt_level.batt16 = read_batt() / 10;
-		if (!g_is_helium)
-		{
-			g_data_packet.addVoltage(LPP_CHANNEL_BATT, read_batt() / 1000);
-		}
-
-		// Protection against battery drain if battery check is enabled
-		if (battery_check_enabled)
-		{
-			if (batt_level.batt16 < 290)
-			{
-				// Battery is very low, change send time to 1 hour to protect battery
-				low_batt_protection = true;			   // Set low_batt_protection active
-				api_timer_restart(1 * 60 * 60 * 1000); // Set send time to one hour
-				MYLOG("APP", "Battery protection activated");
-			}
-			else if ((batt_level.batt16 > 410) && low_batt_protection)
-			{
-				// Battery is higher than 4V, change send time back to original setting
-				low_batt_protection = false;
-				api_timer_restart(g_lorawan_settings.send_repeat_time); // Set send time to original setting
-				MYLOG("APP", "Battery protection deactivated");
-			}
-}
-		if (!g_is_helium)
-		{
-			if (low_batt_protection || (gnss_option == NO_GNSS_INIT))
-			{
-				if (g_lorawan_settings.lorawan_enable)
-				{
-					// Send only the battery level over LoRaWAN
-					lmh_error_status result = send_lora_packet(g_data_packet.getBuffer(), g_data_packet.getSize());
-					switch (result)
-					{
-					case LMH_SUCCESS:
-						MYLOG("APP", "Packet enqueued");
-						break;
-					case LMH_BUSY:
-						AT_PRINTF("+EVT:BUSY\n");
-						MYLOG("APP", "LoRa transceiver is busy");
-						break;
-					case LMH_ERROR:
-						AT_PRINTF("+EVT:SIZE_ERROR\n");
-						MYLOG("APP", "Packet error, too big to send with current DR");
-						break;
-					}
-				}
-				else
-				{
-					// Send only the battery level over LoRa
-					if (send_p2p_packet(g_data_packet.getBuffer(), g_data_packet.getSize()))
-					{
-						MYLOG("APP", "Packet enqueued");
-					}
-					else
-					{
-						MYLOG("APP", "Packet enqueued");
-					}
-				}
-				g_data_packet.reset();
-			}
-		}
+		// Battery level and the stages of the sensor acquisition
+		cycle_status();
 	}
 
 	// ACC trigger event
-	if ((g_task_event_type & ACC_TRIGGER) == ACC_TRIGGER && g_lpwan_has_joined)
+	if (g_lpwan_has_joined && app_event_take(ACC_TRIGGER))
 	{
-		g_task_event_type &= N_ACC_TRIGGER;
 		MYLOG("APP", "ACC triggered");
 		read_acc();
 		clear_acc_int();
-
-		// Check time since last send
-		bool send_now = true;
-		if (g_lorawan_settings.send_repeat_time != 0)
-		{
-			if ((millis() - last_pos_send) < min_delay)
-			{
-				send_now = false;
-				if (!delayed_active)
-				{
-					delayed_sending.stop();
-					MYLOG("APP", "Expired time %d", (int)(millis() - last_pos_send));
-					MYLOG("APP", "Max delay time %d", (int)min_delay);
-					time_t wait_time = abs(min_delay - (millis() - last_pos_send) >= 0) ? (min_delay - (millis() - last_pos_send)) : min_delay;
-					MYLOG("APP", "Wait time %ld", (long)wait_time);
-
-					MYLOG("APP", "Only %lds since last position message, send delayed in %lds", (long)((millis() - last_pos_send) / 1000), (long)(wait_time / 1000));
-					delayed_sending.setPeriod(wait_time);
-					delayed_sending.start();
-					delayed_active = true;
-				}
-			}
-		}
-		if (send_now)
-		{
-			// Remember last send time
-			last_pos_send = millis();
-
-			// Trigger a GNSS reading and packet sending
-			g_task_event_type |= STATUS;
-		}
-
-		// Reset the standard timer
-		if (g_lorawan_settings.send_repeat_time != 0)
-		{
-			api_timer_restart(g_lorawan_settings.send_repeat_time);
-		}
+		cycle_motion();
 	}
 
 	// GNSS location search finished
-	if ((g_task_event_type & GNSS_FIN) == GNSS_FIN)
+	if (app_event_take(GNSS_FIN))
 	{
-		g_task_event_type &= N_GNSS_FIN;
-
-		// Get Environment data
-		read_bme();
-
-		// Remember last time sending
-		last_pos_send = millis();
-		// Just in case
-		delayed_active = false;
-
-#if MY_DEBUG == 1
-		uint8_t *packet_buff = g_data_packet.getBuffer();
-		for (int idx = 0; idx < g_data_packet.getSize(); idx++)
-		{
-			Serial.printf("%02X", packet_buff[idx]);
-		}
-		Serial.println("");
-		Serial.printf("Packetsize %d\n", g_data_packet.getSize());
-#endif
-
-		if (g_lorawan_settings.lorawan_enable)
-		{
-			// Check payload size
-			if (g_lorawan_settings.lora_region == 8)
-			{
-				if (g_lorawan_settings.data_rate == 0)
-				{
-					AT_PRINTF("+EVT:DR_ERROR\n");
-					return;
-				}
-			}
-
-			// Send packet over LoRaWAN
-			lmh_error_status result;
-			result = send_lora_packet(g_data_packet.getBuffer(), g_data_packet.getSize());
-			switch (result)
-			{
-			case LMH_SUCCESS:
-				MYLOG("APP", "Packet enqueued");
-				break;
-			case LMH_BUSY:
-				AT_PRINTF("+EVT:BUSY\n");
-				MYLOG("APP", "LoRa transceiver is busy");
-				break;
-			case LMH_ERROR:
-				result = send_lora_packet(g_data_packet.getBuffer(), g_data_packet.getSize());
-				switch (result)
-				{
-				case LMH_SUCCESS:
-					MYLOG("APP", "Packet enqueued");
-					break;
-				case LMH_BUSY:
-					AT_PRINTF("+EVT:BUSY\n");
-					MYLOG("APP", "LoRa transceiver is busy");
-					break;
-				case LMH_ERROR:
-					AT_PRINTF("+EVT:SIZE_ERROR RETRY\n");
-					result = send_lora_packet(g_data_packet.getBuffer(), g_data_packet.getSize());
-					AT_PRINTF("+EVT:SIZE_ERROR\n");
-					MYLOG("APP", "Packet error, too big to send with current DR");
-				}
-				break;
-			}
-		}
-		else
-		{
-			// Send packet over LoRa
-			if (send_p2p_packet(g_data_packet.getBuffer(), g_data_packet.getSize()))
-			{
-				MYLOG("APP", "Packet enqueued");
-			}
-			else
-			{
-				AT_PRINTF("+EVT:SIZE_ERROR\n");
-				MYLOG("APP", "Packet too big");
-			}
-		}
-		g_data_packet.reset();
+		cycle_location();
 	}
 }
 
@@ -493,11 +392,10 @@ void ble_data_handler(void)
 	if (g_enable_ble)
 	{
 		// BLE UART data handling
-		if ((g_task_event_type & BLE_DATA) == BLE_DATA)
+		if (app_event_take(BLE_DATA))
 		{
 			MYLOG("AT", "RECEIVED BLE");
 			/** BLE UART data arrived */
-			g_task_event_type &= N_BLE_DATA;
 
 			while (g_ble_uart.available() > 0)
 			{
@@ -516,26 +414,16 @@ void ble_data_handler(void)
 void lora_data_handler(void)
 {
 	// LoRa Join finished handling
-	if ((g_task_event_type & LORA_JOIN_FIN) == LORA_JOIN_FIN)
+	if (app_event_take(LORA_JOIN_FIN))
 	{
-		g_task_event_type &= N_LORA_JOIN_FIN;
 		if (g_join_result)
 		{
 			MYLOG("APP", "Successfully joined network");
 			AT_PRINTF("+EVT:JOINED\n");
 
 			// Prepare GNSS task
-			// Create the GNSS event semaphore
-			g_gnss_sem = xSemaphoreCreateBinary();
-			// Initialize semaphore
-			xSemaphoreGive(g_gnss_sem);
-			// Take semaphore
-			xSemaphoreTake(g_gnss_sem, 10);
-			if (!xTaskCreate(gnss_task, "LORA", 4096, NULL, TASK_PRIO_LOW, &gnss_task_handle))
-			{
-				MYLOG("APP", "Failed to start GNSS task");
-			}
-			last_pos_send = millis();
+			start_gnss_task();
+			cycle_start();
 		}
 		else
 		{
@@ -547,10 +435,9 @@ void lora_data_handler(void)
 	}
 
 	// LoRa TX finished handling
-	if ((g_task_event_type & LORA_TX_FIN) == LORA_TX_FIN)
+	if (app_event_take(LORA_TX_FIN))
 	{
-		g_task_event_type &= N_LORA_TX_FIN;
-
+		TRACE(TRACE_LORA_TX_FIN);
 		MYLOG("APP", "LPWAN TX cycle %s", g_rx_fin_result ? "finished ACK" : "failed NAK");
 
 		if ((g_lorawan_settings.confirmed_msg_enabled) && (g_lorawan_settings.lorawan_enable))
@@ -562,6 +449,9 @@ void lora_data_handler(void)
 			AT_PRINTF("+EVT:SEND OK\n");
 		}
 
+		// Radio time and the sent locations
+		cycle_tx_finished(g_rx_fin_result);
+
 		if (!g_rx_fin_result)
 		{
 			// Increase fail send counter
@@ -570,6 +460,8 @@ void lora_data_handler(void)
 			if (send_fail == 10)
 			{
 				// Too many failed sendings, reset node and try to rejoin
+				// Save the queued locations first
+				fq_commit();
 				delay(100);
 				sd_nvic_SystemReset();
 			}
@@ -577,7 +469,7 @@ void lora_data_handler(void)
 	}
 
 	// LoRa data handling
-	if ((g_task_event_type & LORA_DATA) == LORA_DATA)
+	if (app_event_take(LORA_DATA))
 	{
 		/**************************************************************/
 		/**************************************************************/
@@ -585,11 +477,12 @@ void lora_data_handler(void)
 		/// \todo parse them here
 		/**************************************************************/
 		/**************************************************************/
-		g_task_event_type &= N_LORA_DATA;
 		MYLOG("APP", "Received package over LoRa");
 
 		if (g_lorawan_settings.lorawan_enable)
 		{
+			// A downlink acknowledges the last uplink
+			pack_acked();
 			AT_PRINTF("+EVT:RX_1, RSSI %d, SNR %d\n", g_last_rssi, g_last_snr);
 			AT_PRINTF("+EVT:%d:", g_last_fport);
 			for (int idx = 0; idx < g_rx_data_len; idx++)
@@ -609,26 +502,17 @@ void lora_data_handler(void)
 			AT_PRINTF("\n");
 		}
 
-		char log_buff[g_rx_data_len * 3] = {0};
-		uint8_t log_idx = 0;
-		for (int idx = 0; idx < g_rx_data_len; idx++)
+#if MY_DEBUG > 0
+		// Fixed size buffer, only the first bytes are logged
+		char log_buff[LOG_HEX_MAX * 3 + 1] = {0};
+		uint16_t log_idx = 0;
+		for (int idx = 0; (idx < g_rx_data_len) && (idx < LOG_HEX_MAX); idx++)
 		{
 			sprintf(&log_buff[log_idx], "%02X ", g_rx_lora_data[idx]);
 			log_idx += 3;
 		}
 
 		MYLOG("APP", "%s", log_buff);
+#endif
 	}
 }
-
-/**
- * @brief Timer function used to avoid sending packages too often.
- * 			Delays the next package by 10 seconds
- *
- * @param unused
- * 			Timer handle, not used
- */
-void send_delayed(TimerHandle_t unused)
-{
-	api_wake_loop(STATUS);
-}
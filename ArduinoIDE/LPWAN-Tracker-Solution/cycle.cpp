@@ -0,0 +1,443 @@
+/**
+ * @file cycle.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Send cycle of the app loop: the sensor stages of a timer wakeup,
+ *        the ACC trigger, the end of the location search, the send decision
+ *        and the uplink. The hardware is accessed only through the sensor,
+ *        GNSS and LoRa functions, the file is built into tools/battery_sim as well.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Time in ms (sched_now()) when the last position message was sent */
+uint64_t last_pos_send = 0;
+
+/** Battery level uinion */
+batt_s batt_level;
+
+/** Minimum delay between sending new locations, set to 45 seconds */
+uint32_t min_delay = 45000;
+
+/** Flag for low battery protection */
+bool low_batt_protection = false;
+
+/** Size of the LoRa P2P packet in progress, its time-on-air is accounted when the TX is finished */
+static uint8_t p2p_tx_size = 0;
+
+/**
+ * @brief Set the minimum delay between two locations from the send interval
+ *
+ */
+void init_cycle(void)
+{
+	if (g_lorawan_settings.send_repeat_time != 0)
+	{
+		// Set delay for sending to 1/2 of scheduled sending
+		min_delay = g_lorawan_settings.send_repeat_time / 2;
+	}
+	else
+	{
+		// Send repeat time is 0, set delay to 30 seconds
+		min_delay = 30000;
+	}
+}
+
+/**
+ * @brief Start the periodic send after the join or in LoRa P2P mode
+ *
+ */
+void cycle_start(void)
+{
+	last_pos_send = sched_now();
+	// Periodic send is handled by the scheduler
+	sched_send_restart(adapt_interval());
+}
+
+/**
+ * @brief Timer wakeup, read the battery and start the stages of the sensor acquisition
+ *
+ */
+void cycle_status(void)
+{
+	// Get battery level
+	float batt_mv = read_batt();
+	batt_level.batt16 = batt_mv / 10;
+	if (!g_is_helium)
+	{
+		g_tracker_data.battery = batt_mv / 1000;
+		g_tracker_data.valid |= 1 << PAYLOAD_BATTERY;
+	}
+
+	// Protection against battery drain if battery check is enabled
+	if (battery_check_enabled)
+	{
+		if (batt_level.batt16 < 290)
+		{
+			// Battery is very low, change send time to 1 hour to protect battery
+			low_batt_protection = true;			   // Set low_batt_protection active
+			sched_send_restart(1 * 60 * 60 * 1000); // Set send time to one hour
+			MYLOG("APP", "Battery protection activated");
+		}
+		else if ((batt_level.batt16 > 410) && low_batt_protection)
+		{
+			// Battery is higher than 4V, change send time back to original setting
+			low_batt_protection = false;
+			sched_send_restart(adapt_interval()); // Set send time to original setting
+			MYLOG("APP", "Battery protection deactivated");
+		}
+	}
+
+	// Location search of this cycle
+	bool locate = !low_batt_protection && (gnss_option != NO_GNSS_INIT);
+	if (locate && gnss_skip_search())
+	{
+		// Tracker did not move, save the location search
+		MYLOG("APP", "Location search skipped");
+		locate = false;
+	}
+
+	// Stages of the sensor acquisition, the uplink is sent when all are finished.
+	// Without a location the Helium Mapper has nothing to send.
+	bool cycle = locate || !g_is_helium;
+	uint8_t stages = (1 << PIPE_BATT);
+	if (cycle && !low_batt_protection)
+	{
+		if (init_result)
+		{
+			// Wake up the temperature sensor and start measurements
+			if (has_env_sensor && start_bme())
+			{
+				stages |= (1 << PIPE_ENV);
+			}
+		}
+		if (acc_ok && g_submit_acc)
+		{
+			stages |= (1 << PIPE_ACC);
+		}
+	}
+	if (!locate)
+	{
+		if (cycle)
+		{
+			// Send the sensor values without a location, only the battery level in battery protection
+			pipe_start(stages, 0);
+		}
+	}
+	else if (gnss_cached_fix(&g_tracker_data))
+	{
+		// No movement since the last location, send it again without a location search
+		pipe_start(stages | (1 << PIPE_GNSS), 0);
+		app_event_set(GNSS_FIN);
+	}
+	else
+	{
+		// Start the GNSS location tracking
+		pipe_start(stages | (1 << PIPE_GNSS), gnss_search_time());
+		gnss_start_search();
+	}
+
+	if (cycle)
+	{
+		pipe_done(PIPE_BATT);
+	}
+
+	// Get the acceleration values
+	if ((stages & (1 << PIPE_ACC)) != 0)
+	{
+		read_acc();
+		pipe_done(PIPE_ACC);
+	}
+}
+
+/**
+ * @brief ACC trigger, send a location now or after the minimum delay
+ *
+ */
+void cycle_motion(void)
+{
+	adapt_motion();
+	gnss_motion();
+
+	// Check time since last send
+	bool send_now = true;
+	uint64_t now = sched_now();
+	if (g_lorawan_settings.send_repeat_time != 0)
+	{
+		if ((now - last_pos_send) < min_delay)
+		{
+			send_now = false;
+			uint64_t send_time = last_pos_send + min_delay;
+			if (sched_pending(SCHED_SEND) && (sched_deadline(SCHED_SEND) <= send_time))
+			{
+				// The periodic send comes first
+				MYLOG("APP", "Only %lds since last position message, periodic send in %lds", (long)((now - last_pos_send) / 1000), (long)((sched_deadline(SCHED_SEND) - now) / 1000));
+			}
+			else if (!sched_pending(SCHED_DELAYED))
+			{
+				MYLOG("APP", "Only %lds since last position message, send delayed in %lds", (long)((now - last_pos_send) / 1000), (long)((send_time - now) / 1000));
+				sched_arm(SCHED_DELAYED, send_time);
+			}
+		}
+	}
+	if (send_now)
+	{
+		// Remember last send time
+		last_pos_send = now;
+
+		// Send the last known location immediately, the new location follows after the search
+		if (!(g_is_compact && (g_batch_size != 0)) && gnss_motion_fix(&g_tracker_data))
+		{
+			AT_PRINTF("+EVT:MOTION_FIX\n");
+			send_packet();
+		}
+
+		// Trigger a GNSS reading and packet sending
+		app_event_set(STATUS);
+	}
+
+	// Reset the standard timer, it counts from the next location send
+	if ((g_lorawan_settings.send_repeat_time != 0) && !low_batt_protection)
+	{
+		if (send_now)
+		{
+			sched_send_restart(adapt_interval());
+		}
+		else if (sched_pending(SCHED_DELAYED))
+		{
+			sched_arm(SCHED_SEND, sched_deadline(SCHED_DELAYED) + adapt_interval());
+		}
+	}
+}
+
+/**
+ * @brief GNSS location search finished or skipped
+ *
+ */
+void cycle_location(void)
+{
+	// Get the location found by the GNSS task
+	gnss_take_fix(&g_tracker_data);
+
+	// Search finished or skipped
+	gnss_search_done();
+	pipe_done(PIPE_GNSS);
+}
+
+/**
+ * @brief All stages of the sensor acquisition are finished, send the location
+ *
+ */
+void send_location(void)
+{
+	// Remember last time sending
+	last_pos_send = sched_now();
+	// A delayed send is not needed anymore
+	sched_cancel(SCHED_DELAYED);
+
+	// Select the next send interval from speed, heading, ACC activity and home fences
+	uint32_t next_interval = geofence_interval(adapt_next(&g_tracker_data));
+	if ((next_interval != 0) && (g_lorawan_settings.send_repeat_time != 0) && !low_batt_protection)
+	{
+		sched_send_restart(next_interval);
+	}
+
+	// Entering or leaving a geofence is sent immediately
+	bool fence_event = geofence_event();
+	if (!fence_event && gnss_filter(&g_tracker_data))
+	{
+		// Location is too close to the last sent location
+		AT_PRINTF("+EVT:SUPPRESSED\n");
+		g_tracker_data.valid = 0;
+	}
+	// In batch mode the location is collected and sent when the batch is full
+	else if (!g_is_compact || (g_batch_size == 0) || batch_add(&g_tracker_data, fence_event))
+	{
+		send_packet();
+	}
+}
+
+/**
+ * @brief Send the collected values over LoRaWAN or LoRa P2P
+ *        In Helium Mapper mode g_data_packet is sent as it is.
+ *        Otherwise the packet is built by the packer to fit into the maximum payload size
+ *        of the current datarate. Fields that do not fit are sent with the next uplink.
+ *
+ */
+void send_packet(void)
+{
+	if (!g_is_helium)
+	{
+		if (g_airtime_payload && g_lorawan_settings.lorawan_enable)
+		{
+			g_tracker_data.airtime = airtime_used() / 1000.0;
+			g_tracker_data.valid |= (1 << PAYLOAD_AIRTIME);
+		}
+		if (g_mem_payload)
+		{
+			mem_payload(&g_tracker_data);
+		}
+		pack_collect();
+
+		// Limit the packet to the remaining airtime budget, fields that do not fit are deferred
+		uint8_t max_size = get_max_payload();
+		uint8_t budget_size = airtime_max_payload(max_size);
+		if ((budget_size == 0) || (pack_payload(budget_size) == 0))
+		{
+			if (budget_size < max_size)
+			{
+				// Airtime budget used up, keep the location for later
+				AT_PRINTF("+EVT:AIRTIME_DEFER\n");
+				MYLOG("APP", "Airtime budget used up, uplink deferred");
+				pack_sent(false);
+				return;
+			}
+			AT_PRINTF("+EVT:SIZE_ERROR\n");
+			MYLOG("APP", "Packet error, nothing fits with current DR");
+			pack_sent(false);
+			return;
+		}
+		if (budget_size < max_size)
+		{
+			AT_PRINTF("+EVT:AIRTIME_REDUCED %d\n", budget_size);
+			MYLOG("APP", "Packet limited to %d bytes by the airtime budget", budget_size);
+		}
+	}
+	else if (mapper_skip())
+	{
+		// Helium Mapper cell was mapped recently
+		AT_PRINTF("+EVT:CELL_MAPPED\n");
+		g_data_packet.reset();
+		return;
+	}
+	else if (g_data_packet.getSize() > airtime_max_payload(g_data_packet.getSize()))
+	{
+		// Helium Mapper packet can not be reduced
+		AT_PRINTF("+EVT:AIRTIME_DEFER\n");
+		MYLOG("APP", "Airtime budget used up, uplink skipped");
+		g_data_packet.reset();
+		return;
+	}
+
+	if (g_lorawan_settings.lorawan_enable && !g_lpwan_has_joined)
+	{
+		// Not joined, keep the location for later
+		if (!g_is_helium)
+		{
+			pack_sent(false);
+		}
+		g_data_packet.reset();
+		return;
+	}
+
+	// Helium Mapper packet is sent as it is
+	uint8_t *packet_buff = g_is_helium ? g_data_packet.getBuffer() : pack_buffer();
+	uint8_t packet_size = g_is_helium ? g_data_packet.getSize() : pack_size();
+
+#if MY_DEBUG == 1
+	for (int idx = 0; idx < packet_size; idx++)
+	{
+		Serial.printf("%02X", packet_buff[idx]);
+	}
+	Serial.println("");
+	Serial.printf("Packetsize %d\n", packet_size);
+#endif
+
+	if (g_lorawan_settings.lorawan_enable)
+	{
+		// Send packet over LoRaWAN
+		lmh_error_status result;
+		result = send_lora_packet(packet_buff, packet_size);
+		// Packet rejected as too big (e.g. pending MAC commands), pack it again with a lower limit
+		while ((result == LMH_ERROR) && !g_is_helium && (packet_size > 1))
+		{
+			AT_PRINTF("+EVT:SIZE_ERROR RETRY\n");
+			packet_size = pack_payload(packet_size - 1);
+			if (packet_size == 0)
+			{
+				break;
+			}
+			result = send_lora_packet(packet_buff, packet_size);
+		}
+		switch (result)
+		{
+		case LMH_SUCCESS:
+			TRACE(TRACE_LORA_SEND);
+			MYLOG("APP", "Packet enqueued");
+			airtime_add(packet_size);
+			energy_add(ENERGY_TX, airtime_toa(packet_size));
+			if (g_is_helium)
+			{
+				mapper_sent();
+			}
+			break;
+		case LMH_BUSY:
+			AT_PRINTF("+EVT:BUSY\n");
+			MYLOG("APP", "LoRa transceiver is busy");
+			break;
+		case LMH_ERROR:
+			AT_PRINTF("+EVT:SIZE_ERROR\n");
+			MYLOG("APP", "Packet error, too big to send with current DR");
+			break;
+		}
+		if (!g_is_helium)
+		{
+			// Unsent location goes into the store and forward queue
+			pack_sent(result == LMH_SUCCESS);
+		}
+	}
+	else
+	{
+		// Send packet over LoRa
+		bool result = send_p2p_packet(packet_buff, packet_size);
+		if (result)
+		{
+			MYLOG("APP", "Packet enqueued");
+			p2p_tx_size = packet_size;
+			if (g_is_helium)
+			{
+				mapper_sent();
+			}
+		}
+		else
+		{
+			AT_PRINTF("+EVT:SIZE_ERROR\n");
+			MYLOG("APP", "Packet too big");
+		}
+		if (!g_is_helium)
+		{
+			// Unsent location goes into the store and forward queue
+			pack_sent(result);
+		}
+	}
+	g_data_packet.reset();
+}
+
+/**
+ * @brief LoRa TX cycle finished, account the radio time and release or queue the sent locations
+ *
+ * @param success true if the uplink was sent (or ACK'd for confirmed uplinks)
+ */
+void cycle_tx_finished(bool success)
+{
+	if (g_lorawan_settings.lorawan_enable)
+	{
+		energy_add(ENERGY_RX, airtime_rx());
+	}
+	else if (p2p_tx_size != 0)
+	{
+		energy_add(ENERGY_TX, airtime_p2p_toa(p2p_tx_size));
+		p2p_tx_size = 0;
+	}
+
+	if (!g_is_helium)
+	{
+		// Release delivered queued locations or queue the location of a failed uplink
+		fq_tx_finished(success);
+		// Update the reference location of the delta mode
+		pack_tx_finished(success, g_lorawan_settings.confirmed_msg_enabled && g_lorawan_settings.lorawan_enable);
+	}
+}
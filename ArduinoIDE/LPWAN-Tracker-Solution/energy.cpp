@@ -0,0 +1,229 @@
+/**
+ * @file energy.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Energy accounting. The time spent in each power relevant state is added
+ *        up and multiplied with the current of the state to estimate the
+ *        consumption per day without a power analyser.
+ *        The CPU active time is taken from the DWT cycle counter, which stops
+ *        while the CPU sleeps. The LoRa TX time is the calculated time-on-air,
+ *        the RX time is estimated from the RX windows.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Time in ms between the samples of the cycle counter, the 32 bit counter wraps after 67 s of CPU activity at 64 MHz */
+#define ENERGY_SAMPLE_TIME 60000
+
+/** Default currents in uA, sleep, CPU, GNSS, LoRa TX (22 dBm), LoRa RX, BME680 heater, LIS3DH at 10 Hz */
+const uint32_t g_energy_default[ENERGY_NUM_STATES] = {40, 3500, 25000, 120000, 5300, 12000, 11};
+/** Currents in uA */
+uint32_t g_energy_current[ENERGY_NUM_STATES];
+
+/** Short names of the states for the status */
+static const char *energy_names[ENERGY_NUM_STATES] = {"SLEEP", "CPU", "GNSS", "TX", "RX", "BME", "ACC"};
+
+/** Time in ms spent in each state, the CPU and sleep times are taken from the cycle counter.
+ *  The states are switched by the app loop and the GNSS task, the 64 bit values are
+ *  changed and read in critical sections. */
+static uint64_t energy_time[ENERGY_NUM_STATES];
+/** Start of a state that is on, 0 = off */
+static uint64_t energy_since[ENERGY_NUM_STATES];
+/** Start of the accounting */
+static uint64_t energy_start = 0;
+/** CPU cycles while the CPU was active */
+static uint64_t energy_cycles = 0;
+/** Cycle counter at the last sample */
+static uint32_t energy_last_cycles = 0;
+
+/** Timer that samples the cycle counter while the app loop sleeps */
+static TimerHandle_t energy_timer = NULL;
+#if STATIC_MEM > 0
+static StaticTimer_t energy_timer_buf;
+#endif
+
+/**
+ * @brief Timer callback, samples the cycle counter before it wraps
+ *
+ * @param unused
+ */
+static void energy_timer_cb(TimerHandle_t unused)
+{
+	(void)unused;
+	energy_sample();
+}
+
+/**
+ * @brief Start the cycle counter and the accounting
+ *
+ */
+void init_energy(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	energy_last_cycles = DWT->CYCCNT;
+	energy_start = sched_now();
+
+#if STATIC_MEM > 0
+	energy_timer = xTimerCreateStatic("ENERGY", pdMS_TO_TICKS(ENERGY_SAMPLE_TIME), pdTRUE, NULL, energy_timer_cb, &energy_timer_buf);
+#else
+	energy_timer = xTimerCreate("ENERGY", pdMS_TO_TICKS(ENERGY_SAMPLE_TIME), pdTRUE, NULL, energy_timer_cb);
+#endif
+	if (energy_timer != NULL)
+	{
+		xTimerStart(energy_timer, 0);
+	}
+}
+
+/**
+ * @brief A state is switched on, e.g. the GNSS module is powered
+ *
+ * @param state energy_state value
+ */
+void energy_on(uint8_t state)
+{
+	uint64_t now = sched_now();
+	taskENTER_CRITICAL();
+	if (energy_since[state] == 0)
+	{
+		energy_since[state] = now;
+	}
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief A state is switched off
+ *
+ * @param state energy_state value
+ */
+void energy_off(uint8_t state)
+{
+	uint64_t now = sched_now();
+	taskENTER_CRITICAL();
+	if (energy_since[state] != 0)
+	{
+		energy_time[state] += now - energy_since[state];
+		energy_since[state] = 0;
+	}
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Add a known time to a state, e.g. the time-on-air of an uplink
+ *
+ * @param state energy_state value
+ * @param time time in ms
+ */
+void energy_add(uint8_t state, uint32_t time)
+{
+	taskENTER_CRITICAL();
+	energy_time[state] += time;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Add the CPU cycles since the last sample, called on each wake up of the app loop
+ *        and by the sample timer, so the 32 bit counter is read at least once per wrap.
+ *
+ */
+void energy_sample(void)
+{
+	taskENTER_CRITICAL();
+	uint32_t cycles = DWT->CYCCNT;
+	energy_cycles += (uint32_t)(cycles - energy_last_cycles);
+	energy_last_cycles = cycles;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Restart the accounting, states that are on stay on
+ *
+ */
+void energy_reset(void)
+{
+	energy_sample();
+	uint64_t now = sched_now();
+	taskENTER_CRITICAL();
+	for (uint8_t state = 0; state < ENERGY_NUM_STATES; state++)
+	{
+		energy_time[state] = 0;
+		if (energy_since[state] != 0)
+		{
+			energy_since[state] = now;
+		}
+	}
+	energy_cycles = 0;
+	taskEXIT_CRITICAL();
+	energy_start = now;
+}
+
+/**
+ * @brief Get the time spent in each state since the start of the accounting
+ *
+ * @param time time in ms per state
+ * @return uint64_t accounted time in ms, at least 1
+ */
+static uint64_t energy_times(uint64_t *time)
+{
+	energy_sample();
+	uint64_t now = sched_now();
+	uint64_t elapsed = now > energy_start ? now - energy_start : 1;
+	taskENTER_CRITICAL();
+	for (uint8_t state = 0; state < ENERGY_NUM_STATES; state++)
+	{
+		time[state] = energy_time[state] + (energy_since[state] != 0 ? now - energy_since[state] : 0);
+	}
+	time[ENERGY_CPU] = energy_cycles / (SystemCoreClock / 1000);
+	taskEXIT_CRITICAL();
+	time[ENERGY_SLEEP] = elapsed > time[ENERGY_CPU] ? elapsed - time[ENERGY_CPU] : 0;
+	return elapsed;
+}
+
+/**
+ * @brief Get the estimated consumption since the start of the accounting
+ *
+ * @return float consumption in mAh
+ */
+float energy_consumed(void)
+{
+	uint64_t time[ENERGY_NUM_STATES];
+	energy_times(time);
+	float consumed = 0.0;
+	for (uint8_t state = 0; state < ENERGY_NUM_STATES; state++)
+	{
+		consumed += (float)g_energy_current[state] * (float)time[state];
+	}
+	// uA * ms => mAh
+	return consumed / 3600000000.0;
+}
+
+/**
+ * @brief Write the estimated consumption into a buffer.
+ *        Total in mAh per day, the accounted time and the share of each state in mAh per day.
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void energy_status(char *buffer, size_t size)
+{
+	uint64_t time[ENERGY_NUM_STATES];
+	uint64_t elapsed = energy_times(time);
+
+	// uA * ms per elapsed ms = average uA, 24 h * average uA / 1000 = mAh per day
+	float per_day[ENERGY_NUM_STATES];
+	float total = 0.0;
+	for (uint8_t state = 0; state < ENERGY_NUM_STATES; state++)
+	{
+		per_day[state] = ((float)g_energy_current[state] * (float)time[state] / (float)elapsed) * 24.0 / 1000.0;
+		total += per_day[state];
+	}
+
+	int len = snprintf(buffer, size, "%.2f mAh/d in %.1f h", total, elapsed / 3600000.0);
+	for (uint8_t state = 0; (state < ENERGY_NUM_STATES) && (len > 0) && ((size_t)len < size); state++)
+	{
+		len += snprintf(&buffer[len], size - len, " %s %.2f", energy_names[state], per_day[state]);
+	}
+}
@@ -0,0 +1,191 @@
+/**
+ * @file events.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Atomic access to the event flags in g_task_event_type.
+ *        Events are set and cleared with atomic operations, so an event that is
+ *        set by an ISR, a timer or the GNSS task while the app loop clears
+ *        another event is not lost. Each event is counted.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Number of event flags */
+#define EVENT_NUM 16
+/** Events that are only set by the application, lost events are counted for them */
+#define EVENT_OWN (ACC_TRIGGER | GNSS_FIN | SCHED_DUE)
+
+/** Events set by the application */
+static uint32_t event_posted[EVENT_NUM];
+/** Events set by the application while the same event was still pending */
+static uint32_t event_coalesced[EVENT_NUM];
+/** Events handled by the app loop */
+static uint32_t event_handled[EVENT_NUM];
+/** Wake ups of the app loop while it was already woken up */
+static uint32_t event_wake_merged = 0;
+
+/**
+ * @brief Short name of an event for the status
+ *
+ */
+static const char *event_name(uint16_t event)
+{
+	switch (event)
+	{
+	case STATUS:
+		return "STATUS";
+	case BLE_DATA:
+		return "BLE";
+	case LORA_DATA:
+		return "RX";
+	case LORA_TX_FIN:
+		return "TX";
+	case LORA_JOIN_FIN:
+		return "JOIN";
+	case GNSS_FIN:
+		return "GNSS";
+	case ACC_TRIGGER:
+		return "ACC";
+	case SCHED_DUE:
+		return "SCHED";
+	default:
+		return "EV";
+	}
+}
+
+/**
+ * @brief Bit number of an event
+ *
+ */
+static uint8_t event_bit(uint16_t event)
+{
+	return (uint8_t)(31 - __builtin_clz((uint32_t)event));
+}
+
+/**
+ * @brief Set an event flag with an atomic operation
+ *
+ * @param event event flag
+ * @return true if the event was not pending
+ * @return false if the event was still pending, the events are coalesced
+ */
+static bool event_post(uint16_t event)
+{
+	uint8_t bit = event_bit(event);
+	__atomic_fetch_add(&event_posted[bit], 1, __ATOMIC_RELAXED);
+	uint16_t pending = __atomic_fetch_or(&g_task_event_type, event, __ATOMIC_ACQ_REL);
+	if ((pending & event) != 0)
+	{
+		__atomic_fetch_add(&event_coalesced[bit], 1, __ATOMIC_RELAXED);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Set an event and wake up the app loop.
+ *        Replaces api_wake_loop(), can be called from ISRs, timers and tasks.
+ *        If the event is still pending the app loop is already woken up for it.
+ *
+ * @param event event flag
+ */
+void app_wake(uint16_t event)
+{
+	if (!event_post(event) || (g_task_sem == NULL))
+	{
+		return;
+	}
+	if ((SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0)
+	{
+		BaseType_t task_woken = pdFALSE;
+		if (xSemaphoreGiveFromISR(g_task_sem, &task_woken) != pdTRUE)
+		{
+			__atomic_fetch_add(&event_wake_merged, 1, __ATOMIC_RELAXED);
+		}
+		portYIELD_FROM_ISR(task_woken);
+	}
+	else if (xSemaphoreGive(g_task_sem) != pdTRUE)
+	{
+		__atomic_fetch_add(&event_wake_merged, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * @brief Set an event from the app loop, it is handled before the app loop sleeps again
+ *
+ * @param event event flag
+ */
+void app_event_set(uint16_t event)
+{
+	event_post(event);
+}
+
+/**
+ * @brief Check and clear an event with an atomic operation
+ *
+ * @param event event flag
+ * @return true if the event was set, it is cleared now
+ * @return false if the event was not set
+ */
+bool app_event_take(uint16_t event)
+{
+	uint16_t pending = __atomic_fetch_and(&g_task_event_type, (uint16_t)~event, __ATOMIC_ACQ_REL);
+	if ((pending & event) == 0)
+	{
+		return false;
+	}
+	event_handled[event_bit(event)]++;
+	return true;
+}
+
+/**
+ * @brief Reset the event counters
+ *
+ */
+void app_event_reset(void)
+{
+	for (uint8_t bit = 0; bit < EVENT_NUM; bit++)
+	{
+		event_posted[bit] = 0;
+		event_coalesced[bit] = 0;
+		event_handled[bit] = 0;
+	}
+	event_wake_merged = 0;
+}
+
+/**
+ * @brief Write the event counters into a buffer.
+ *        handled/posted/coalesced per event, for events that are only set by
+ *        the application the lost events are added.
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void app_event_status(char *buffer, size_t size)
+{
+	int len = snprintf(buffer, size, "Merged %ld", (long)event_wake_merged);
+	for (uint8_t bit = 0; (bit < EVENT_NUM) && (len > 0) && ((size_t)len < size); bit++)
+	{
+		uint16_t event = 1 << bit;
+		if ((event_handled[bit] == 0) && (event_posted[bit] == 0))
+		{
+			continue;
+		}
+		if ((event & EVENT_OWN) != 0)
+		{
+			// Posted events are either coalesced, handled or still pending
+			uint32_t pending = (g_task_event_type & event) != 0 ? 1 : 0;
+			int32_t lost = (int32_t)(event_posted[bit] - event_coalesced[bit] - event_handled[bit] - pending);
+			len += snprintf(&buffer[len], size - len, " %s %ld/%ld/%ld/%ld", event_name(event), (long)event_handled[bit],
+							(long)event_posted[bit], (long)event_coalesced[bit], (long)lost);
+		}
+		else
+		{
+			len += snprintf(&buffer[len], size - len, " %s %ld/%ld/%ld", event_name(event), (long)event_handled[bit],
+							(long)event_posted[bit], (long)event_coalesced[bit]);
+		}
+	}
+}
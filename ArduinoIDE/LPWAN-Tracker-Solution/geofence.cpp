@@ -0,0 +1,233 @@
+/**
+ * @file geofence.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Geofence evaluation on each location. The index is a file in
+ *        InternalFS, uploaded with AT+FENCE and read in place by the queries.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "geofence.h"
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Maximum number of fences that contain a location */
+#define FENCE_MAX_INSIDE 8
+
+/** Filename of the geofence index */
+static const char fence_name[] = "FENCE";
+
+/** File for index access */
+File fence_file(InternalFS);
+
+/**
+ * @brief Reads the index from the file
+ *
+ */
+class fence_file_reader : public gf_reader
+{
+public:
+	bool read(uint32_t offset, void *buffer, size_t len)
+	{
+		if (!fence_file.seek(offset))
+		{
+			return false;
+		}
+		return fence_file.read(buffer, len) == (int)len;
+	}
+};
+
+/** Index access */
+static fence_file_reader fence_reader;
+static gf_index fence_index;
+
+/** Fences that contain the last location */
+static uint16_t fence_inside[FENCE_MAX_INSIDE];
+static uint8_t fence_inside_num = 0;
+/** Flag if the last location is inside a home fence */
+static bool fence_home = false;
+/** Flag if the last location left the home fences */
+static bool fence_home_left = false;
+/** Flag if a fence was entered or left */
+static volatile bool fence_changed = false;
+
+/**
+ * @brief Check if an ID is in a list
+ *
+ */
+static bool fence_in_list(uint16_t id, uint16_t *list, uint8_t num)
+{
+	for (uint8_t idx = 0; idx < num; idx++)
+	{
+		if (list[idx] == id)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Load the geofence index from InternalFS
+ *
+ * @return true if a valid index was found
+ */
+bool init_geofence(void)
+{
+	fence_index.unload();
+	fence_inside_num = 0;
+	fence_home = false;
+	if (!fence_file.open(fence_name, FILE_O_READ))
+	{
+		return false;
+	}
+	bool result = fence_index.load(&fence_reader, fence_file.size());
+	fence_file.close();
+	MYLOG("FENCE", "Index %s, %d fences", result ? "valid" : "invalid", result ? fence_index.header().fence_num : 0);
+	return result;
+}
+
+/**
+ * @brief Check a location against the geofences.
+ *        Entering or leaving a fence is reported with an event.
+ *
+ * @param latitude latitude in 1/10000000 degree
+ * @param longitude longitude in 1/10000000 degree
+ */
+void geofence_check(int32_t latitude, int32_t longitude)
+{
+	if (!fence_index.loaded() || !fence_file.open(fence_name, FILE_O_READ))
+	{
+		return;
+	}
+	uint16_t inside[FENCE_MAX_INSIDE];
+	bool home;
+	time_t start = millis();
+	uint8_t inside_num = fence_index.query(latitude, longitude, inside, FENCE_MAX_INSIDE, &home);
+	fence_file.close();
+	MYLOG("FENCE", "Inside %d fences, query %ld ms", inside_num, (long)(millis() - start));
+
+	for (uint8_t idx = 0; idx < inside_num; idx++)
+	{
+		if (!fence_in_list(inside[idx], fence_inside, fence_inside_num))
+		{
+			AT_PRINTF("+EVT:FENCE_ENTER %d\n", inside[idx]);
+			fence_changed = true;
+		}
+	}
+	for (uint8_t idx = 0; idx < fence_inside_num; idx++)
+	{
+		if (!fence_in_list(fence_inside[idx], inside, inside_num))
+		{
+			AT_PRINTF("+EVT:FENCE_EXIT %d\n", fence_inside[idx]);
+			fence_changed = true;
+		}
+	}
+	memcpy(fence_inside, inside, sizeof(uint16_t) * inside_num);
+	fence_inside_num = inside_num;
+	if (fence_home && !home)
+	{
+		fence_home_left = true;
+	}
+	fence_home = home;
+}
+
+/**
+ * @brief Check if a fence was entered or left since the last call
+ *
+ * @return true if the location should be sent immediately
+ */
+bool geofence_event(void)
+{
+	bool changed = fence_changed;
+	fence_changed = false;
+	return changed;
+}
+
+/**
+ * @brief Apply the send interval of home fences
+ *
+ * @param next_interval interval selected by the adaptive send interval, 0 = unchanged
+ * @return uint32_t interval in ms to set, 0 = unchanged
+ */
+uint32_t geofence_interval(uint32_t next_interval)
+{
+	if (fence_home && (fence_index.header().home_interval != 0))
+	{
+		uint32_t home_interval = (uint32_t)fence_index.header().home_interval * 60000;
+		return home_interval > adapt_interval() ? home_interval : adapt_interval();
+	}
+	if (fence_home_left)
+	{
+		// Back to the normal interval
+		fence_home_left = false;
+		return adapt_interval();
+	}
+	return next_interval;
+}
+
+/**
+ * @brief Write a part of the geofence index, the parts have to be written in order
+ *
+ * @param offset offset of the part, 0 starts a new index
+ * @param data part of the index
+ * @param len size of the part
+ * @return true if the part was written
+ */
+bool geofence_write(uint32_t offset, uint8_t *data, uint16_t len)
+{
+	if (offset == 0)
+	{
+		fence_index.unload();
+		InternalFS.remove(fence_name);
+	}
+	if (!fence_file.open(fence_name, FILE_O_WRITE))
+	{
+		return false;
+	}
+	bool result = false;
+	if (fence_file.size() == offset)
+	{
+		result = fence_file.write(data, len) == len;
+	}
+	fence_file.close();
+	return result;
+}
+
+/**
+ * @brief Delete the geofence index
+ *
+ */
+void geofence_clear(void)
+{
+	fence_index.unload();
+	InternalFS.remove(fence_name);
+	fence_inside_num = 0;
+	fence_home_left = fence_home;
+	fence_home = false;
+}
+
+/**
+ * @brief Write the status of the geofences into a buffer
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void geofence_status(char *buffer, size_t size)
+{
+	if (!fence_index.loaded())
+	{
+		snprintf(buffer, size, "No index");
+		return;
+	}
+	int len = snprintf(buffer, size, "Fences %d, grid %dx%d, home %d min, inside", fence_index.header().fence_num,
+					   fence_index.header().cols, fence_index.header().rows, fence_index.header().home_interval);
+	for (uint8_t idx = 0; (idx < fence_inside_num) && (len > 0) && ((size_t)len < size); idx++)
+	{
+		len += snprintf(&buffer[len], size - len, " %d", fence_inside[idx]);
+	}
+}
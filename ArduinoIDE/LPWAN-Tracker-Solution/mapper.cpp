@@ -0,0 +1,285 @@
+/**
+ * @file mapper.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Helium Mapper cell deduplication. Locations are assigned to hexagon
+ *        cells (H3 like edge lengths per resolution). Cells that were mapped
+ *        recently are kept in a small open addressing hash table with LRU
+ *        replacement, locations in these cells are not sent again.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "track_simplify.h"
+
+/** Size of the hash table, power of 2 */
+#define MAPPER_TABLE_SIZE 64
+/** Maximum number of cells in the table, the least recently mapped cell is replaced */
+#define MAPPER_MAX_CELLS 48
+/** Lowest and highest supported resolution */
+#define MAPPER_MIN_RES 5
+#define MAPPER_MAX_RES 12
+
+/** Resolution of the cells, 0 = deduplication off */
+uint8_t g_mapper_res = 0;
+/** Time in minutes before a cell is mapped again */
+uint16_t g_mapper_window = 60;
+
+/** Average H3 edge length in dm for the resolutions 5 to 12 */
+static const uint32_t mapper_edge_dm[] = {85445, 32291, 12204, 4614, 1744, 659, 249, 94};
+
+/** Mapped cell */
+struct mapper_cell_s
+{
+	/** Cell key, 0 = empty slot */
+	uint64_t key;
+	/** Time the cell was mapped in s since boot (sched_now()), wraps after 136 years */
+	uint32_t time;
+};
+
+/** Hash table of the mapped cells */
+static mapper_cell_s mapper_table[MAPPER_TABLE_SIZE];
+static uint8_t mapper_num = 0;
+
+/** Cell of the location that is sent */
+static uint64_t mapper_pending = 0;
+/** Flag if the last location was in a mapped cell */
+static bool mapper_skipped = false;
+
+/** Statistics */
+static uint32_t mapper_checked = 0;
+static uint32_t mapper_dropped = 0;
+
+/**
+ * @brief Get the hexagon cell of a location.
+ *        Pointy top hexagons on an equirectangular projection, axial coordinates
+ *        with cube rounding in fixed point. Cells at the border of a latitude band are cut.
+ *
+ * @param latitude latitude in 1/10000000 degree
+ * @param longitude longitude in 1/10000000 degree
+ * @param res resolution
+ * @return uint64_t cell key, never 0
+ */
+static uint64_t mapper_cell(int32_t latitude, int32_t longitude, uint8_t res)
+{
+	// Units of 1/10000000 degree latitude, 1 m is ~89.83 units.
+	// The longitude scale is fixed for bands of 1 degree latitude, a scale that changes
+	// with each location would move the cells at large longitudes
+	int32_t band_center = (latitude / 10000000) * 10000000 + (latitude >= 0 ? 5000000 : -5000000);
+	int64_t x = ((int64_t)longitude * ts_cos_q15(band_center)) >> 15;
+	int64_t y = latitude;
+	int64_t size = ((int64_t)mapper_edge_dm[res - MAPPER_MIN_RES] * 8983) / 1000;
+
+	// Fractional axial coordinates in Q10, q = (sqrt(3)/3 * x - y/3) / size, r = 2/3 * y / size
+	int64_t q_f = (((x * 37837) >> 16) - y / 3) * 1024 / size;
+	int64_t r_f = ((2 * y) / 3) * 1024 / size;
+	int64_t s_f = -q_f - r_f;
+
+	int64_t q = (q_f >= 0 ? q_f + 512 : q_f - 511) / 1024;
+	int64_t r = (r_f >= 0 ? r_f + 512 : r_f - 511) / 1024;
+	int64_t s = (s_f >= 0 ? s_f + 512 : s_f - 511) / 1024;
+	int64_t q_diff = ts_abs(q * 1024 - q_f);
+	int64_t r_diff = ts_abs(r * 1024 - r_f);
+	int64_t s_diff = ts_abs(s * 1024 - s_f);
+	if ((q_diff > r_diff) && (q_diff > s_diff))
+	{
+		q = -r - s;
+	}
+	else if (r_diff > s_diff)
+	{
+		r = -q - s;
+	}
+	// Resolution, latitude band and 24 bits each for the axial coordinates
+	uint64_t band = (uint64_t)(latitude / 10000000 + 90);
+	return ((uint64_t)res << 56) | (band << 48) | (((uint64_t)q & 0xFFFFFF) << 24) | ((uint64_t)r & 0xFFFFFF);
+}
+
+/**
+ * @brief Slot of a cell key in the hash table
+ *
+ */
+static uint8_t mapper_hash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return (uint8_t)(key & (MAPPER_TABLE_SIZE - 1));
+}
+
+/**
+ * @brief Find a cell in the hash table
+ *
+ * @return int slot of the cell, -1 if not found
+ */
+static int mapper_find(uint64_t key)
+{
+	uint8_t slot = mapper_hash(key);
+	for (uint8_t probe = 0; probe < MAPPER_TABLE_SIZE; probe++)
+	{
+		if (mapper_table[slot].key == key)
+		{
+			return slot;
+		}
+		if (mapper_table[slot].key == 0)
+		{
+			return -1;
+		}
+		slot = (slot + 1) & (MAPPER_TABLE_SIZE - 1);
+	}
+	return -1;
+}
+
+/**
+ * @brief Remove the entry of a slot, following entries of the probe sequence are moved back
+ *
+ */
+static void mapper_remove(uint8_t slot)
+{
+	uint8_t next = slot;
+	while (true)
+	{
+		next = (next + 1) & (MAPPER_TABLE_SIZE - 1);
+		if (mapper_table[next].key == 0)
+		{
+			break;
+		}
+		uint8_t home = mapper_hash(mapper_table[next].key);
+		// Move the entry if its home slot is not between the empty slot and its current slot
+		if (((next - home) & (MAPPER_TABLE_SIZE - 1)) >= ((next - slot) & (MAPPER_TABLE_SIZE - 1)))
+		{
+			mapper_table[slot] = mapper_table[next];
+			slot = next;
+		}
+	}
+	mapper_table[slot].key = 0;
+	mapper_num--;
+}
+
+/**
+ * @brief Get the time since boot in s, 32 bit millis() / 1000 would jump back after 49.7 days
+ *
+ * @return uint32_t time in s
+ */
+static uint32_t mapper_now(void)
+{
+	return (uint32_t)(sched_now() / 1000);
+}
+
+/**
+ * @brief Add a mapped cell, replaces the least recently mapped cell if the table is full
+ *
+ */
+static void mapper_insert(uint64_t key, uint32_t now)
+{
+	int found = mapper_find(key);
+	if (found >= 0)
+	{
+		mapper_table[found].time = now;
+		return;
+	}
+	if (mapper_num >= MAPPER_MAX_CELLS)
+	{
+		uint8_t oldest = 0;
+		uint32_t oldest_age = 0;
+		for (uint8_t slot = 0; slot < MAPPER_TABLE_SIZE; slot++)
+		{
+			if ((mapper_table[slot].key != 0) && ((now - mapper_table[slot].time) >= oldest_age))
+			{
+				oldest = slot;
+				oldest_age = now - mapper_table[slot].time;
+			}
+		}
+		mapper_remove(oldest);
+	}
+	uint8_t slot = mapper_hash(key);
+	while (mapper_table[slot].key != 0)
+	{
+		slot = (slot + 1) & (MAPPER_TABLE_SIZE - 1);
+	}
+	mapper_table[slot].key = key;
+	mapper_table[slot].time = now;
+	mapper_num++;
+}
+
+/**
+ * @brief Check if the cell of a location was mapped recently
+ *
+ * @param latitude latitude in 1/10000000 degree
+ * @param longitude longitude in 1/10000000 degree
+ * @return true if the location should be sent
+ * @return false if the cell was mapped within the time window
+ */
+bool mapper_check(int32_t latitude, int32_t longitude)
+{
+	mapper_pending = 0;
+	mapper_skipped = false;
+	if ((g_mapper_res < MAPPER_MIN_RES) || (g_mapper_res > MAPPER_MAX_RES))
+	{
+		return true;
+	}
+	mapper_checked++;
+	uint64_t key = mapper_cell(latitude, longitude, g_mapper_res);
+	int found = mapper_find(key);
+	if ((found >= 0) && ((mapper_now() - mapper_table[found].time) < (uint32_t)g_mapper_window * 60))
+	{
+		mapper_dropped++;
+		mapper_skipped = true;
+		MYLOG("MAPPER", "Cell %08lX%08lX already mapped", (unsigned long)(key >> 32), (unsigned long)key);
+		return false;
+	}
+	mapper_pending = key;
+	return true;
+}
+
+/**
+ * @brief Check if the last location was dropped because its cell was mapped recently
+ *
+ * @return true if the location was dropped, flag is cleared
+ */
+bool mapper_skip(void)
+{
+	bool skipped = mapper_skipped;
+	mapper_skipped = false;
+	return skipped;
+}
+
+/**
+ * @brief The location was sent, remember its cell as mapped
+ *
+ */
+void mapper_sent(void)
+{
+	if (mapper_pending != 0)
+	{
+		mapper_insert(mapper_pending, mapper_now());
+		mapper_pending = 0;
+	}
+}
+
+/**
+ * @brief Forget all mapped cells, used after the resolution was changed
+ *
+ */
+void mapper_clear(void)
+{
+	for (uint8_t slot = 0; slot < MAPPER_TABLE_SIZE; slot++)
+	{
+		mapper_table[slot].key = 0;
+	}
+	mapper_num = 0;
+	mapper_pending = 0;
+}
+
+/**
+ * @brief Write the status of the cell deduplication into a buffer
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void mapper_status(char *buffer, size_t size)
+{
+	snprintf(buffer, size, "Resolution %d, window %d min, cells %d, dropped %ld of %ld", g_mapper_res, g_mapper_window,
+			 mapper_num, (long)mapper_dropped, (long)mapper_checked);
+}
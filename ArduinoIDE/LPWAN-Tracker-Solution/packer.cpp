@@ -0,0 +1,596 @@
+/**
+ * @file packer.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Build the Cayenne LPP payload from the collected sensor values
+ *        with respect to the maximum payload size of the current datarate
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Sensor values collected during the current cycle */
+tracker_data_s g_tracker_data;
+
+/** Values of the current uplink, new values merged with deferred values */
+static tracker_data_s pending_data;
+
+/** Values that did not fit into the last uplink */
+static tracker_data_s deferred_data;
+
+/** Number of queued locations added to the last packet */
+static uint8_t queued_num = 0;
+
+/** Buffer for the compact data format */
+static uint8_t compact_buffer[255];
+/** Size of the compact packet */
+static uint8_t compact_size = 0;
+
+/** Delta mode, sequence numbers and the location of the last frame acknowledged by the server */
+static tc_delta_encoder delta;
+
+/** Number of batch locations in the current packet, 0 if it is not a batch frame */
+static uint8_t batch_packed = 0;
+
+/** Maximum application payload size per datarate, EU868, EU433, IN865 and CN779 */
+static const uint8_t max_payload_eu[] = {51, 51, 51, 115, 242, 242, 242, 242};
+/** Maximum application payload size per datarate, AS923-1 to AS923-4 with the default uplink dwell time 1 (400 ms).
+ *  DR0 and DR1 are not allowed with dwell time 1, they get the size of DR2. If the server switches the
+ *  dwell time off, the sizes are too small and only waste capacity. */
+static const uint8_t max_payload_as[] = {11, 11, 11, 53, 125, 242, 242, 242};
+/** Maximum application payload size per datarate, US915 */
+static const uint8_t max_payload_us[] = {11, 53, 125, 242, 242};
+/** Maximum application payload size per datarate, AU915 */
+static const uint8_t max_payload_au[] = {51, 51, 51, 115, 242, 242, 242};
+/** Maximum application payload size per datarate, KR920 and CN470 */
+static const uint8_t max_payload_kr[] = {51, 51, 51, 115, 242, 242};
+/** Maximum application payload size per datarate, RU864 */
+static const uint8_t max_payload_ru[] = {51, 51, 51, 115, 222, 222, 222, 222};
+
+/** Payload size of each field including the 2 bytes LPP header */
+#define LOCATION_6_SIZE (LPP_GPS6_SIZE + 2)
+#define LOCATION_4_SIZE (LPP_GPS4_SIZE + 2)
+#define BATTERY_SIZE 4
+#define ACC_SIZE 8
+#define ENV_SIZE 15
+#define FIX_AGE_SIZE 6
+#define MOTION_SIZE 3
+#define AIRTIME_SIZE 4
+#define MEMORY_SIZE 12
+
+/** Maximum number of queued locations added to one uplink */
+#define MAX_QUEUED_PER_UPLINK 8
+
+/**
+ * @brief Get the datarate used for the next uplink
+ *
+ * @return uint8_t datarate
+ */
+uint8_t get_current_dr(void)
+{
+	MibRequestConfirm_t mib_req;
+	mib_req.Type = MIB_CHANNELS_DATARATE;
+	if (LoRaMacMibGetRequestConfirm(&mib_req) == LORAMAC_STATUS_OK)
+	{
+		return mib_req.Param.ChannelsDatarate;
+	}
+	return g_lorawan_settings.data_rate;
+}
+
+/**
+ * @brief Get the maximum application payload size for the current region and datarate
+ *
+ * @return uint8_t maximum payload size in bytes
+ */
+uint8_t get_max_payload(void)
+{
+	if (!g_lorawan_settings.lorawan_enable)
+	{
+		// LoRa P2P has no datarate limits
+		return 255;
+	}
+
+	const uint8_t *table;
+	uint8_t table_len;
+	switch (g_lorawan_settings.lora_region)
+	{
+	case LORAMAC_REGION_US915:
+		table = max_payload_us;
+		table_len = sizeof(max_payload_us);
+		break;
+	case LORAMAC_REGION_AU915:
+		table = max_payload_au;
+		table_len = sizeof(max_payload_au);
+		break;
+	case LORAMAC_REGION_KR920:
+	case LORAMAC_REGION_CN470:
+		table = max_payload_kr;
+		table_len = sizeof(max_payload_kr);
+		break;
+	case LORAMAC_REGION_RU864:
+		table = max_payload_ru;
+		table_len = sizeof(max_payload_ru);
+		break;
+	case LORAMAC_REGION_AS923:
+	case LORAMAC_REGION_AS923_2:
+	case LORAMAC_REGION_AS923_3:
+	case LORAMAC_REGION_AS923_4:
+		table = max_payload_as;
+		table_len = sizeof(max_payload_as);
+		break;
+	default:
+		table = max_payload_eu;
+		table_len = sizeof(max_payload_eu);
+		break;
+	}
+
+	uint8_t data_rate = get_current_dr();
+	if (data_rate >= table_len)
+	{
+		// Unknown datarate, use the smallest payload size
+		return table[0];
+	}
+	return table[data_rate];
+}
+
+/**
+ * @brief Move the values collected in g_tracker_data to the packer.
+ *        Deferred values of the last uplink are added if there is no newer value.
+ *
+ */
+void pack_collect(void)
+{
+	pending_data = g_tracker_data;
+	for (uint8_t field = 0; field < PAYLOAD_NUM_FIELDS; field++)
+	{
+		uint8_t mask = 1 << field;
+		if (((deferred_data.valid & mask) != 0) && ((pending_data.valid & mask) == 0))
+		{
+			switch (field)
+			{
+			case PAYLOAD_LOCATION:
+				pending_data.latitude = deferred_data.latitude;
+				pending_data.longitude = deferred_data.longitude;
+				pending_data.altitude = deferred_data.altitude;
+				pending_data.fix_time = deferred_data.fix_time;
+				pending_data.speed = deferred_data.speed;
+				pending_data.heading = deferred_data.heading;
+				break;
+			case PAYLOAD_BATTERY:
+				pending_data.battery = deferred_data.battery;
+				break;
+			case PAYLOAD_ACC:
+				pending_data.acc_x = deferred_data.acc_x;
+				pending_data.acc_y = deferred_data.acc_y;
+				pending_data.acc_z = deferred_data.acc_z;
+				break;
+			case PAYLOAD_ENV:
+				pending_data.humidity = deferred_data.humidity;
+				pending_data.temperature = deferred_data.temperature;
+				pending_data.pressure = deferred_data.pressure;
+				pending_data.gas = deferred_data.gas;
+				break;
+			case PAYLOAD_FIX_AGE:
+				pending_data.fix_age = deferred_data.fix_age;
+				break;
+			case PAYLOAD_MOTION:
+				pending_data.moving = deferred_data.moving;
+				break;
+			case PAYLOAD_AIRTIME:
+				pending_data.airtime = deferred_data.airtime;
+				break;
+			case PAYLOAD_MEMORY:
+				pending_data.heap_min = deferred_data.heap_min;
+				pending_data.stack_min = deferred_data.stack_min;
+				break;
+			}
+			pending_data.valid |= mask;
+		}
+	}
+	deferred_data.valid = 0;
+	g_tracker_data.valid = 0;
+
+	if ((batch_count() != 0) && (!g_is_compact || (g_batch_size == 0)))
+	{
+		// Batch mode was switched off, the collected locations go into the store and forward queue
+		batch_flush();
+	}
+}
+
+/**
+ * @brief Build g_data_packet in Cayenne LPP format
+ *
+ * @param max_size maximum payload size
+ * @return uint8_t size of the packet
+ */
+static uint8_t pack_lpp(uint8_t max_size)
+{
+	uint8_t packet_size = 0;
+	for (uint8_t field = 0; field < PAYLOAD_NUM_FIELDS; field++)
+	{
+		uint8_t mask = 1 << field;
+		if ((pending_data.valid & mask) == 0)
+		{
+			continue;
+		}
+		bool added = false;
+		switch (field)
+		{
+		case PAYLOAD_LOCATION:
+			if (g_gps_prec_6 && ((packet_size + LOCATION_6_SIZE) <= max_size))
+			{
+				// Save extended precision, not Cayenne LPP compatible
+				g_data_packet.addGNSS_6(LPP_CHANNEL_GPS, pending_data.latitude, pending_data.longitude, pending_data.altitude);
+				added = true;
+			}
+			else if ((packet_size + LOCATION_4_SIZE) <= max_size)
+			{
+				// Save default Cayenne LPP precision, used as well if the 6 digit precision does not fit
+				g_data_packet.addGNSS_4(LPP_CHANNEL_GPS, pending_data.latitude, pending_data.longitude, pending_data.altitude);
+				added = true;
+			}
+			break;
+		case PAYLOAD_BATTERY:
+			if ((packet_size + BATTERY_SIZE) <= max_size)
+			{
+				g_data_packet.addVoltage(LPP_CHANNEL_BATT, pending_data.battery);
+				added = true;
+			}
+			break;
+		case PAYLOAD_ACC:
+			if ((packet_size + ACC_SIZE) <= max_size)
+			{
+				g_data_packet.addAccelerometer(LPP_ACC, pending_data.acc_x, pending_data.acc_y, pending_data.acc_z);
+				added = true;
+			}
+			break;
+		case PAYLOAD_ENV:
+			if ((packet_size + ENV_SIZE) <= max_size)
+			{
+				g_data_packet.addRelativeHumidity(LPP_CHANNEL_HUMID, pending_data.humidity);
+				g_data_packet.addTemperature(LPP_CHANNEL_TEMP, pending_data.temperature);
+				g_data_packet.addBarometricPressure(LPP_CHANNEL_PRESS, pending_data.pressure);
+				g_data_packet.addAnalogInput(LPP_CHANNEL_GAS, pending_data.gas);
+				added = true;
+			}
+			break;
+		case PAYLOAD_FIX_AGE:
+			if ((packet_size + FIX_AGE_SIZE) <= max_size)
+			{
+				g_data_packet.addGenericSensor(LPP_CHANNEL_FIX_AGE, pending_data.fix_age);
+				added = true;
+			}
+			break;
+		case PAYLOAD_MOTION:
+			if ((packet_size + MOTION_SIZE) <= max_size)
+			{
+				g_data_packet.addDigitalInput(LPP_CHANNEL_MOTION, pending_data.moving);
+				added = true;
+			}
+			break;
+		case PAYLOAD_AIRTIME:
+			if ((packet_size + AIRTIME_SIZE) <= max_size)
+			{
+				g_data_packet.addAnalogInput(LPP_CHANNEL_AIRTIME, pending_data.airtime);
+				added = true;
+			}
+			break;
+		case PAYLOAD_MEMORY:
+			if ((packet_size + MEMORY_SIZE) <= max_size)
+			{
+				g_data_packet.addGenericSensor(LPP_CHANNEL_HEAP, pending_data.heap_min);
+				g_data_packet.addGenericSensor(LPP_CHANNEL_STACK, pending_data.stack_min);
+				added = true;
+			}
+			break;
+		}
+		if (added)
+		{
+			packet_size = g_data_packet.getSize();
+		}
+		else
+		{
+			MYLOG("PACK", "Field %d deferred to next uplink", field);
+			deferred_data.valid |= mask;
+		}
+	}
+
+	// Fill the remaining space with locations from the store and forward queue
+	queued_num = 0;
+	uint8_t location_size = g_gps_prec_6 ? LOCATION_6_SIZE : LOCATION_4_SIZE;
+	if ((packet_size + location_size) <= max_size)
+	{
+		fq_record_s records[MAX_QUEUED_PER_UPLINK];
+		uint8_t max_num = (max_size - packet_size) / location_size;
+		if (max_num > MAX_QUEUED_PER_UPLINK)
+		{
+			max_num = MAX_QUEUED_PER_UPLINK;
+		}
+		max_num = fq_peek(records, max_num);
+		for (queued_num = 0; queued_num < max_num; queued_num++)
+		{
+			if (g_gps_prec_6)
+			{
+				g_data_packet.addGNSS_6(LPP_CHANNEL_QUEUED + queued_num, records[queued_num].latitude, records[queued_num].longitude, records[queued_num].altitude);
+			}
+			else
+			{
+				g_data_packet.addGNSS_4(LPP_CHANNEL_QUEUED + queued_num, records[queued_num].latitude, records[queued_num].longitude, records[queued_num].altitude);
+			}
+		}
+		packet_size = g_data_packet.getSize();
+	}
+	return packet_size;
+}
+
+/**
+ * @brief Convert the pending values into the integer units of the compact format
+ *
+ * @param record record to fill
+ * @param fields TC_FIELD_xxx flags of the values in the packet
+ */
+static void fill_record(tc_record_s *record, uint8_t fields)
+{
+	record->fields = fields;
+	record->latitude = pending_data.latitude;
+	record->longitude = pending_data.longitude;
+	record->altitude = pending_data.altitude;
+	record->battery = (uint16_t)(pending_data.battery * 1000.0);
+	record->acc_x = (int16_t)(pending_data.acc_x * 1000.0);
+	record->acc_y = (int16_t)(pending_data.acc_y * 1000.0);
+	record->acc_z = (int16_t)(pending_data.acc_z * 1000.0);
+	record->humidity = (uint8_t)(pending_data.humidity * 2.0);
+	record->temperature = (int16_t)(pending_data.temperature * 10.0);
+	record->pressure = (uint16_t)(pending_data.pressure * 10.0);
+	record->gas = (uint16_t)(pending_data.gas * 10.0);
+}
+
+/**
+ * @brief Build a batch frame from the collected locations.
+ *        Locations that do not fit stay in the batch for the next uplink.
+ *
+ * @param max_size maximum payload size
+ * @return uint8_t size of the packet, 0 if not even one location fits
+ */
+static uint8_t pack_batch(uint8_t max_size)
+{
+	size_t point_bits;
+	uint8_t points_num = batch_fit(0, max_size, &point_bits);
+	if (points_num == 0)
+	{
+		// Nothing fits, the values of this uplink are sent next time
+		for (uint8_t field = 0; field <= PAYLOAD_ENV; field++)
+		{
+			uint8_t mask = 1 << field;
+			if ((pending_data.valid & mask) != 0)
+			{
+				MYLOG("PACK", "Field %d deferred to next uplink", field);
+				deferred_data.valid |= mask;
+			}
+		}
+		return 0;
+	}
+
+	// Add the other values if they fit
+	uint8_t fields = 0;
+	// The compact format has no age, airtime and memory field
+	for (uint8_t field = PAYLOAD_BATTERY; field <= PAYLOAD_ENV; field++)
+	{
+		uint8_t mask = 1 << field;
+		if ((pending_data.valid & mask) == 0)
+		{
+			continue;
+		}
+		if (tc_batch_size(fields | mask, point_bits) <= max_size)
+		{
+			fields |= mask;
+		}
+		else
+		{
+			MYLOG("PACK", "Field %d deferred to next uplink", field);
+			deferred_data.valid |= mask;
+		}
+	}
+	// A location that was not moved into the batch (e.g. deferred before the batch mode was enabled) is sent next time
+	deferred_data.valid |= pending_data.valid & (1 << PAYLOAD_LOCATION);
+
+	tc_record_s record;
+	fill_record(&record, fields);
+	compact_size = tc_encode_batch(record, batch_points(), points_num, compact_buffer, max_size);
+	batch_packed = compact_size == 0 ? 0 : points_num;
+	MYLOG("PACK", "Batch frame with %d of %d locations", batch_packed, batch_count());
+	return compact_size;
+}
+
+/**
+ * @brief Build the packet in the compact data format
+ *
+ * @param max_size maximum payload size
+ * @return uint8_t size of the packet
+ */
+static uint8_t pack_compact(uint8_t max_size)
+{
+	if ((g_batch_size != 0) && (batch_count() != 0))
+	{
+		return pack_batch(max_size);
+	}
+
+	// In delta mode the location is sent relative to the last acknowledged location.
+	// A keyframe is sent if there is no reference, the keyframe interval is reached or the delta is too large
+	bool sequenced = g_delta_interval != 0;
+	size_t location_bits = TC_LOCATION_BITS;
+	if (sequenced)
+	{
+		location_bits = delta.prepare(g_delta_interval, pending_data.latitude, pending_data.longitude, pending_data.altitude);
+	}
+
+	// Field flags of the codec are in the same order as the payload fields, the compact format has no age, airtime and memory field
+	uint8_t fields = 0;
+	for (uint8_t field = 0; field <= PAYLOAD_ENV; field++)
+	{
+		uint8_t mask = 1 << field;
+		if ((pending_data.valid & mask) == 0)
+		{
+			continue;
+		}
+		if (tc_frame_size(fields | mask, 0, location_bits, sequenced) <= max_size)
+		{
+			fields |= mask;
+		}
+		else
+		{
+			MYLOG("PACK", "Field %d deferred to next uplink", field);
+			deferred_data.valid |= mask;
+		}
+	}
+
+	tc_record_s record;
+	fill_record(&record, fields);
+
+	// Fill the remaining space with locations from the store and forward queue
+	tc_location_s queued[TC_MAX_QUEUED];
+	queued_num = 0;
+	uint8_t max_num = 0;
+	while ((max_num < TC_MAX_QUEUED) && (tc_frame_size(fields, max_num + 1, location_bits, sequenced) <= max_size))
+	{
+		max_num++;
+	}
+	if (max_num != 0)
+	{
+		fq_record_s records[TC_MAX_QUEUED];
+		queued_num = fq_peek(records, max_num);
+		for (uint8_t idx = 0; idx < queued_num; idx++)
+		{
+			queued[idx].latitude = records[idx].latitude;
+			queued[idx].longitude = records[idx].longitude;
+			queued[idx].altitude = records[idx].altitude;
+		}
+	}
+
+	if (fields == 0)
+	{
+		compact_size = 0;
+		queued_num = 0;
+	}
+	else
+	{
+		compact_size = tc_encode(record, queued, queued_num, compact_buffer, max_size, sequenced ? &delta.sequence : NULL);
+	}
+	return compact_size;
+}
+
+/**
+ * @brief Build the packet from the collected values.
+ *        Fields are added by priority (location, battery, ACC, environment).
+ *        Fields that do not fit are deferred to the next uplink.
+ *        Can be called again with a smaller size if the packet was rejected.
+ *
+ * @param max_size maximum payload size
+ * @return uint8_t size of the packet, 0 if no field fits
+ */
+uint8_t pack_payload(uint8_t max_size)
+{
+	g_data_packet.reset();
+	compact_size = 0;
+	batch_packed = 0;
+	deferred_data = pending_data;
+	deferred_data.valid = 0;
+
+	uint8_t packet_size;
+	if (g_is_compact)
+	{
+		packet_size = pack_compact(max_size);
+	}
+	else
+	{
+		packet_size = pack_lpp(max_size);
+	}
+
+	MYLOG("PACK", "Packet size %d of max %d", packet_size, max_size);
+	return packet_size;
+}
+
+/**
+ * @brief Get the packet built by pack_payload()
+ *
+ * @return uint8_t* packet buffer
+ */
+uint8_t *pack_buffer(void)
+{
+	return g_is_compact ? compact_buffer : g_data_packet.getBuffer();
+}
+
+/**
+ * @brief Get the size of the packet built by pack_payload()
+ *
+ * @return uint8_t packet size
+ */
+uint8_t pack_size(void)
+{
+	return g_is_compact ? compact_size : g_data_packet.getSize();
+}
+
+/**
+ * @brief The server acknowledged the last frame (confirmed uplink ACK or downlink),
+ *        its location becomes the reference for the delta mode
+ *
+ */
+void pack_acked(void)
+{
+	if (delta.acked())
+	{
+		MYLOG("PACK", "Delta reference is frame %d", delta.ref_seq());
+	}
+}
+
+/**
+ * @brief Handle the result of the last uplink for the batch and delta mode
+ *
+ * @param success false if the uplink was lost, the next frame is a keyframe
+ * @param confirmed true if the uplink was a confirmed uplink
+ */
+void pack_tx_finished(bool success, bool confirmed)
+{
+	// Locations of a batch frame are removed from the batch when the uplink was successful
+	batch_tx_finished(success);
+
+	if (!success)
+	{
+		delta.lost();
+	}
+	else if (confirmed)
+	{
+		pack_acked();
+	}
+}
+
+/**
+ * @brief Hand the result of the send request of the last packet to the store and forward queue
+ *
+ * @param enqueued true if the packet was accepted by the LoRa stack
+ *        if false the location of the packet is queued
+ */
+void pack_sent(bool enqueued)
+{
+	tracker_data_s sent_data = pending_data;
+	sent_data.valid &= ~deferred_data.valid;
+	if (enqueued)
+	{
+		fq_sending(&sent_data, queued_num);
+		if (batch_packed != 0)
+		{
+			batch_sending(batch_packed);
+		}
+		else if (g_is_compact && (g_delta_interval != 0))
+		{
+			delta.sent((sent_data.valid & (1 << PAYLOAD_LOCATION)) != 0, sent_data.latitude, sent_data.longitude, sent_data.altitude);
+		}
+	}
+	else if ((sent_data.valid & (1 << PAYLOAD_LOCATION)) != 0)
+	{
+		fq_push(sent_data.latitude, sent_data.longitude, sent_data.altitude);
+	}
+	queued_num = 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file trace.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Latency trace of the motion to uplink path. Trace points write the
+ *        DWT cycle counter and the millisecond time into a ring, the ring is
+ *        dumped over AT/BLE and decoded by tools/trace_decode.cpp.
+ *        The cycle counter stops while the CPU sleeps, the millisecond time
+ *        is used for intervals that include sleep.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+#if TRACE_SIZE > 0
+
+/** Marker of the dump, "TRC1" */
+#define TRACE_MAGIC 0x31435254
+/** Bytes per line of the dump */
+#define TRACE_LINE 32
+
+/** Trace entry, the trace ID is in the upper 8 bits of ms_id */
+struct trace_entry_s
+{
+	uint32_t cycles;
+	uint32_t ms_id;
+};
+
+/** Header of the dump */
+struct trace_header_s
+{
+	uint32_t magic;
+	uint32_t cpu_hz;
+	uint32_t total;
+};
+
+/** Trace ring */
+static trace_entry_s trace_ring[TRACE_SIZE];
+/** Number of entries written since the last clear, the ring holds the last TRACE_SIZE */
+static volatile uint32_t trace_total = 0;
+/** Flag if the ring is dumped, trace points are dropped */
+static volatile bool trace_paused = false;
+
+/**
+ * @brief Start the cycle counter
+ *
+ */
+void init_trace(void)
+{
+	// The counter is not reset, the energy accounting uses it as well
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief Write a trace point, can be called from ISRs and tasks
+ *
+ * @param id trace_id value
+ */
+void trace_event(uint8_t id)
+{
+	uint32_t cycles = DWT->CYCCNT;
+	if (trace_paused)
+	{
+		return;
+	}
+	uint32_t slot = __atomic_fetch_add(&trace_total, 1, __ATOMIC_RELAXED) % TRACE_SIZE;
+	trace_ring[slot].cycles = cycles;
+	trace_ring[slot].ms_id = ((uint32_t)id << 24) | (millis() & 0x00FFFFFF);
+}
+
+/**
+ * @brief Delete all entries
+ *
+ */
+void trace_clear(void)
+{
+	trace_total = 0;
+}
+
+/**
+ * @brief Print a part of the dump as hex
+ *
+ */
+static void trace_print(const uint8_t *data, size_t len)
+{
+	char line[TRACE_LINE * 2 + 1];
+	while (len != 0)
+	{
+		size_t line_len = len < TRACE_LINE ? len : TRACE_LINE;
+		for (size_t idx = 0; idx < line_len; idx++)
+		{
+			sprintf(&line[idx * 2], "%02X", data[idx]);
+		}
+		AT_PRINTF("+TRACE:%s\n", line);
+		data += line_len;
+		len -= line_len;
+	}
+}
+
+/**
+ * @brief Dump the header and the entries, oldest first, as hex lines over AT/BLE.
+ *        The lines together are the binary dump read by tools/trace_decode.cpp.
+ *
+ */
+void trace_dump(void)
+{
+	trace_paused = true;
+	uint32_t total = trace_total;
+	trace_header_s header = {TRACE_MAGIC, SystemCoreClock, total};
+	trace_print((uint8_t *)&header, sizeof(header));
+	uint32_t num = total < TRACE_SIZE ? total : TRACE_SIZE;
+	for (uint32_t idx = total - num; idx != total; idx++)
+	{
+		trace_print((uint8_t *)&trace_ring[idx % TRACE_SIZE], sizeof(trace_entry_s));
+	}
+	trace_paused = false;
+}
+
+/**
+ * @brief Write the trace status into a buffer
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void trace_status(char *buffer, size_t size)
+{
+	uint32_t total = trace_total;
+	snprintf(buffer, size, "Entries %ld/%d lost %ld", (long)(total < TRACE_SIZE ? total : TRACE_SIZE), TRACE_SIZE,
+			 (long)(total > TRACE_SIZE ? total - TRACE_SIZE : 0));
+}
+
+#endif
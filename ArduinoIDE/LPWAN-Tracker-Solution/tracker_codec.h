@@ -0,0 +1,1027 @@
+/**
+ * @file tracker_codec.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Compact bit-packed tracker payload format, encoder and decoder.
+ *        Header only and without Arduino dependencies, so the same code
+ *        can be used on the device and on a host as reference decoder.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Frame layout, all values are big endian, fields are packed MSB first:
+ *
+ * | Byte 0                          | Byte 1                             | Bits ...       |
+ * | ------------------------------- | ---------------------------------- | -------------- |
+ * | marker 0xA, version, frame type | queued locations (4), fields (4)   | packed fields  |
+ *
+ * | Field        | Bits | Resolution                  | Range                  |
+ * | ------------ | ---- | --------------------------- | ---------------------- |
+ * | Latitude     | 25   | 180 / (2^25 - 1) degree     | -90 ... 90             |
+ * | Longitude    | 26   | 360 / (2^26 - 1) degree     | -180 ... 180           |
+ * | Altitude     | 16   | 1 m                         | -1000 ... 64535 m      |
+ * | Battery      | 8    | 10 mV                       | 2.00 ... 4.55 V        |
+ * | ACC x, y, z  | 3x10 | 4 mg, signed                | -2.048 ... 2.044 g     |
+ * | Humidity     | 8    | 0.5 %RH                     | 0 ... 127.5 %RH        |
+ * | Temperature  | 11   | 0.1 degC                    | -40.0 ... 164.7 degC   |
+ * | Pressure     | 13   | 0.1 hPa                     | 300.0 ... 1119.1 hPa   |
+ * | Gas          | 16   | 0.1 kOhm                    | 0 ... 6553.5 kOhm      |
+ *
+ * Queued locations (latitude, longitude, altitude) follow the fields.
+ *
+ * Sequenced frames (delta mode) have a third header byte with the 4 bit
+ * sequence number of the frame and the 4 bit sequence number of the reference
+ * frame. If both are equal the frame is a keyframe with an absolute location.
+ * Otherwise the location is a delta in quantization steps against the location
+ * of the reference frame, which is a frame acknowledged by the server:
+ *
+ * | Field           | Bits         | Content                                  |
+ * | --------------- | ------------ | ---------------------------------------- |
+ * | Width class     | 2            | 0..3, delta width is 6 + 4 * class bits  |
+ * | Latitude delta  | 6..18        | signed                                   |
+ * | Longitude delta | 6..18        | signed                                   |
+ * | Altitude delta  | 8            | signed, m                                |
+ *
+ * Batch frames have the number of points in the third header byte and the
+ * GNSS time of the first point (32 bit, seconds since 1970-01-01 UTC).
+ * The location field holds all points, the first point with the absolute
+ * location, the following points as delta against the previous point:
+ *
+ * | Field           | Bits         | Content                                  |
+ * | --------------- | ------------ | ---------------------------------------- |
+ * | Absolute flag   | 1            | 1 = absolute location, 0 = delta         |
+ * | Location        | 67 or 22..46 | absolute location or delta location      |
+ * | Time flag       | 1            | 0 = 6 bits time delta, 1 = 16 bits       |
+ * | Time delta      | 6 or 16      | seconds since the previous point         |
+ */
+
+#ifndef TRACKER_CODEC_H
+#define TRACKER_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Marker in the upper nibble of the first byte, not used as LPP channel */
+#define TC_MARKER 0xA0
+/** Format version */
+#define TC_VERSION 1
+/** Frame types */
+#define TC_FRAME_FULL 0
+#define TC_FRAME_SEQUENCED 1
+#define TC_FRAME_BATCH 2
+
+/** Field flags */
+#define TC_FIELD_LOCATION 0x01
+#define TC_FIELD_BATTERY 0x02
+#define TC_FIELD_ACC 0x04
+#define TC_FIELD_ENV 0x08
+
+/** Maximum number of queued locations in one frame */
+#define TC_MAX_QUEUED 15
+
+/** Field sizes in bits */
+#define TC_HEADER_BITS 16
+#define TC_LOCATION_BITS (25 + 26 + 16)
+#define TC_BATTERY_BITS 8
+#define TC_ACC_BITS (3 * 10)
+#define TC_ENV_BITS (8 + 11 + 13 + 16)
+#define TC_SEQUENCE_BITS 8
+#define TC_BATCH_HEADER_BITS (8 + 32)
+
+/** Maximum number of points in a batch frame */
+#define TC_MAX_POINTS 255
+
+/** Number of sequence numbers in delta mode */
+#define TC_SEQ_NUM 16
+/** Number of delta width classes */
+#define TC_DELTA_CLASSES 4
+/** Width of a latitude/longitude delta in bits */
+#define TC_DELTA_WIDTH(width_class) (6 + 4 * (width_class))
+/** Size of a delta location in bits */
+#define TC_DELTA_BITS(width_class) (2 + 2 * TC_DELTA_WIDTH(width_class) + 8)
+
+/** Values of one frame in integer units */
+struct tc_record_s
+{
+	/** Valid fields, TC_FIELD_xxx */
+	uint8_t fields;
+	/** Latitude and longitude in 1/10000000 degree */
+	int32_t latitude;
+	int32_t longitude;
+	/** Altitude in mm */
+	int32_t altitude;
+	/** Battery in mV */
+	uint16_t battery;
+	/** Acceleration in mg */
+	int16_t acc_x;
+	int16_t acc_y;
+	int16_t acc_z;
+	/** Humidity in 0.5 %RH */
+	uint8_t humidity;
+	/** Temperature in 0.1 degC */
+	int16_t temperature;
+	/** Pressure in 0.1 hPa */
+	uint16_t pressure;
+	/** Gas resistance in 0.1 kOhm */
+	uint16_t gas;
+};
+
+/** Queued location */
+struct tc_location_s
+{
+	int32_t latitude;
+	int32_t longitude;
+	int32_t altitude;
+};
+
+/** Point of a batch frame */
+struct tc_point_s
+{
+	/** GNSS time in seconds since 1970-01-01 UTC */
+	uint32_t time;
+	int32_t latitude;
+	int32_t longitude;
+	int32_t altitude;
+};
+
+/** Location in quantization steps, as it is sent in a frame */
+struct tc_qlocation_s
+{
+	uint32_t latitude;
+	uint32_t longitude;
+	uint32_t altitude;
+};
+
+/** Sequence numbers and reference location of a sequenced frame */
+struct tc_sequence_s
+{
+	/** Sequence number of the frame, 0 .. TC_SEQ_NUM - 1 */
+	uint8_t seq;
+	/** Sequence number of the reference frame, same as seq for a keyframe */
+	uint8_t ref_seq;
+	/** Location of the reference frame */
+	tc_qlocation_s ref;
+};
+
+/**
+ * @brief Writes values MSB first into a byte buffer
+ *
+ */
+class tc_bit_writer
+{
+public:
+	tc_bit_writer(uint8_t *buffer, size_t size) : _buffer(buffer), _size(size), _bits(0)
+	{
+		for (size_t idx = 0; idx < size; idx++)
+		{
+			_buffer[idx] = 0;
+		}
+	}
+
+	/**
+	 * @brief Add a value
+	 *
+	 * @param value value, only the lower bits are used
+	 * @param bits number of bits, max 32
+	 * @return false if the buffer is full
+	 */
+	bool put(uint32_t value, uint8_t bits)
+	{
+		if ((_bits + bits) > (_size * 8))
+		{
+			return false;
+		}
+		while (bits != 0)
+		{
+			bits--;
+			if ((value >> bits) & 1)
+			{
+				_buffer[_bits >> 3] |= 0x80 >> (_bits & 7);
+			}
+			_bits++;
+		}
+		return true;
+	}
+
+	/** Number of used bytes */
+	size_t bytes(void) const { return (_bits + 7) >> 3; }
+
+private:
+	uint8_t *_buffer;
+	size_t _size;
+	size_t _bits;
+};
+
+/**
+ * @brief Reads values MSB first from a byte buffer
+ *
+ */
+class tc_bit_reader
+{
+public:
+	tc_bit_reader(const uint8_t *buffer, size_t size) : _buffer(buffer), _size(size), _bits(0) {}
+
+	/**
+	 * @brief Get a value
+	 *
+	 * @param value read value
+	 * @param bits number of bits, max 32
+	 * @return false if the buffer is too short
+	 */
+	bool get(uint32_t &value, uint8_t bits)
+	{
+		if ((_bits + bits) > (_size * 8))
+		{
+			return false;
+		}
+		value = 0;
+		while (bits != 0)
+		{
+			value = (value << 1) | ((_buffer[_bits >> 3] >> (7 - (_bits & 7))) & 1);
+			_bits++;
+			bits--;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Get a signed value (two's complement)
+	 *
+	 */
+	bool get_signed(int32_t &value, uint8_t bits)
+	{
+		uint32_t raw;
+		if (!get(raw, bits))
+		{
+			return false;
+		}
+		if ((bits < 32) && (raw & (1UL << (bits - 1))))
+		{
+			raw |= ~((1UL << bits) - 1);
+		}
+		value = (int32_t)raw;
+		return true;
+	}
+
+private:
+	const uint8_t *_buffer;
+	size_t _size;
+	size_t _bits;
+};
+
+/**
+ * @brief Limit a value to a range
+ *
+ */
+static inline int32_t tc_clamp(int32_t value, int32_t min_value, int32_t max_value)
+{
+	return value < min_value ? min_value : (value > max_value ? max_value : value);
+}
+
+/**
+ * @brief Quantize a value from [-range, range] to unsigned n bits (rounded)
+ *
+ */
+static inline uint32_t tc_quantize(int32_t value, int32_t range, uint8_t bits)
+{
+	uint64_t steps = (1ULL << bits) - 1;
+	int64_t shifted = (int64_t)tc_clamp(value, -range, range) + range;
+	return (uint32_t)((shifted * steps + range) / (2 * (int64_t)range));
+}
+
+/**
+ * @brief Inverse of tc_quantize
+ *
+ */
+static inline int32_t tc_dequantize(uint32_t value, int32_t range, uint8_t bits)
+{
+	uint64_t steps = (1ULL << bits) - 1;
+	return (int32_t)(((int64_t)value * 2 * range + (int64_t)(steps / 2)) / (int64_t)steps - range);
+}
+
+/**
+ * @brief Quantize a location
+ *
+ * @param latitude latitude in 1/10000000 degree
+ * @param longitude longitude in 1/10000000 degree
+ * @param altitude altitude in mm
+ * @return tc_qlocation_s location in quantization steps
+ */
+static inline tc_qlocation_s tc_quantize_location(int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	tc_qlocation_s location;
+	location.latitude = tc_quantize(latitude, 900000000, 25);
+	location.longitude = tc_quantize(longitude, 1800000000, 26);
+	location.altitude = (uint32_t)tc_clamp((altitude + 1000000 + 500) / 1000, 0, 0xFFFF);
+	return location;
+}
+
+/**
+ * @brief Inverse of tc_quantize_location
+ *
+ */
+static inline void tc_dequantize_location(const tc_qlocation_s &location, int32_t &latitude, int32_t &longitude, int32_t &altitude)
+{
+	latitude = tc_dequantize(location.latitude, 900000000, 25);
+	longitude = tc_dequantize(location.longitude, 1800000000, 26);
+	altitude = (int32_t)location.altitude * 1000 - 1000000;
+}
+
+/**
+ * @brief Get the smallest delta width class for a location
+ *
+ * @param ref reference location
+ * @param location new location
+ * @return int8_t width class, -1 if the delta is too large
+ */
+static inline int8_t tc_delta_class(const tc_qlocation_s &ref, const tc_qlocation_s &location)
+{
+	int32_t d_lat = (int32_t)(location.latitude - ref.latitude);
+	int32_t d_lon = (int32_t)(location.longitude - ref.longitude);
+	int32_t d_alt = (int32_t)(location.altitude - ref.altitude);
+	if ((d_alt < -128) || (d_alt > 127))
+	{
+		return -1;
+	}
+	for (int8_t width_class = 0; width_class < TC_DELTA_CLASSES; width_class++)
+	{
+		int32_t limit = 1L << (TC_DELTA_WIDTH(width_class) - 1);
+		if ((d_lat >= -limit) && (d_lat < limit) && (d_lon >= -limit) && (d_lon < limit))
+		{
+			return width_class;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Size of the location in a frame in bits
+ *
+ * @param sequence sequence numbers and reference, NULL for full frames
+ * @param latitude latitude in 1/10000000 degree
+ * @param longitude longitude in 1/10000000 degree
+ * @param altitude altitude in mm
+ * @return size_t size in bits
+ */
+static inline size_t tc_location_bits(const tc_sequence_s *sequence, int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	if ((sequence == NULL) || (sequence->seq == sequence->ref_seq))
+	{
+		return TC_LOCATION_BITS;
+	}
+	int8_t width_class = tc_delta_class(sequence->ref, tc_quantize_location(latitude, longitude, altitude));
+	return width_class < 0 ? TC_LOCATION_BITS : TC_DELTA_BITS(width_class);
+}
+
+/**
+ * @brief Write a location
+ *
+ */
+static inline bool tc_put_location(tc_bit_writer &writer, int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	tc_qlocation_s location = tc_quantize_location(latitude, longitude, altitude);
+	bool result = writer.put(location.latitude, 25);
+	result &= writer.put(location.longitude, 26);
+	result &= writer.put(location.altitude, 16);
+	return result;
+}
+
+/**
+ * @brief Write a location as delta against a reference
+ *
+ * @return false if the buffer is full or the delta is too large
+ */
+static inline bool tc_put_delta(tc_bit_writer &writer, const tc_qlocation_s &ref, int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	tc_qlocation_s location = tc_quantize_location(latitude, longitude, altitude);
+	int8_t width_class = tc_delta_class(ref, location);
+	if (width_class < 0)
+	{
+		return false;
+	}
+	uint8_t width = TC_DELTA_WIDTH(width_class);
+	uint32_t mask = (1UL << width) - 1;
+	bool result = writer.put(width_class, 2);
+	result &= writer.put((location.latitude - ref.latitude) & mask, width);
+	result &= writer.put((location.longitude - ref.longitude) & mask, width);
+	result &= writer.put((location.altitude - ref.altitude) & 0xFF, 8);
+	return result;
+}
+
+/**
+ * @brief Read a location in quantization steps
+ *
+ */
+static inline bool tc_get_qlocation(tc_bit_reader &reader, tc_qlocation_s &location)
+{
+	return reader.get(location.latitude, 25) && reader.get(location.longitude, 26) && reader.get(location.altitude, 16);
+}
+
+/**
+ * @brief Read a location
+ *
+ */
+static inline bool tc_get_location(tc_bit_reader &reader, int32_t &latitude, int32_t &longitude, int32_t &altitude)
+{
+	tc_qlocation_s location;
+	if (!tc_get_qlocation(reader, location))
+	{
+		return false;
+	}
+	tc_dequantize_location(location, latitude, longitude, altitude);
+	return true;
+}
+
+/**
+ * @brief Read a delta location and add it to the reference
+ *
+ */
+static inline bool tc_get_delta(tc_bit_reader &reader, const tc_qlocation_s &ref, tc_qlocation_s &location)
+{
+	uint32_t width_class;
+	int32_t d_lat, d_lon, d_alt;
+	if (!reader.get(width_class, 2))
+	{
+		return false;
+	}
+	uint8_t width = TC_DELTA_WIDTH(width_class);
+	if (!reader.get_signed(d_lat, width) || !reader.get_signed(d_lon, width) || !reader.get_signed(d_alt, 8))
+	{
+		return false;
+	}
+	location.latitude = ref.latitude + (uint32_t)d_lat;
+	location.longitude = ref.longitude + (uint32_t)d_lon;
+	location.altitude = ref.altitude + (uint32_t)d_alt;
+	return true;
+}
+
+/**
+ * @brief Write battery, acceleration and environment values
+ *
+ */
+static inline bool tc_put_values(tc_bit_writer &writer, const tc_record_s &record)
+{
+	bool result = true;
+	if (record.fields & TC_FIELD_BATTERY)
+	{
+		result &= writer.put((uint32_t)tc_clamp(((int32_t)record.battery - 2000 + 5) / 10, 0, 255), 8);
+	}
+	if (record.fields & TC_FIELD_ACC)
+	{
+		result &= writer.put((uint32_t)tc_clamp(record.acc_x / 4, -512, 511) & 0x3FF, 10);
+		result &= writer.put((uint32_t)tc_clamp(record.acc_y / 4, -512, 511) & 0x3FF, 10);
+		result &= writer.put((uint32_t)tc_clamp(record.acc_z / 4, -512, 511) & 0x3FF, 10);
+	}
+	if (record.fields & TC_FIELD_ENV)
+	{
+		result &= writer.put(record.humidity, 8);
+		result &= writer.put((uint32_t)tc_clamp(record.temperature + 400, 0, 2047), 11);
+		result &= writer.put((uint32_t)tc_clamp((int32_t)record.pressure - 3000, 0, 8191), 13);
+		result &= writer.put(record.gas, 16);
+	}
+	return result;
+}
+
+/**
+ * @brief Read battery, acceleration and environment values
+ *
+ */
+static inline bool tc_get_values(tc_bit_reader &reader, tc_record_s &record)
+{
+	uint32_t value;
+	int32_t signed_value;
+	if (record.fields & TC_FIELD_BATTERY)
+	{
+		if (!reader.get(value, 8))
+		{
+			return false;
+		}
+		record.battery = (uint16_t)(value * 10 + 2000);
+	}
+	if (record.fields & TC_FIELD_ACC)
+	{
+		int16_t *axis[3] = {&record.acc_x, &record.acc_y, &record.acc_z};
+		for (uint8_t idx = 0; idx < 3; idx++)
+		{
+			if (!reader.get_signed(signed_value, 10))
+			{
+				return false;
+			}
+			*axis[idx] = (int16_t)(signed_value * 4);
+		}
+	}
+	if (record.fields & TC_FIELD_ENV)
+	{
+		if (!reader.get(value, 8))
+		{
+			return false;
+		}
+		record.humidity = (uint8_t)value;
+		if (!reader.get(value, 11))
+		{
+			return false;
+		}
+		record.temperature = (int16_t)value - 400;
+		if (!reader.get(value, 13))
+		{
+			return false;
+		}
+		record.pressure = (uint16_t)(value + 3000);
+		if (!reader.get(value, 16))
+		{
+			return false;
+		}
+		record.gas = (uint16_t)value;
+	}
+	return true;
+}
+
+/**
+ * @brief Size of a frame in bytes
+ *
+ * @param fields TC_FIELD_xxx flags
+ * @param queued number of queued locations
+ * @param location_bits size of the location, see tc_location_bits()
+ * @param sequenced true for a sequenced frame
+ * @return size_t frame size in bytes
+ */
+static inline size_t tc_frame_size(uint8_t fields, uint8_t queued, size_t location_bits = TC_LOCATION_BITS, bool sequenced = false)
+{
+	size_t bits = TC_HEADER_BITS;
+	bits += sequenced ? TC_SEQUENCE_BITS : 0;
+	bits += (fields & TC_FIELD_LOCATION) ? location_bits : 0;
+	bits += (fields & TC_FIELD_BATTERY) ? TC_BATTERY_BITS : 0;
+	bits += (fields & TC_FIELD_ACC) ? TC_ACC_BITS : 0;
+	bits += (fields & TC_FIELD_ENV) ? TC_ENV_BITS : 0;
+	bits += queued * TC_LOCATION_BITS;
+	return (bits + 7) >> 3;
+}
+
+/**
+ * @brief Encode a record and queued locations into a frame
+ *
+ * @param record values to encode
+ * @param queued queued locations, can be NULL if queued_num is 0
+ * @param queued_num number of queued locations, max TC_MAX_QUEUED
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @param sequence sequence numbers and reference for a sequenced frame, NULL for a full frame.
+ *        If the delta is too large, the caller has to send a keyframe (ref_seq = seq)
+ * @return size_t frame size, 0 if the buffer is too small
+ */
+static inline size_t tc_encode(const tc_record_s &record, const tc_location_s *queued, uint8_t queued_num, uint8_t *buffer, size_t size,
+							   const tc_sequence_s *sequence = NULL)
+{
+	if (queued_num > TC_MAX_QUEUED)
+	{
+		queued_num = TC_MAX_QUEUED;
+	}
+	tc_bit_writer writer(buffer, size);
+	bool result = writer.put(TC_MARKER | (TC_VERSION << 2) | (sequence == NULL ? TC_FRAME_FULL : TC_FRAME_SEQUENCED), 8);
+	result &= writer.put(((uint32_t)queued_num << 4) | (record.fields & 0x0F), 8);
+	if (sequence != NULL)
+	{
+		result &= writer.put(((sequence->seq & 0x0F) << 4) | (sequence->ref_seq & 0x0F), 8);
+	}
+	if (record.fields & TC_FIELD_LOCATION)
+	{
+		if ((sequence == NULL) || (sequence->seq == sequence->ref_seq))
+		{
+			result &= tc_put_location(writer, record.latitude, record.longitude, record.altitude);
+		}
+		else
+		{
+			result &= tc_put_delta(writer, sequence->ref, record.latitude, record.longitude, record.altitude);
+		}
+	}
+	result &= tc_put_values(writer, record);
+	for (uint8_t idx = 0; idx < queued_num; idx++)
+	{
+		result &= tc_put_location(writer, queued[idx].latitude, queued[idx].longitude, queued[idx].altitude);
+	}
+	return result ? writer.bytes() : 0;
+}
+
+/**
+ * @brief Size of a batch point in bits
+ *
+ * @param previous previous point, NULL for the first point
+ * @param point the point
+ * @return size_t size in bits
+ */
+static inline size_t tc_point_bits(const tc_point_s *previous, const tc_point_s &point)
+{
+	if (previous == NULL)
+	{
+		return TC_LOCATION_BITS;
+	}
+	int8_t width_class = tc_delta_class(tc_quantize_location(previous->latitude, previous->longitude, previous->altitude),
+										tc_quantize_location(point.latitude, point.longitude, point.altitude));
+	size_t bits = 1 + (width_class < 0 ? TC_LOCATION_BITS : TC_DELTA_BITS(width_class));
+	bits += ((point.time - previous->time) < 64) ? 1 + 6 : 1 + 16;
+	return bits;
+}
+
+/**
+ * @brief Size of a batch frame in bytes
+ *
+ * @param fields TC_FIELD_xxx flags, TC_FIELD_LOCATION is always included
+ * @param point_bits sum of the tc_point_bits() of all points
+ * @return size_t frame size in bytes
+ */
+static inline size_t tc_batch_size(uint8_t fields, size_t point_bits)
+{
+	return tc_frame_size(fields | TC_FIELD_LOCATION, 0, point_bits) + (TC_BATCH_HEADER_BITS / 8);
+}
+
+/**
+ * @brief Encode a batch of points and the values of a record into a batch frame
+ *
+ * @param record battery, acceleration and environment values, the location is not used
+ * @param points points, oldest first
+ * @param points_num number of points, 1 .. TC_MAX_POINTS
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @return size_t frame size, 0 if the buffer is too small
+ */
+static inline size_t tc_encode_batch(const tc_record_s &record, const tc_point_s *points, uint8_t points_num, uint8_t *buffer, size_t size)
+{
+	if (points_num == 0)
+	{
+		return 0;
+	}
+	tc_bit_writer writer(buffer, size);
+	bool result = writer.put(TC_MARKER | (TC_VERSION << 2) | TC_FRAME_BATCH, 8);
+	result &= writer.put((record.fields | TC_FIELD_LOCATION) & 0x0F, 8);
+	result &= writer.put(points_num, 8);
+	result &= writer.put(points[0].time, 32);
+	result &= tc_put_location(writer, points[0].latitude, points[0].longitude, points[0].altitude);
+	for (uint8_t idx = 1; idx < points_num; idx++)
+	{
+		const tc_point_s &previous = points[idx - 1];
+		const tc_point_s &point = points[idx];
+		tc_qlocation_s ref = tc_quantize_location(previous.latitude, previous.longitude, previous.altitude);
+		if (tc_delta_class(ref, tc_quantize_location(point.latitude, point.longitude, point.altitude)) < 0)
+		{
+			result &= writer.put(1, 1);
+			result &= tc_put_location(writer, point.latitude, point.longitude, point.altitude);
+		}
+		else
+		{
+			result &= writer.put(0, 1);
+			result &= tc_put_delta(writer, ref, point.latitude, point.longitude, point.altitude);
+		}
+		uint32_t time_delta = point.time - previous.time;
+		if (time_delta < 64)
+		{
+			result &= writer.put(0, 1);
+			result &= writer.put(time_delta, 6);
+		}
+		else
+		{
+			result &= writer.put(1, 1);
+			result &= writer.put(time_delta > 0xFFFF ? 0xFFFF : time_delta, 16);
+		}
+	}
+	result &= tc_put_values(writer, record);
+	return result ? writer.bytes() : 0;
+}
+
+/**
+ * @brief Decode a batch frame
+ *
+ * @param buffer frame
+ * @param size size of the frame
+ * @param record decoded values, the location is the location of the last point
+ * @param points buffer for the points, TC_MAX_POINTS entries
+ * @param points_num number of decoded points
+ * @return true if the frame was a valid batch frame
+ */
+static inline bool tc_decode_batch(const uint8_t *buffer, size_t size, tc_record_s &record, tc_point_s *points, uint8_t &points_num)
+{
+	tc_bit_reader reader(buffer, size);
+	uint32_t value;
+	uint32_t num;
+	points_num = 0;
+	if (!reader.get(value, 8) || (value != (TC_MARKER | (TC_VERSION << 2) | TC_FRAME_BATCH)))
+	{
+		return false;
+	}
+	if (!reader.get(value, 8) || !reader.get(num, 8) || (num == 0))
+	{
+		return false;
+	}
+	record.fields = value & 0x0F;
+	tc_qlocation_s location;
+	if (!reader.get(points[0].time, 32) || !tc_get_qlocation(reader, location))
+	{
+		return false;
+	}
+	tc_dequantize_location(location, points[0].latitude, points[0].longitude, points[0].altitude);
+	for (uint8_t idx = 1; idx < num; idx++)
+	{
+		if (!reader.get(value, 1))
+		{
+			return false;
+		}
+		if (value)
+		{
+			if (!tc_get_qlocation(reader, location))
+			{
+				return false;
+			}
+		}
+		else if (!tc_get_delta(reader, location, location))
+		{
+			return false;
+		}
+		tc_dequantize_location(location, points[idx].latitude, points[idx].longitude, points[idx].altitude);
+		if (!reader.get(value, 1) || !reader.get(value, value ? 16 : 6))
+		{
+			return false;
+		}
+		points[idx].time = points[idx - 1].time + value;
+	}
+	points_num = num;
+	record.latitude = points[num - 1].latitude;
+	record.longitude = points[num - 1].longitude;
+	record.altitude = points[num - 1].altitude;
+	return tc_get_values(reader, record);
+}
+
+/**
+ * @brief Reference decoder. Keeps the locations of the received sequenced
+ *        frames to rebuild the absolute location of delta frames.
+ *
+ */
+class tc_decoder
+{
+public:
+	tc_decoder(void) : missing_ref(false), _history_valid(0), _last_seq(0), _last_valid(false) {}
+
+	/**
+	 * @brief Decode a frame
+	 *
+	 * @param buffer frame
+	 * @param size size of the frame
+	 * @param record decoded values, the location is always absolute
+	 * @param queued buffer for queued locations, TC_MAX_QUEUED entries, can be NULL
+	 * @param queued_num number of decoded queued locations
+	 * @return true if the frame was valid
+	 * @return false if the frame was invalid or the reference of a delta frame is unknown (missing_ref is set)
+	 */
+	bool decode(const uint8_t *buffer, size_t size, tc_record_s &record, tc_location_s *queued, uint8_t &queued_num)
+	{
+		tc_bit_reader reader(buffer, size);
+		uint32_t value;
+		uint8_t seq = 0;
+		uint8_t ref_seq = 0;
+		queued_num = 0;
+		missing_ref = false;
+		if (!reader.get(value, 8) || ((value & 0xFC) != (TC_MARKER | (TC_VERSION << 2))))
+		{
+			return false;
+		}
+		uint8_t frame_type = value & 0x03;
+		if ((frame_type != TC_FRAME_FULL) && (frame_type != TC_FRAME_SEQUENCED))
+		{
+			return false;
+		}
+		if (!reader.get(value, 8))
+		{
+			return false;
+		}
+		uint8_t num = value >> 4;
+		record.fields = value & 0x0F;
+		if (frame_type == TC_FRAME_SEQUENCED)
+		{
+			if (!reader.get(value, 8))
+			{
+				return false;
+			}
+			seq = value >> 4;
+			ref_seq = value & 0x0F;
+			skip_lost(seq);
+		}
+		if (record.fields & TC_FIELD_LOCATION)
+		{
+			tc_qlocation_s location;
+			if ((frame_type == TC_FRAME_FULL) || (seq == ref_seq))
+			{
+				if (!tc_get_qlocation(reader, location))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if ((_history_valid & (1 << ref_seq)) == 0)
+				{
+					missing_ref = true;
+					return false;
+				}
+				if (!tc_get_delta(reader, _history[ref_seq], location))
+				{
+					return false;
+				}
+			}
+			tc_dequantize_location(location, record.latitude, record.longitude, record.altitude);
+			if (frame_type == TC_FRAME_SEQUENCED)
+			{
+				_history[seq] = location;
+				_history_valid |= 1 << seq;
+			}
+		}
+		if (!tc_get_values(reader, record))
+		{
+			return false;
+		}
+		for (uint8_t idx = 0; idx < num; idx++)
+		{
+			tc_location_s location;
+			if (!tc_get_location(reader, location.latitude, location.longitude, location.altitude))
+			{
+				return false;
+			}
+			if (queued != NULL)
+			{
+				queued[idx] = location;
+			}
+			queued_num++;
+		}
+		return true;
+	}
+
+	/** Set if the last frame was a delta frame with an unknown reference */
+	bool missing_ref;
+
+private:
+	/**
+	 * @brief Forget the locations of the sequence numbers that were skipped since the
+	 *        last received frame and of the received one. Their entries are from frames
+	 *        TC_SEQ_NUM frames ago, a delta against them would give a wrong location.
+	 *        The entry of the received frame is set again if its location is decoded.
+	 *
+	 * @param seq sequence number of the received frame
+	 */
+	void skip_lost(uint8_t seq)
+	{
+		// The same sequence number again is a repeated frame
+		if (_last_valid && (seq != _last_seq))
+		{
+			for (uint8_t lost = (_last_seq + 1) % TC_SEQ_NUM; lost != seq; lost = (lost + 1) % TC_SEQ_NUM)
+			{
+				_history_valid &= ~(1 << lost);
+			}
+		}
+		_history_valid &= ~(1 << seq);
+		_last_seq = seq;
+		_last_valid = true;
+	}
+
+	/** Locations of the last received sequenced frames, indexed by sequence number */
+	tc_qlocation_s _history[TC_SEQ_NUM];
+	/** Bit mask of valid history entries */
+	uint16_t _history_valid;
+	/** Sequence number of the last received frame */
+	uint8_t _last_seq;
+	bool _last_valid;
+};
+
+/**
+ * @brief Delta mode of the encoder. Keeps the sequence number of the next frame
+ *        and the location of the last frame acknowledged by the server, which
+ *        is the reference of the delta frames.
+ *        A keyframe is sent if there is no reference, the keyframe interval is
+ *        reached, the delta is too large or the sequence number wraps onto the
+ *        reference.
+ *
+ */
+class tc_delta_encoder
+{
+public:
+	tc_delta_encoder(void) : since_key(0), _ref_seq(0), _ref_valid(false), _seq(0), _sent_seq(0), _sent_valid(false)
+	{
+		sequence.seq = 0;
+		sequence.ref_seq = 0;
+	}
+
+	/**
+	 * @brief Select keyframe or delta for the location of the next frame, the result is in sequence
+	 *
+	 * @param interval keyframe interval, every interval-th frame is a keyframe
+	 * @param latitude latitude in 1/10000000 degree
+	 * @param longitude longitude in 1/10000000 degree
+	 * @param altitude altitude in mm
+	 * @return size_t size of the location in bits
+	 */
+	size_t prepare(uint8_t interval, int32_t latitude, int32_t longitude, int32_t altitude)
+	{
+		sequence.seq = _seq;
+		sequence.ref_seq = _seq;
+		if (_ref_valid && (_ref_seq != _seq) && ((since_key + 1) < interval))
+		{
+			sequence.ref_seq = _ref_seq;
+			sequence.ref = _ref;
+			size_t location_bits = tc_location_bits(&sequence, latitude, longitude, altitude);
+			if (location_bits != TC_LOCATION_BITS)
+			{
+				return location_bits;
+			}
+			// Delta too large
+			sequence.ref_seq = _seq;
+		}
+		return TC_LOCATION_BITS;
+	}
+
+	/**
+	 * @brief The frame prepared last was sent, the next frame gets the next sequence number
+	 *
+	 * @param has_location true if the frame had a location
+	 * @param latitude latitude in 1/10000000 degree
+	 * @param longitude longitude in 1/10000000 degree
+	 * @param altitude altitude in mm
+	 */
+	void sent(bool has_location, int32_t latitude, int32_t longitude, int32_t altitude)
+	{
+		_sent_valid = has_location;
+		_sent_seq = _seq;
+		if (has_location)
+		{
+			_sent = tc_quantize_location(latitude, longitude, altitude);
+			since_key = (sequence.ref_seq == _seq) ? 0 : since_key + 1;
+		}
+		if (_ref_seq == _seq)
+		{
+			// The decoder overwrites the reference with this frame
+			_ref_valid = false;
+		}
+		_seq = (_seq + 1) % TC_SEQ_NUM;
+	}
+
+	/**
+	 * @brief The server acknowledged the last sent frame, its location becomes the reference
+	 *
+	 * @return true if the reference changed
+	 */
+	bool acked(void)
+	{
+		if (!_sent_valid)
+		{
+			return false;
+		}
+		_ref = _sent;
+		_ref_seq = _sent_seq;
+		_ref_valid = true;
+		_sent_valid = false;
+		return true;
+	}
+
+	/**
+	 * @brief The last sent frame was lost, the next frame is a keyframe
+	 *
+	 */
+	void lost(void)
+	{
+		_ref_valid = false;
+		_sent_valid = false;
+	}
+
+	/** Sequence number of the reference frame */
+	uint8_t ref_seq(void) const { return _ref_seq; }
+
+	/** Sequence numbers and reference of the frame prepared last */
+	tc_sequence_s sequence;
+	/** Number of frames with location since the last keyframe */
+	uint8_t since_key;
+
+private:
+	/** Location and sequence number of the last acknowledged frame */
+	tc_qlocation_s _ref;
+	uint8_t _ref_seq;
+	bool _ref_valid;
+	/** Sequence number of the next frame */
+	uint8_t _seq;
+	/** Location and sequence number of the last sent frame, it becomes the reference when it is acknowledged */
+	tc_qlocation_s _sent;
+	uint8_t _sent_seq;
+	bool _sent_valid;
+};
+
+/**
+ * @brief Decode a frame without delta history
+ *
+ * @param buffer frame
+ * @param size size of the frame
+ * @param record decoded values
+ * @param queued buffer for queued locations, TC_MAX_QUEUED entries, can be NULL
+ * @param queued_num number of decoded queued locations
+ * @return true if the frame was valid
+ */
+static inline bool tc_decode(const uint8_t *buffer, size_t size, tc_record_s &record, tc_location_s *queued, uint8_t &queued_num)
+{
+	tc_decoder decoder;
+	return decoder.decode(buffer, size, record, queued, queued_num);
+}
+
+#endif
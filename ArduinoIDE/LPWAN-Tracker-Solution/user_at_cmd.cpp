@@ -26,6 +26,42 @@ static const char submit_acc[] = "ACC";
 /** Filename to save data format setting */
 static const char helium_format[] = "HELIUM";
 
+/** Filename to save compact data format setting */
+static const char compact_format[] = "COMPACT";
+
+/** Filename to save delta mode keyframe interval */
+static const char delta_name[] = "DELTA";
+
+/** Filename to save batch size */
+static const char batch_name[] = "BATCH";
+
+/** Filename to save track simplification tolerance */
+static const char simplify_name[] = "SIMPL";
+
+/** Filename to save airtime budget settings */
+static const char airtime_name[] = "AIRT";
+
+/** Filename to save the interval table of the adaptive send interval */
+static const char adapt_name[] = "ADAPT";
+
+/** Filename to save the distance filter settings */
+static const char filter_name[] = "FILTER";
+
+/** Filename to save the maximum age of a cached location */
+static const char cache_name[] = "CACHE";
+
+/** Filename to save the maximum age of the location sent on an ACC trigger */
+static const char motion_name[] = "MOTF";
+
+/** Filename to save the Helium Mapper cell settings */
+static const char mapper_name[] = "MAPC";
+
+/** Filename to save the memory telemetry setting */
+static const char mem_name[] = "MEMP";
+
+/** Filename to save the currents of the energy accounting */
+static const char current_name[] = "CURR";
+
 /** Filename to save Battery check setting */
 static const char batt_name[] = "BATT";
 
@@ -42,201 +78,1021 @@ File batt_check(InternalFS);
 // 		g_ble_uart.printf(__VA_ARGS__); \
 // 	}
 
+/*****************************************
+ * Settings files, each setting is saved
+ * into its own file when it is changed
+ *****************************************/
+
+/**
+ * @brief Save the keyframe interval of the delta mode
+ *
+ */
+static void save_delta_setting(void)
+{
+	InternalFS.remove(delta_name);
+	if (g_delta_interval != 0)
+	{
+		gps_file.open(delta_name, FILE_O_WRITE);
+		gps_file.write(&g_delta_interval, 1);
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for delta keyframe interval");
+	}
+}
+
+/**
+ * @brief Save the number of locations in a batch
+ *
+ */
+static void save_batch_setting(void)
+{
+	InternalFS.remove(batch_name);
+	if (g_batch_size != 0)
+	{
+		gps_file.open(batch_name, FILE_O_WRITE);
+		gps_file.write(&g_batch_size, 1);
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for batch size");
+	}
+}
+
+/**
+ * @brief Save the tolerance of the track simplification
+ *
+ */
+static void save_simplify_setting(void)
+{
+	InternalFS.remove(simplify_name);
+	if (g_simplify_tolerance != 0)
+	{
+		gps_file.open(simplify_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_simplify_tolerance, sizeof(g_simplify_tolerance));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for track simplification");
+	}
+}
+
+/**
+ * @brief Save the airtime budget
+ *
+ */
+static void save_airtime_setting(void)
+{
+	InternalFS.remove(airtime_name);
+	if ((g_airtime_budget != 0) || g_airtime_payload)
+	{
+		gps_file.open(airtime_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_airtime_budget, sizeof(g_airtime_budget));
+		gps_file.write((uint8_t *)&g_airtime_window, sizeof(g_airtime_window));
+		gps_file.write((uint8_t *)&g_airtime_payload, sizeof(g_airtime_payload));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for airtime budget");
+	}
+}
+
+/**
+ * @brief Save the interval table of the adaptive send interval
+ *
+ */
+static void save_adapt_setting(void)
+{
+	InternalFS.remove(adapt_name);
+	if (g_adapt_settings.steps_num != 0)
+	{
+		gps_file.open(adapt_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_adapt_settings, sizeof(g_adapt_settings));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for adaptive interval");
+	}
+}
+
+/**
+ * @brief Save the distance filter
+ *
+ */
+static void save_filter_setting(void)
+{
+	InternalFS.remove(filter_name);
+	if (g_filter_distance != 0)
+	{
+		gps_file.open(filter_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_filter_distance, sizeof(g_filter_distance));
+		gps_file.write((uint8_t *)&g_filter_time, sizeof(g_filter_time));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for distance filter");
+	}
+}
+
+/**
+ * @brief Save the maximum age of a cached location
+ *
+ */
+static void save_cache_setting(void)
+{
+	InternalFS.remove(cache_name);
+	if (g_cache_max_age != 0)
+	{
+		gps_file.open(cache_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_cache_max_age, sizeof(g_cache_max_age));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for cached location");
+	}
+}
+
+/**
+ * @brief Save the Helium Mapper cell deduplication
+ *
+ */
+static void save_mapper_setting(void)
+{
+	InternalFS.remove(mapper_name);
+	if (g_mapper_res != 0)
+	{
+		gps_file.open(mapper_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_mapper_res, sizeof(g_mapper_res));
+		gps_file.write((uint8_t *)&g_mapper_window, sizeof(g_mapper_window));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for mapper cells");
+	}
+}
+
+/**
+ * @brief Save the maximum age of the location sent on an ACC trigger
+ *
+ */
+static void save_motion_setting(void)
+{
+	InternalFS.remove(motion_name);
+	if (g_motion_fix_age != 0)
+	{
+		gps_file.open(motion_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_motion_fix_age, sizeof(g_motion_fix_age));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for location on ACC trigger");
+	}
+}
+
+/**
+ * @brief Save the memory telemetry setting
+ *
+ */
+static void save_mem_setting(void)
+{
+	InternalFS.remove(mem_name);
+	if (g_mem_payload)
+	{
+		gps_file.open(mem_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)&g_mem_payload, sizeof(g_mem_payload));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for memory telemetry");
+	}
+}
+
+/**
+ * @brief Save the currents of the energy accounting
+ *
+ */
+static void save_current_setting(void)
+{
+	InternalFS.remove(current_name);
+	if (memcmp(g_energy_current, g_energy_default, sizeof(g_energy_current)) != 0)
+	{
+		gps_file.open(current_name, FILE_O_WRITE);
+		gps_file.write((uint8_t *)g_energy_current, sizeof(g_energy_current));
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for currents of the energy accounting");
+	}
+}
+
 /*****************************************
  * Query modules AT commands
  *****************************************/
 
 /**
- * @brief Query found modules
+ * @brief Query found modules
+ *
+ * @return int 0
+ */
+int at_query_modules(void)
+{
+	if (gnss_ok)
+	{
+		AT_PRINTF("+EVT:GNSS OK\n");
+	}
+	else
+	{
+		AT_PRINTF("+EVT:GNSS FAIL\n");
+	}
+	if (acc_ok)
+	{
+		AT_PRINTF("+EVT:ACC OK\n");
+	}
+	else
+	{
+		AT_PRINTF("+EVT:ACC FAIL\n");
+	}
+	if (has_env_sensor)
+	{
+		AT_PRINTF("+EVT:ENV OK\n");
+	}
+	else
+	{
+		AT_PRINTF("+EVT:ENV FAIL\n");
+	}
+
+	return 0;
+}
+
+/**
+ * @brief List of all available commands with short help and pointer to functions
+ *
+ */
+atcmd_t g_user_at_cmd_list_modules[] = {
+	/*|    CMD    |     AT+CMD?      |    AT+CMD=?    |  AT+CMD=value |  AT+CMD  |*/
+	// Module commands
+	{"+MOD", "List all connected I2C devices", at_query_modules, NULL, at_query_modules, "RW"},
+};
+
+/*****************************************
+ * GNSS & ACC AT commands
+ *****************************************/
+
+/**
+ * @brief Returns in g_at_query_buf the current settings for the GNSS precision
+ *
+ * @return int always 0
+ */
+static int at_query_gnss()
+{
+	if (g_is_helium)
+	{
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "GPS precision: 2");
+	}
+	else if (g_is_compact)
+	{
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "GPS precision: 3");
+	}
+	else
+	{
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "GPS precision: %d", g_gps_prec_6 ? 1 : 0);
+	}
+	return 0;
+}
+
+/**
+ * @brief Command to set the GNSS precision
+ *
+ * @param str Either '0' or '1' or '2' or '3'
+ *  '0' sets the precission to 4 digits
+ *  '1' sets the precission to 6 digits
+ *  '2' sets the dataformat to Helium Mapper
+ *  '3' sets the dataformat to compact bit-packed format
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_gnss(char *str)
+{
+	if (str[0] == '0')
+	{
+		g_is_helium = false;
+		g_is_compact = false;
+		g_gps_prec_6 = false;
+		save_gps_settings();
+	}
+	else if (str[0] == '1')
+	{
+		g_is_helium = false;
+		g_is_compact = false;
+		g_gps_prec_6 = true;
+		save_gps_settings();
+	}
+	else if (str[0] == '2')
+	{
+		g_is_helium = true;
+		g_is_compact = false;
+		save_gps_settings();
+	}
+	else if (str[0] == '3')
+	{
+		g_is_helium = false;
+		g_is_compact = true;
+		save_gps_settings();
+	}
+	else
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the current settings for the ACC payload
+ *
+ * @return int always 0
+ */
+static int at_query_acc()
+{
+	if (g_submit_acc)
+	{
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "ACC values in payload");
+	}
+	else
+	{
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "ACC values not in payload");
+	}
+	return 0;
+}
+
+/**
+ * @brief Command to set whether the ACC values are in the payload
+ *
+ * @param str Either '0' or '1'
+ *  '0' no ACC values in payload
+ *  '1' add ACC values in payload
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_acc(char *str)
+{
+	if (str[0] == '0')
+	{
+		g_submit_acc = false;
+		save_gps_settings();
+	}
+	else if (str[0] == '1')
+	{
+		g_submit_acc = true;
+		save_gps_settings();
+	}
+	else
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the current settings for the location acquistion precision
+ *
+ * @return int always 0
+ */
+static int at_query_gnss_prec()
+{
+	if (g_loc_high_prec)
+	{
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "Acquistion requirements high");
+	}
+	else
+	{
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "Acquistion requirements low");
+	}
+	return 0;
+}
+
+/**
+ * @brief Command to set whether the location acquistion precision is high or low
+ *
+ * @param str Either '0' or '1'
+ *  '0' low acquistion requirement, only 3D fix required
+ *  '1' high acquistion requirement, GPS fix and at least 6 satellites required
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_gnss_prec(char *str)
+{
+	if (str[0] == '0')
+	{
+		g_loc_high_prec = false;
+		save_gps_settings();
+	}
+	else if (str[0] == '1')
+	{
+		g_loc_high_prec = true;
+		save_gps_settings();
+	}
+	else
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the keyframe interval of the delta mode
+ *
+ * @return int always 0
+ */
+static int at_query_delta()
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "Delta keyframe interval: %d", g_delta_interval);
+	return 0;
+}
+
+/**
+ * @brief Command to set the keyframe interval of the delta mode
+ *
+ * @param str 0 = delta mode off, 1 .. 15 = every nth location is sent as keyframe
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_delta(char *str)
+{
+	char *end;
+	long interval = strtol(str, &end, 0);
+	if ((end == str) || (interval < 0) || (interval >= TC_SEQ_NUM))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_delta_interval = (uint8_t)interval;
+	save_delta_setting();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the number of locations in a batch
+ *
+ * @return int always 0
+ */
+static int at_query_batch()
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "Batch size: %d, collected %d", g_batch_size, batch_count());
+	return 0;
+}
+
+/**
+ * @brief Command to set the number of locations in a batch
+ *
+ * @param str 0 = batch mode off, 2 .. BATCH_MAX_POINTS = number of locations in a batch
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_batch(char *str)
+{
+	char *end;
+	long size = strtol(str, &end, 0);
+	if ((end == str) || (size < 0) || (size == 1) || (size > BATCH_MAX_POINTS))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_batch_size = (uint8_t)size;
+	save_batch_setting();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the tolerance and statistics of the track simplification
+ *
+ * @return int always 0
+ */
+static int at_query_simplify()
+{
+	batch_simplify_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to set the tolerance of the track simplification
+ *
+ * @param str 0 = track simplification off, 1 .. 1000 = tolerance in m
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_simplify(char *str)
+{
+	char *end;
+	long tolerance = strtol(str, &end, 0);
+	if ((end == str) || (tolerance < 0) || (tolerance > 1000))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_simplify_tolerance = (uint16_t)tolerance;
+	save_simplify_setting();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the airtime budget and the used airtime
+ *
+ * @return int always 0
+ */
+static int at_query_airtime()
+{
+	airtime_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to set the airtime budget
+ *
+ * @param str <budget>,<window>[,<payload>]
+ *        budget 0 = off, 1 .. 3600000 ms airtime per window
+ *        window 1 .. 1440 minutes
+ *        payload 0 = don't add, 1 = add the used airtime to the payload
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_airtime(char *str)
+{
+	char *end;
+	long budget = strtol(str, &end, 0);
+	if ((end == str) || (*end != ',') || (budget < 0) || (budget > 3600000))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	char *param = end + 1;
+	long window = strtol(param, &end, 0);
+	if ((end == param) || (window < 1) || (window > 1440))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	long payload = g_airtime_payload ? 1 : 0;
+	if (*end == ',')
+	{
+		param = end + 1;
+		payload = strtol(param, &end, 0);
+		if ((end == param) || (payload < 0) || (payload > 1))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+	}
+	g_airtime_budget = (uint32_t)budget;
+	g_airtime_window = (uint16_t)window;
+	g_airtime_payload = payload == 1;
+	save_airtime_setting();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the interval table and the current send interval
+ *
+ * @return int always 0
+ */
+static int at_query_adapt()
+{
+	adapt_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to set the interval table of the adaptive send interval
+ *
+ * @param str 0 = fixed send interval or <parked>,<speed>:<interval>[,<speed>:<interval> ...]
+ *        parked 0 = use the first step, 10 .. 86400 s interval if the tracker does not move
+ *        speed 0 .. 500 km/h, ascending, the first step is used below its speed as well
+ *        interval 10 .. 86400 s
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_adapt(char *str)
+{
+	adapt_settings_s settings;
+	char *end;
+	long parked = strtol(str, &end, 0);
+	if ((end == str) || (parked < 0) || (parked > 86400) || ((parked != 0) && (parked < 10)))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	settings.parked = (uint32_t)parked;
+	while (*end == ',')
+	{
+		char *param = end + 1;
+		long speed = strtol(param, &end, 0);
+		if ((end == param) || (*end != ':') || (speed < 0) || (speed > 500) || (settings.steps_num == ADAPT_MAX_STEPS))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+		if ((settings.steps_num != 0) && (speed <= settings.steps[settings.steps_num - 1].speed))
+		{
+			// Steps have to be sorted by speed
+			return AT_ERRNO_PARA_VAL;
+		}
+		param = end + 1;
+		long interval = strtol(param, &end, 0);
+		if ((end == param) || (interval < 10) || (interval > 86400))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+		settings.steps[settings.steps_num].speed = (uint16_t)speed;
+		settings.steps[settings.steps_num].interval = (uint32_t)interval;
+		settings.steps_num++;
+	}
+	if ((*end != 0) || ((settings.steps_num == 0) && (parked != 0)))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_adapt_settings = settings;
+	adapt_reset();
+	save_adapt_setting();
+	if (g_lorawan_settings.send_repeat_time != 0)
+	{
+		sched_send_restart(adapt_interval());
+	}
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the distance filter settings
+ *
+ * @return int always 0
+ */
+static int at_query_filter()
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d,%d", g_filter_distance, g_filter_time);
+	return 0;
+}
+
+/**
+ * @brief Command to set the distance filter
+ *
+ * @param str <distance>[,<time>]
+ *        distance 0 = off, 1 .. 10000 m minimum distance to the last sent location
+ *        time 0 = no limit, 1 .. 1440 minutes maximum time between two uplinks
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_filter(char *str)
+{
+	char *end;
+	long distance = strtol(str, &end, 0);
+	if ((end == str) || (distance < 0) || (distance > 10000))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	long time = 0;
+	if (*end == ',')
+	{
+		char *param = end + 1;
+		time = strtol(param, &end, 0);
+		if ((end == param) || (time < 0) || (time > 1440))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+	}
+	g_filter_distance = (uint16_t)distance;
+	g_filter_time = (uint16_t)time;
+	gnss_motion();
+	save_filter_setting();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the maximum age of a cached location
+ *
+ * @return int always 0
+ */
+static int at_query_cache()
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_cache_max_age);
+	return 0;
+}
+
+/**
+ * @brief Command to set the maximum age of a cached location
+ *
+ * @param str 0 = always search the location, 1 .. 1440 minutes
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_cache(char *str)
+{
+	char *end;
+	long age = strtol(str, &end, 0);
+	if ((end == str) || (age < 0) || (age > 1440))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_cache_max_age = (uint16_t)age;
+	save_cache_setting();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the maximum age of the location sent on an ACC trigger
+ *
+ * @return int always 0
+ */
+static int at_query_motion()
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_motion_fix_age);
+	return 0;
+}
+
+/**
+ * @brief Command to set the maximum age of the location sent immediately on an ACC trigger
+ *
+ * @param str 0 = off, 1 .. 1440 minutes
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_motion(char *str)
+{
+	char *end;
+	long age = strtol(str, &end, 0);
+	if ((end == str) || (age < 0) || (age > 1440))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_motion_fix_age = (uint16_t)age;
+	save_motion_setting();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the status of the geofences
+ *
+ * @return int always 0
+ */
+static int at_query_fence()
+{
+	geofence_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to upload the geofence index
  *
- * @return int 0
+ * @param str 0 = delete the index, 1 = load the uploaded index
+ *        or <offset>,<hex data> = write a part of the index, offset 0 starts a new index
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong or the index is invalid
  */
-int at_query_modules(void)
+static int at_exec_fence(char *str)
 {
-	if (gnss_ok)
+	char *end;
+	long offset = strtol(str, &end, 0);
+	if ((end == str) || (offset < 0))
 	{
-		AT_PRINTF("+EVT:GNSS OK\n");
-	}
-	else
-	{
-		AT_PRINTF("+EVT:GNSS FAIL\n");
+		return AT_ERRNO_PARA_VAL;
 	}
-	if (acc_ok)
+	if (*end == 0)
 	{
-		AT_PRINTF("+EVT:ACC OK\n");
+		if (offset == 0)
+		{
+			geofence_clear();
+			return 0;
+		}
+		if (offset == 1)
+		{
+			return init_geofence() ? 0 : AT_ERRNO_PARA_VAL;
+		}
+		return AT_ERRNO_PARA_VAL;
 	}
-	else
+	if (*end != ',')
 	{
-		AT_PRINTF("+EVT:ACC FAIL\n");
+		return AT_ERRNO_PARA_VAL;
 	}
-	if (has_env_sensor)
+
+	// Convert the hex data
+	char *hex = end + 1;
+	uint8_t data[128];
+	uint16_t len = 0;
+	while ((hex[0] != 0) && (hex[1] != 0) && (len < sizeof(data)))
 	{
-		AT_PRINTF("+EVT:ENV OK\n");
+		char byte_str[3] = {hex[0], hex[1], 0};
+		data[len++] = (uint8_t)strtol(byte_str, &end, 16);
+		if (end != &byte_str[2])
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+		hex += 2;
 	}
-	else
+	if ((hex[0] != 0) || (len == 0))
 	{
-		AT_PRINTF("+EVT:ENV FAIL\n");
+		return AT_ERRNO_PARA_VAL;
 	}
-
-	return 0;
+	return geofence_write((uint32_t)offset, data, len) ? 0 : AT_ERRNO_PARA_VAL;
 }
 
 /**
- * @brief List of all available commands with short help and pointer to functions
+ * @brief Returns in g_at_query_buf the settings and statistics of the Helium Mapper cell deduplication
  *
+ * @return int always 0
  */
-atcmd_t g_user_at_cmd_list_modules[] = {
-	/*|    CMD    |     AT+CMD?      |    AT+CMD=?    |  AT+CMD=value |  AT+CMD  |*/
-	// Module commands
-	{"+MOD", "List all connected I2C devices", at_query_modules, NULL, at_query_modules, "RW"},
-};
-
-/*****************************************
- * GNSS & ACC AT commands
- *****************************************/
+static int at_query_mapcell()
+{
+	mapper_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
 
 /**
- * @brief Returns in g_at_query_buf the current settings for the GNSS precision
+ * @brief Command to set the Helium Mapper cell deduplication
  *
- * @return int always 0
+ * @param str <resolution>[,<window>]
+ *        resolution 0 = off, 5 .. 12 hexagon cell resolution (8 = ~460 m edge length)
+ *        window 1 .. 1440 minutes before a cell is mapped again
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
  */
-static int at_query_gnss()
+static int at_exec_mapcell(char *str)
 {
-	if (g_is_helium)
+	char *end;
+	long res = strtol(str, &end, 0);
+	if ((end == str) || (res < 0) || ((res != 0) && ((res < 5) || (res > 12))))
 	{
-		snprintf(g_at_query_buf, ATQUERY_SIZE, "GPS precision: 2");
+		return AT_ERRNO_PARA_VAL;
 	}
-	else
+	long window = g_mapper_window;
+	if (*end == ',')
 	{
-		snprintf(g_at_query_buf, ATQUERY_SIZE, "GPS precision: %d", g_gps_prec_6 ? 1 : 0);
+		char *param = end + 1;
+		window = strtol(param, &end, 0);
+		if ((end == param) || (window < 1) || (window > 1440))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+	}
+	if (res != g_mapper_res)
+	{
+		mapper_clear();
 	}
+	g_mapper_res = (uint8_t)res;
+	g_mapper_window = (uint16_t)window;
+	save_mapper_setting();
 	return 0;
 }
 
 /**
- * @brief Command to set the GNSS precision
+ * @brief Returns in g_at_query_buf the event counters
  *
- * @param str Either '0' or '1' or '2'
- *  '0' sets the precission to 4 digits
- *  '1' sets the precission to 6 digits
- *  '2' sets the dataformat to Helium Mapper
+ * @return int always 0
+ */
+static int at_query_events()
+{
+	app_event_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to reset the event counters
+ *
+ * @param str 0 = reset the counters
  * @return int 0 if the command was succesfull, 5 if the parameter was wrong
  */
-static int at_exec_gnss(char *str)
+static int at_exec_events(char *str)
 {
-	if (str[0] == '0')
-	{
-		g_is_helium = false;
-		g_gps_prec_6 = false;
-		save_gps_settings();
-	}
-	else if (str[0] == '1')
+	if ((str[0] != '0') || (str[1] != 0))
 	{
-		g_is_helium = false;
-		g_gps_prec_6 = true;
-		save_gps_settings();
+		return AT_ERRNO_PARA_VAL;
 	}
-	else if (str[0] == '2')
+	app_event_reset();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the latencies of the sensor acquisition stages
+ *
+ * @return int always 0
+ */
+static int at_query_pipe()
+{
+	pipe_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to reset the latencies of the sensor acquisition stages
+ *
+ * @param str 0 = reset the latencies
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_pipe(char *str)
+{
+	if ((str[0] != '0') || (str[1] != 0))
 	{
-		g_is_helium = true;
-		save_gps_settings();
+		return AT_ERRNO_PARA_VAL;
 	}
-	else
+	pipe_reset();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the heap statistics and the stack high water marks
+ *
+ * @return int always 0
+ */
+static int at_query_mem()
+{
+	mem_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to add the memory telemetry to the payload
+ *
+ * @param str 0 = don't add, 1 = add the minimum free heap and the lowest stack high water mark
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_mem(char *str)
+{
+	if (((str[0] != '0') && (str[0] != '1')) || (str[1] != 0))
 	{
 		return AT_ERRNO_PARA_VAL;
 	}
+	g_mem_payload = str[0] == '1';
+	save_mem_setting();
 	return 0;
 }
 
 /**
- * @brief Returns in g_at_query_buf the current settings for the ACC payload
+ * @brief Returns in g_at_query_buf the estimated consumption
  *
  * @return int always 0
  */
-static int at_query_acc()
+static int at_query_energy()
 {
-	if (g_submit_acc)
+	energy_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to restart the energy accounting
+ *
+ * @param str 0 = reset the accounted times
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_energy(char *str)
+{
+	if ((str[0] != '0') || (str[1] != 0))
 	{
-		snprintf(g_at_query_buf, ATQUERY_SIZE, "ACC values in payload");
+		return AT_ERRNO_PARA_VAL;
 	}
-	else
+	energy_reset();
+	return 0;
+}
+
+/**
+ * @brief Returns in g_at_query_buf the currents of the energy accounting
+ *
+ * @return int always 0
+ */
+static int at_query_current()
+{
+	int len = 0;
+	for (uint8_t state = 0; state < ENERGY_NUM_STATES; state++)
 	{
-		snprintf(g_at_query_buf, ATQUERY_SIZE, "ACC values not in payload");
+		len += snprintf(&g_at_query_buf[len], ATQUERY_SIZE - len, "%s%ld", state == 0 ? "" : ",", (long)g_energy_current[state]);
 	}
 	return 0;
 }
 
 /**
- * @brief Command to set whether the ACC values are in the payload
+ * @brief Command to set the currents of the energy accounting
  *
- * @param str Either '0' or '1'
- *  '0' no ACC values in payload
- *  '1' add ACC values in payload
+ * @param str <sleep>,<cpu>,<gnss>,<tx>,<rx>,<bme>,<acc> currents in uA, 0 to 500000
+ *        0 = set the default currents
  * @return int 0 if the command was succesfull, 5 if the parameter was wrong
  */
-static int at_exec_acc(char *str)
+static int at_exec_current(char *str)
 {
-	if (str[0] == '0')
-	{
-		g_submit_acc = false;
-		save_gps_settings();
-	}
-	else if (str[0] == '1')
+	if ((str[0] == '0') && (str[1] == 0))
 	{
-		g_submit_acc = true;
-		save_gps_settings();
+		memcpy(g_energy_current, g_energy_default, sizeof(g_energy_current));
+		save_current_setting();
+		return 0;
 	}
-	else
+	uint32_t current[ENERGY_NUM_STATES];
+	char *param = str;
+	char *end;
+	for (uint8_t state = 0; state < ENERGY_NUM_STATES; state++)
 	{
-		return AT_ERRNO_PARA_VAL;
+		long value = strtol(param, &end, 0);
+		if ((end == param) || (value < 0) || (value > 500000))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+		if (*end != (state < ENERGY_NUM_STATES - 1 ? ',' : 0))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+		current[state] = (uint32_t)value;
+		param = end + 1;
 	}
+	memcpy(g_energy_current, current, sizeof(g_energy_current));
+	save_current_setting();
 	return 0;
 }
 
+#if TRACE_SIZE > 0
 /**
- * @brief Returns in g_at_query_buf the current settings for the location acquistion precision
+ * @brief Returns in g_at_query_buf the number of trace entries
  *
  * @return int always 0
  */
-static int at_query_gnss_prec()
+static int at_query_trace()
 {
-	if (g_loc_high_prec)
-	{
-		snprintf(g_at_query_buf, ATQUERY_SIZE, "Acquistion requirements high");
-	}
-	else
-	{
-		snprintf(g_at_query_buf, ATQUERY_SIZE, "Acquistion requirements low");
-	}
+	trace_status(g_at_query_buf, ATQUERY_SIZE);
 	return 0;
 }
 
 /**
- * @brief Command to set whether the location acquistion precision is high or low
+ * @brief Command to dump or clear the latency trace
  *
- * @param str Either '0' or '1'
- *  '0' low acquistion requirement, only 3D fix required
- *  '1' high acquistion requirement, GPS fix and at least 6 satellites required
+ * @param str 0 = clear, 1 = dump as +TRACE: hex lines
  * @return int 0 if the command was succesfull, 5 if the parameter was wrong
  */
-static int at_exec_gnss_prec(char *str)
+static int at_exec_trace(char *str)
 {
-	if (str[0] == '0')
+	if (((str[0] != '0') && (str[0] != '1')) || (str[1] != 0))
 	{
-		g_loc_high_prec = false;
-		save_gps_settings();
+		return AT_ERRNO_PARA_VAL;
 	}
-	else if (str[0] == '1')
+	if (str[0] == '0')
 	{
-		g_loc_high_prec = true;
-		save_gps_settings();
+		trace_clear();
 	}
 	else
 	{
-		return AT_ERRNO_PARA_VAL;
+		trace_dump();
 	}
 	return 0;
 }
+#endif
 
 /**
  * @brief Read saved setting for precision and packet format
@@ -264,6 +1120,147 @@ void read_gps_settings(void)
 		g_is_helium = false;
 		MYLOG("USR_AT", "File not found, set Cayenne LPP format");
 	}
+	if (InternalFS.exists(compact_format))
+	{
+		g_is_compact = true;
+		MYLOG("USR_AT", "File found, set compact format");
+	}
+	else
+	{
+		g_is_compact = false;
+		MYLOG("USR_AT", "File not found, no compact format");
+	}
+	g_delta_interval = 0;
+	if (gps_file.open(delta_name, FILE_O_READ))
+	{
+		gps_file.read(&g_delta_interval, 1);
+		gps_file.close();
+		if (g_delta_interval >= TC_SEQ_NUM)
+		{
+			g_delta_interval = TC_SEQ_NUM - 1;
+		}
+		MYLOG("USR_AT", "File found, delta keyframe interval %d", g_delta_interval);
+	}
+	g_batch_size = 0;
+	if (gps_file.open(batch_name, FILE_O_READ))
+	{
+		gps_file.read(&g_batch_size, 1);
+		gps_file.close();
+		if (g_batch_size > BATCH_MAX_POINTS)
+		{
+			g_batch_size = BATCH_MAX_POINTS;
+		}
+		MYLOG("USR_AT", "File found, batch size %d", g_batch_size);
+	}
+	g_simplify_tolerance = 0;
+	if (gps_file.open(simplify_name, FILE_O_READ))
+	{
+		gps_file.read(&g_simplify_tolerance, sizeof(g_simplify_tolerance));
+		gps_file.close();
+		if (g_simplify_tolerance > 1000)
+		{
+			g_simplify_tolerance = 1000;
+		}
+		MYLOG("USR_AT", "File found, track simplification %d m", g_simplify_tolerance);
+	}
+	g_airtime_budget = 0;
+	g_airtime_window = 60;
+	g_airtime_payload = false;
+	if (gps_file.open(airtime_name, FILE_O_READ))
+	{
+		gps_file.read(&g_airtime_budget, sizeof(g_airtime_budget));
+		gps_file.read(&g_airtime_window, sizeof(g_airtime_window));
+		gps_file.read(&g_airtime_payload, sizeof(g_airtime_payload));
+		gps_file.close();
+		if ((g_airtime_window == 0) || (g_airtime_window > 1440))
+		{
+			g_airtime_window = 60;
+		}
+		MYLOG("USR_AT", "File found, airtime budget %ld ms in %d min", (long)g_airtime_budget, g_airtime_window);
+	}
+	g_filter_distance = 0;
+	g_filter_time = 0;
+	if (gps_file.open(filter_name, FILE_O_READ))
+	{
+		gps_file.read(&g_filter_distance, sizeof(g_filter_distance));
+		gps_file.read(&g_filter_time, sizeof(g_filter_time));
+		gps_file.close();
+		if (g_filter_distance > 10000)
+		{
+			g_filter_distance = 10000;
+		}
+		if (g_filter_time > 1440)
+		{
+			g_filter_time = 1440;
+		}
+		MYLOG("USR_AT", "File found, distance filter %d m, %d min", g_filter_distance, g_filter_time);
+	}
+	g_cache_max_age = 0;
+	if (gps_file.open(cache_name, FILE_O_READ))
+	{
+		gps_file.read(&g_cache_max_age, sizeof(g_cache_max_age));
+		gps_file.close();
+		if (g_cache_max_age > 1440)
+		{
+			g_cache_max_age = 1440;
+		}
+		MYLOG("USR_AT", "File found, cached location up to %d min", g_cache_max_age);
+	}
+	g_motion_fix_age = 0;
+	if (gps_file.open(motion_name, FILE_O_READ))
+	{
+		gps_file.read(&g_motion_fix_age, sizeof(g_motion_fix_age));
+		gps_file.close();
+		if (g_motion_fix_age > 1440)
+		{
+			g_motion_fix_age = 1440;
+		}
+		MYLOG("USR_AT", "File found, location on ACC trigger up to %d min", g_motion_fix_age);
+	}
+	g_mapper_res = 0;
+	g_mapper_window = 60;
+	if (gps_file.open(mapper_name, FILE_O_READ))
+	{
+		gps_file.read(&g_mapper_res, sizeof(g_mapper_res));
+		gps_file.read(&g_mapper_window, sizeof(g_mapper_window));
+		gps_file.close();
+		if ((g_mapper_res != 0) && ((g_mapper_res < 5) || (g_mapper_res > 12)))
+		{
+			g_mapper_res = 0;
+		}
+		if ((g_mapper_window == 0) || (g_mapper_window > 1440))
+		{
+			g_mapper_window = 60;
+		}
+		MYLOG("USR_AT", "File found, mapper cells resolution %d, %d min", g_mapper_res, g_mapper_window);
+	}
+	g_mem_payload = false;
+	if (gps_file.open(mem_name, FILE_O_READ))
+	{
+		gps_file.read(&g_mem_payload, sizeof(g_mem_payload));
+		gps_file.close();
+		MYLOG("USR_AT", "File found, memory telemetry %s", g_mem_payload ? "on" : "off");
+	}
+	memcpy(g_energy_current, g_energy_default, sizeof(g_energy_current));
+	if (gps_file.open(current_name, FILE_O_READ))
+	{
+		if (gps_file.read(g_energy_current, sizeof(g_energy_current)) != sizeof(g_energy_current))
+		{
+			memcpy(g_energy_current, g_energy_default, sizeof(g_energy_current));
+		}
+		gps_file.close();
+		MYLOG("USR_AT", "File found, currents of the energy accounting");
+	}
+	g_adapt_settings.steps_num = 0;
+	if (gps_file.open(adapt_name, FILE_O_READ))
+	{
+		if ((gps_file.read(&g_adapt_settings, sizeof(g_adapt_settings)) != sizeof(g_adapt_settings)) || (g_adapt_settings.steps_num > ADAPT_MAX_STEPS))
+		{
+			g_adapt_settings.steps_num = 0;
+		}
+		gps_file.close();
+		MYLOG("USR_AT", "File found, adaptive interval with %d steps", g_adapt_settings.steps_num);
+	}
 	if (InternalFS.exists(submit_acc))
 	{
 		g_submit_acc = false;
@@ -318,6 +1315,19 @@ void save_gps_settings(void)
 		InternalFS.remove(helium_format);
 		MYLOG("USR_AT", "Remove File for Helium Mapper format");
 	}
+	// Save flag if compact format is selected
+	if (g_is_compact)
+	{
+		gps_file.open(compact_format, FILE_O_WRITE);
+		gps_file.write("1");
+		gps_file.close();
+		MYLOG("USR_AT", "Created File for compact format");
+	}
+	else
+	{
+		InternalFS.remove(compact_format);
+		MYLOG("USR_AT", "Remove File for compact format");
+	}
 	if (g_submit_acc)
 	{
 		InternalFS.remove(submit_acc);
@@ -351,9 +1361,27 @@ void save_gps_settings(void)
 atcmd_t g_user_at_cmd_list_gps[] = {
 	/*|    CMD    |     AT+CMD?      |    AT+CMD=?    |  AT+CMD=value |  AT+CMD  |*/
 	// GNSS commands
-	{"+GNSS", "Get/Set the GNSS precision and format 0 = 4 digit, 1 = 6 digit, 2 = Helium Mapper", at_query_gnss, at_exec_gnss, NULL, "RW"},
+	{"+GNSS", "Get/Set the GNSS precision and format 0 = 4 digit, 1 = 6 digit, 2 = Helium Mapper, 3 = compact", at_query_gnss, at_exec_gnss, NULL, "RW"},
 	{"+PREC", "Get/Set the GNSS acquisition precision 0 = only fix type 3D, 1 = fix type 3D and >= 6 satellites", at_query_gnss_prec, at_exec_gnss_prec, NULL, "RW"},
 	{"+ACC", "Get/Set whether ACC values are included in the payload", at_query_acc, at_exec_acc, NULL, "RW"},
+	{"+DELTA", "Get/Set the keyframe interval of the delta location mode (compact format), 0 = off, 1..15", at_query_delta, at_exec_delta, NULL, "RW"},
+	{"+BATCH", "Get/Set the number of locations sent in one batch frame (compact format), 0 = off, 2..32", at_query_batch, at_exec_batch, NULL, "RW"},
+	{"+SIMPLIFY", "Get/Set the track simplification tolerance in m for the batch mode, 0 = off, 1..1000", at_query_simplify, at_exec_simplify, NULL, "RW"},
+	{"+AIRTIME", "Get/Set the airtime budget <ms per window, 0 = off>,<window in min>[,<add used airtime to payload 0/1>]", at_query_airtime, at_exec_airtime, NULL, "RW"},
+	{"+ADAPT", "Get/Set the adaptive send interval 0 = off or <parked s>,<km/h>:<s>[,<km/h>:<s> ...]", at_query_adapt, at_exec_adapt, NULL, "RW"},
+	{"+FILTER", "Get/Set the distance filter <m, 0 = off>[,<max minutes between uplinks, 0 = no limit>]", at_query_filter, at_exec_filter, NULL, "RW"},
+	{"+CACHE", "Get/Set the maximum age of a cached location in minutes if the tracker did not move, 0 = off, 1..1440", at_query_cache, at_exec_cache, NULL, "RW"},
+	{"+MOTIONFIX", "Get/Set the maximum age in minutes of the last location sent immediately on an ACC trigger, 0 = off, 1..1440", at_query_motion, at_exec_motion, NULL, "RW"},
+	{"+FENCE", "Get the geofence status, set 0 = delete, 1 = load the index, <offset>,<hex> = upload a part of the index", at_query_fence, at_exec_fence, NULL, "RW"},
+	{"+MAPCELL", "Get/Set the Helium Mapper cell deduplication <resolution 0 = off, 5..12>[,<minutes before a cell is mapped again>]", at_query_mapcell, at_exec_mapcell, NULL, "RW"},
+	{"+EVENTS", "Get the event counters <handled>/<posted>/<coalesced>[/<lost>] per event, set 0 = reset the counters", at_query_events, at_exec_events, NULL, "RW"},
+	{"+PIPE", "Get the latencies of the sensor acquisition <last ms>/<max ms>/<timeouts> per stage, set 0 = reset", at_query_pipe, at_exec_pipe, NULL, "RW"},
+	{"+MEM", "Get the heap <free>/<min>/<largest> in bytes and the stack high water mark in words per task, set 1 = add to payload, 0 = don't add", at_query_mem, at_exec_mem, NULL, "RW"},
+	{"+ENERGY", "Get the estimated consumption in mAh per day, total and per state, set 0 = reset", at_query_energy, at_exec_energy, NULL, "RW"},
+	{"+CURRENT", "Get/Set the currents in uA <sleep>,<cpu>,<gnss>,<tx>,<rx>,<bme>,<acc>, set 0 = defaults", at_query_current, at_exec_current, NULL, "RW"},
+#if TRACE_SIZE > 0
+	{"+TRACE", "Get the number of latency trace entries, set 1 = dump the trace, 0 = clear", at_query_trace, at_exec_trace, NULL, "RW"},
+#endif
 };
 
 /*****************************************
@@ -458,12 +1486,59 @@ atcmd_t g_user_at_cmd_list_batt[] = {
 	{"+BATCHK", "Enable/Disable the battery charge check", at_query_batt_check, at_set_batt_check, at_query_batt_check, "RW"},
 };
 
+/*****************************************
+ * Store and forward queue AT commands
+ *****************************************/
+
+/**
+ * @brief Returns in g_at_query_buf the status of the store and forward queue
+ *
+ * @return int always 0
+ */
+static int at_query_queue(void)
+{
+	fq_status(g_at_query_buf, ATQUERY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief Command to clear the store and forward queue
+ *
+ * @param str '0' clears the queue
+ * @return int 0 if the command was succesfull, 5 if the parameter was wrong
+ */
+static int at_exec_queue(char *str)
+{
+	if (str[0] == '0')
+	{
+		fq_clear();
+	}
+	else
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	return 0;
+}
+
+atcmd_t g_user_at_cmd_list_queue[] = {
+	/*|    CMD    |     AT+CMD?      |    AT+CMD=?    |  AT+CMD=value |  AT+CMD  |*/
+	// Store and forward queue commands
+	{"+FQ", "Get the status of the unsent location queue, 0 = clear the queue", at_query_queue, at_exec_queue, NULL, "RW"},
+};
+
 /** Number of user defined AT commands */
 uint8_t g_user_at_cmd_num = 0;
 
 /** Pointer to the combined user AT command structure */
 atcmd_t *g_user_at_cmd_list;
 
+#if STATIC_MEM > 0
+/** Combined user AT command structure for the static memory mode */
+static atcmd_t user_at_cmd_static[(sizeof(g_user_at_cmd_list_gps) + sizeof(g_user_at_cmd_list_batt) +
+								   sizeof(g_user_at_cmd_list_modules) + sizeof(g_user_at_cmd_list_queue)) /
+								  sizeof(atcmd_t)];
+#endif
+
 /**
  * @brief Initialize the user defined AT command list
  *
@@ -477,9 +1552,15 @@ void init_user_at(void)
 	MYLOG("USR_AT", "Structure size %d Battery", required_structure_size);
 	required_structure_size += sizeof(g_user_at_cmd_list_modules);
 	MYLOG("USR_AT", "Structure size %d Modules", required_structure_size);
+	required_structure_size += sizeof(g_user_at_cmd_list_queue);
+	MYLOG("USR_AT", "Structure size %d Queue", required_structure_size);
 
 	// Reserve memory for the structure
+#if STATIC_MEM > 0
+	g_user_at_cmd_list = user_at_cmd_static;
+#else
 	g_user_at_cmd_list = (atcmd_t *)malloc(required_structure_size);
+#endif
 
 	// Add AT commands to structure
 	MYLOG("USR_AT", "Adding battery check AT commands");
@@ -499,6 +1580,12 @@ void init_user_at(void)
 	memcpy((void *)&g_user_at_cmd_list[index_next_cmds], (void *)g_user_at_cmd_list_gps, sizeof(g_user_at_cmd_list_gps));
 	index_next_cmds += sizeof(g_user_at_cmd_list_gps) / sizeof(atcmd_t);
 	MYLOG("USR_AT", "Index after adding GNSS %d", index_next_cmds);
+
+	MYLOG("USR_AT", "Adding queue user AT commands");
+	g_user_at_cmd_num += sizeof(g_user_at_cmd_list_queue) / sizeof(atcmd_t);
+	memcpy((void *)&g_user_at_cmd_list[index_next_cmds], (void *)g_user_at_cmd_list_queue, sizeof(g_user_at_cmd_list_queue));
+	index_next_cmds += sizeof(g_user_at_cmd_list_queue) / sizeof(atcmd_t);
+	MYLOG("USR_AT", "Index after adding queue %d", index_next_cmds);
 }
 
 // /** Number of user defined AT commands */
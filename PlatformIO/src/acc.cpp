@@ -12,8 +12,11 @@
 
 void acc_int_callback(void);
 
+/** I2C address of the LIS3DH sensor */
+#define ACC_ADDR 0x18
+
 /** The LIS3DH sensor */
-LIS3DH acc_sensor(I2C_MODE, 0x18);
+LIS3DH acc_sensor(I2C_MODE, ACC_ADDR);
 
 /** Flag if ACC values should be included in the payload */
 bool g_submit_acc = false;
@@ -33,7 +36,8 @@ bool init_acc(void)
 	// Setup interrupt pin
 	pinMode(INT1_PIN, INPUT);
 
-	Wire.begin();
+	// The I2C bus is started by init_i2c_bus(), the GNSS task might use it already
+	i2c_lock();
 
 	acc_sensor.settings.accelSampleRate = 10; //Hz.  Can be: 0,1,10,25,50,100,200,400,1600,5000 Hz
 	acc_sensor.settings.accelRange = 2;		  //Max G force readable.  Can be: 2, 4, 8, 16
@@ -46,6 +50,7 @@ bool init_acc(void)
 
 	if (acc_sensor.begin() != 0)
 	{
+		i2c_unlock();
 		MYLOG("ACC", "ACC sensor initialization failed");
 		return false;
 	}
@@ -104,6 +109,7 @@ bool init_acc(void)
 	delay(100);
 
 	clear_acc_int();
+	i2c_unlock();
 
 	// Set the interrupt callback function
 	attachInterrupt(INT1_PIN, acc_int_callback, RISING);
@@ -118,9 +124,16 @@ bool init_acc(void)
  */
 void read_acc(void)
 {
-	float acc_x_f = acc_sensor.readFloatAccelX();
-	float acc_y_f = acc_sensor.readFloatAccelY();
-	float acc_z_f = acc_sensor.readFloatAccelZ();
+	// X, Y and Z in one transfer, OUT_X_L to OUT_Z_H
+	uint8_t acc_raw[6] = {0};
+	if (!i2c_read_regs(ACC_ADDR, LIS3DH_OUT_X_L, acc_raw, 6, true))
+	{
+		MYLOG("ACC", "ACC read failed");
+		return;
+	}
+	float acc_x_f = acc_sensor.calcAccel((int16_t)(acc_raw[0] | (acc_raw[1] << 8)));
+	float acc_y_f = acc_sensor.calcAccel((int16_t)(acc_raw[2] | (acc_raw[3] << 8)));
+	float acc_z_f = acc_sensor.calcAccel((int16_t)(acc_raw[4] | (acc_raw[5] << 8)));
 
 	int16_t acc_x = (int16_t)(acc_x_f * 1000.0);
 	int16_t acc_y = (int16_t)(acc_y_f * 1000.0);
@@ -132,7 +145,10 @@ void read_acc(void)
 
 	if (g_submit_acc)
 	{
-		g_data_packet.addAccelerometer(LPP_ACC, acc_x_f, acc_y_f, acc_z_f);
+		g_tracker_data.acc_x = acc_x_f;
+		g_tracker_data.acc_y = acc_y_f;
+		g_tracker_data.acc_z = acc_z_f;
+		g_tracker_data.valid |= 1 << PAYLOAD_ACC;
 	}
 }
 
@@ -143,7 +159,8 @@ void read_acc(void)
  */
 void acc_int_callback(void)
 {
-	api_wake_loop(ACC_TRIGGER);
+	TRACE(TRACE_ACC_ISR);
+	app_wake(ACC_TRIGGER);
 }
 
 /**
@@ -153,5 +170,5 @@ void acc_int_callback(void)
 void clear_acc_int(void)
 {
 	uint8_t data_read;
-	acc_sensor.readRegister(&data_read, LIS3DH_INT1_SRC);
+	i2c_read_regs(ACC_ADDR, LIS3DH_INT1_SRC, &data_read, 1, false);
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+/**
+ * @file adapt.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Select the send interval from the speed and heading of the last
+ *        location and the activity of the accelerometer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Below this speed in km/h the tracker is parked if there was no ACC activity */
+#define ADAPT_PARKED_SPEED 2.0
+/** Minimum speed in km/h for the heading check, the heading is noise at lower speeds */
+#define ADAPT_TURN_SPEED 5.0
+/** Heading change in degree that shortens the interval */
+#define ADAPT_TURN_ANGLE 45.0
+
+/** Interval table, steps_num = 0 => fixed interval */
+adapt_settings_s g_adapt_settings;
+
+/** Current interval in ms, 0 = not yet selected */
+static uint32_t adapt_current = 0;
+/** Number of ACC interrupts since the last location */
+static uint16_t adapt_motion_count = 0;
+/** Heading of the last location, < 0 if unknown */
+static float adapt_last_heading = -1.0;
+/** Speed of the last location */
+static float adapt_last_speed = 0.0;
+
+/**
+ * @brief Count an ACC interrupt
+ *
+ */
+void adapt_motion(void)
+{
+	if (adapt_motion_count < 0xFFFF)
+	{
+		adapt_motion_count++;
+	}
+}
+
+/**
+ * @brief Forget the current interval, used after the interval table was changed
+ *
+ */
+void adapt_reset(void)
+{
+	adapt_current = 0;
+	adapt_last_heading = -1.0;
+}
+
+/**
+ * @brief Get the current send interval
+ *
+ * @return uint32_t interval in ms
+ */
+uint32_t adapt_interval(void)
+{
+	if ((g_adapt_settings.steps_num == 0) || (adapt_current == 0))
+	{
+		return g_lorawan_settings.send_repeat_time;
+	}
+	return adapt_current;
+}
+
+/**
+ * @brief Select the next send interval after a location search
+ *
+ * @param data collected values with the location, speed and heading
+ * @return uint32_t next interval in ms, 0 if the adaptive interval is off
+ */
+uint32_t adapt_next(tracker_data_s *data)
+{
+	uint16_t motion = adapt_motion_count;
+	adapt_motion_count = 0;
+
+	if (g_adapt_settings.steps_num == 0)
+	{
+		return 0;
+	}
+
+	bool has_fix = (data->valid & (1 << PAYLOAD_LOCATION)) != 0;
+	float speed = has_fix ? data->speed : 0.0;
+	uint32_t interval;
+
+	if ((motion == 0) && (speed < ADAPT_PARKED_SPEED) && (g_adapt_settings.parked != 0))
+	{
+		// No movement, parked
+		interval = g_adapt_settings.parked;
+		adapt_last_heading = -1.0;
+	}
+	else if (!has_fix && (adapt_current != 0))
+	{
+		// Moving but no location, keep the interval
+		return adapt_current;
+	}
+	else
+	{
+		// Highest speed step that is reached
+		uint8_t step = 0;
+		while (((step + 1) < g_adapt_settings.steps_num) && (speed >= g_adapt_settings.steps[step + 1].speed))
+		{
+			step++;
+		}
+		interval = g_adapt_settings.steps[step].interval;
+
+		// Turns need more locations for the same track fidelity
+		if (has_fix && (speed >= ADAPT_TURN_SPEED))
+		{
+			if (adapt_last_heading >= 0.0)
+			{
+				float turn = fabs(data->heading - adapt_last_heading);
+				if (turn > 180.0)
+				{
+					turn = 360.0 - turn;
+				}
+				if ((turn > ADAPT_TURN_ANGLE) && (step + 1 < g_adapt_settings.steps_num))
+				{
+					interval = g_adapt_settings.steps[step + 1].interval;
+					MYLOG("ADAPT", "Turn %.0f deg", turn);
+				}
+			}
+			adapt_last_heading = data->heading;
+		}
+		else
+		{
+			adapt_last_heading = -1.0;
+		}
+	}
+	adapt_last_speed = speed;
+
+	adapt_current = interval * 1000;
+	MYLOG("ADAPT", "Speed %.1f km/h, motion %d, interval %ld s", speed, motion, (long)interval);
+	return adapt_current;
+}
+
+/**
+ * @brief Write the interval table into a buffer
+ *
+ * @param buffer buffer for the table
+ * @param size size of the buffer
+ */
+static void adapt_table(char *buffer, size_t size)
+{
+	int len = snprintf(buffer, size, "%ld", (long)g_adapt_settings.parked);
+	for (uint8_t step = 0; (step < g_adapt_settings.steps_num) && (len > 0) && ((size_t)len < size); step++)
+	{
+		len += snprintf(&buffer[len], size - len, ",%d:%ld", g_adapt_settings.steps[step].speed, (long)g_adapt_settings.steps[step].interval);
+	}
+}
+
+/**
+ * @brief Write the status of the adaptive interval into a buffer
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void adapt_status(char *buffer, size_t size)
+{
+	char table[64];
+	adapt_table(table, sizeof(table));
+	snprintf(buffer, size, "%s, interval %ld s, speed %.1f km/h", g_adapt_settings.steps_num == 0 ? "Off" : table,
+			 (long)(adapt_interval() / 1000), adapt_last_speed);
+}
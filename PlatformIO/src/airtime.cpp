@@ -0,0 +1,262 @@
+/**
+ * @file airtime.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Time-on-air calculation and rolling airtime budget
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** LoRaWAN overhead, MHDR (1) + FHDR without FOpts (7) + FPort (1) + MIC (4) */
+#define LORAWAN_OVERHEAD 13
+
+/** Number of bins of the rolling window */
+#define AIRTIME_BINS 12
+
+/** Wake up and timing margin of the receiver per RX window in ms */
+#define AIRTIME_RX_MARGIN 10
+
+/** Airtime in ms per bin */
+static uint32_t airtime_bins[AIRTIME_BINS];
+/** Current bin */
+static uint8_t airtime_bin = 0;
+/** Start time of the current bin in ms (sched_now()) */
+static uint64_t airtime_bin_start = 0;
+
+/** Statistics */
+static uint32_t airtime_last = 0;
+static uint32_t airtime_limited = 0;
+
+/**
+ * @brief Get spreading factor and bandwidth of an uplink datarate
+ *
+ * @param data_rate datarate
+ * @param sf spreading factor
+ * @param bw bandwidth in kHz
+ * @return false if the datarate is FSK
+ */
+static bool get_dr_params(uint8_t data_rate, uint8_t *sf, uint16_t *bw)
+{
+	*bw = 125;
+	switch (g_lorawan_settings.lora_region)
+	{
+	case LORAMAC_REGION_US915:
+		if (data_rate <= 3)
+		{
+			*sf = 10 - data_rate;
+		}
+		else
+		{
+			*sf = 8;
+			*bw = 500;
+		}
+		break;
+	case LORAMAC_REGION_AU915:
+		if (data_rate <= 5)
+		{
+			*sf = 12 - data_rate;
+		}
+		else
+		{
+			*sf = 8;
+			*bw = 500;
+		}
+		break;
+	default:
+		if (data_rate <= 5)
+		{
+			*sf = 12 - data_rate;
+		}
+		else if (data_rate == 6)
+		{
+			*sf = 7;
+			*bw = 250;
+		}
+		else
+		{
+			return false;
+		}
+		break;
+	}
+	return true;
+}
+
+/**
+ * @brief Time-on-air of a LoRa packet, Semtech AN1200.13, explicit header, CRC on
+ *
+ * @param phy_size size of the packet
+ * @param sf spreading factor
+ * @param bw bandwidth in kHz
+ * @param cr coding rate 1 to 4 for 4/5 to 4/8
+ * @param preamble preamble length in symbols
+ * @return uint32_t time-on-air in us
+ */
+static uint32_t lora_toa_us(uint32_t phy_size, uint8_t sf, uint16_t bw, uint8_t cr, uint16_t preamble)
+{
+	uint32_t t_sym = ((1UL << sf) * 1000) / bw;
+	int32_t low_dr_opt = ((sf >= 11) && (bw == 125)) ? 1 : 0;
+	int32_t num = 8 * (int32_t)phy_size - 4 * sf + 28 + 16;
+	int32_t den = 4 * (sf - 2 * low_dr_opt);
+	uint32_t payload_symb = 8 + (num > 0 ? ((num + den - 1) / den) * (cr + 4) : 0);
+	return (t_sym * (4 * preamble + 17)) / 4 + payload_symb * t_sym;
+}
+
+/**
+ * @brief Calculate the time-on-air of an uplink with the current region and datarate
+ *
+ * @param size application payload size
+ * @return uint32_t time-on-air in ms
+ */
+uint32_t airtime_toa(uint8_t size)
+{
+	uint8_t sf;
+	uint16_t bw;
+	uint32_t phy_size = size + LORAWAN_OVERHEAD;
+	uint32_t toa_us;
+
+	if (!get_dr_params(get_current_dr(), &sf, &bw))
+	{
+		// FSK 50 kbps, preamble (5) + sync word (3) + length (1) + CRC (2), 160 us per byte
+		toa_us = (phy_size + 11) * 160;
+	}
+	else
+	{
+		// Coding rate 4/5, 8 symbols preamble
+		toa_us = lora_toa_us(phy_size, sf, bw, 1, 8);
+	}
+	return (toa_us + 999) / 1000;
+}
+
+/**
+ * @brief Calculate the time-on-air of a LoRa P2P packet with the P2P settings
+ *
+ * @param size payload size
+ * @return uint32_t time-on-air in ms
+ */
+uint32_t airtime_p2p_toa(uint8_t size)
+{
+	// Bandwidth setting 0 = 125 kHz, 1 = 250 kHz, 2 = 500 kHz
+	uint16_t bw = g_lorawan_settings.p2p_bandwidth <= 2 ? 125 << g_lorawan_settings.p2p_bandwidth : 125;
+	uint8_t cr = (g_lorawan_settings.p2p_cr >= 1) && (g_lorawan_settings.p2p_cr <= 4) ? g_lorawan_settings.p2p_cr : 1;
+	return (lora_toa_us(size, g_lorawan_settings.p2p_sf, bw, cr, g_lorawan_settings.p2p_preamble_len) + 999) / 1000;
+}
+
+/**
+ * @brief Estimate the receive time of the two RX windows of an uplink without downlink.
+ *        The receiver waits in each window for the preamble.
+ *
+ * @return uint32_t receive time in ms
+ */
+uint32_t airtime_rx(void)
+{
+	uint8_t sf;
+	uint16_t bw;
+	uint32_t window_us = 0;
+	if (get_dr_params(get_current_dr(), &sf, &bw))
+	{
+		// 8 symbols preamble
+		window_us = ((1UL << sf) * 8000) / bw;
+	}
+	return 2 * ((window_us + 999) / 1000 + AIRTIME_RX_MARGIN);
+}
+
+/**
+ * @brief Move the rolling window to the current time
+ *
+ */
+static void airtime_update(void)
+{
+	uint64_t now = sched_now();
+	uint64_t bin_len = ((uint64_t)g_airtime_window * 60000) / AIRTIME_BINS;
+	if ((now - airtime_bin_start) >= bin_len * AIRTIME_BINS)
+	{
+		// Window expired completely
+		for (uint8_t idx = 0; idx < AIRTIME_BINS; idx++)
+		{
+			airtime_bins[idx] = 0;
+		}
+		airtime_bin_start = now;
+		return;
+	}
+	while ((now - airtime_bin_start) >= bin_len)
+	{
+		airtime_bin = (airtime_bin + 1) % AIRTIME_BINS;
+		airtime_bins[airtime_bin] = 0;
+		airtime_bin_start += bin_len;
+	}
+}
+
+/**
+ * @brief Get the airtime used in the rolling window
+ *
+ * @return uint32_t airtime in ms
+ */
+uint32_t airtime_used(void)
+{
+	airtime_update();
+	uint32_t used = 0;
+	for (uint8_t idx = 0; idx < AIRTIME_BINS; idx++)
+	{
+		used += airtime_bins[idx];
+	}
+	return used;
+}
+
+/**
+ * @brief Get the largest payload size that fits into the remaining airtime budget
+ *
+ * @param max_size maximum payload size of the current datarate
+ * @return uint8_t payload size, 0 if not even an empty packet fits
+ */
+uint8_t airtime_max_payload(uint8_t max_size)
+{
+	if ((g_airtime_budget == 0) || !g_lorawan_settings.lorawan_enable)
+	{
+		return max_size;
+	}
+	uint32_t used = airtime_used();
+	uint32_t remaining = used < g_airtime_budget ? g_airtime_budget - used : 0;
+	uint8_t size = max_size;
+	while ((size != 0) && (airtime_toa(size) > remaining))
+	{
+		size--;
+	}
+	if (size < max_size)
+	{
+		airtime_limited++;
+	}
+	return size;
+}
+
+/**
+ * @brief Add an uplink to the rolling window
+ *
+ * @param size application payload size
+ */
+void airtime_add(uint8_t size)
+{
+	if (!g_lorawan_settings.lorawan_enable)
+	{
+		return;
+	}
+	airtime_update();
+	airtime_last = airtime_toa(size);
+	airtime_bins[airtime_bin] += airtime_last;
+	MYLOG("AIRT", "Time-on-air %ld ms, used %ld ms", (long)airtime_last, (long)airtime_used());
+}
+
+/**
+ * @brief Write the airtime status into a buffer
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void airtime_status(char *buffer, size_t size)
+{
+	snprintf(buffer, size, "Used %ld of %ld ms in %d min, last %ld ms, limited %ld, payload %d",
+			 (long)airtime_used(), (long)g_airtime_budget, g_airtime_window, (long)airtime_last,
+			 (long)airtime_limited, g_airtime_payload ? 1 : 0);
+}
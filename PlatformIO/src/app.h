@@ -59,6 +59,16 @@
 #define MYLOG(...)
 #endif
 
+// Static memory mode, set to 1 to allocate all tasks, semaphores, queues, timers and buffers statically
+#ifndef STATIC_MEM
+#define STATIC_MEM 0
+#endif
+
+// Latency trace, number of entries in the trace ring, 0 = no trace. Enabled in the rak4631_trace environment with -DTRACE_SIZE=128
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 0
+#endif
+
 /** Application function definitions */
 void setup_app(void);
 bool init_app(void);
@@ -73,6 +83,67 @@ void lora_data_handler(void);
 #define GNSS_FIN 0b0100000000000000
 #define N_GNSS_FIN 0b1011111111111111
 
+#define SCHED_DUE 0b0010000000000000
+#define N_SCHED_DUE 0b1101111111111111
+
+/** Atomic event flags */
+void app_wake(uint16_t event);
+void app_event_set(uint16_t event);
+bool app_event_take(uint16_t event);
+void app_event_reset(void);
+void app_event_status(char *buffer, size_t size);
+
+/** Deadline scheduler jobs */
+enum sched_job
+{
+	SCHED_SEND = 0,
+	SCHED_DELAYED,
+	SCHED_BME,
+	SCHED_GNSS,
+	SCHED_PIPE
+};
+void init_sched(void);
+uint64_t sched_now(void);
+void sched_arm(uint8_t job, uint64_t deadline);
+void sched_cancel(uint8_t job);
+bool sched_pending(uint8_t job);
+uint64_t sched_deadline(uint8_t job);
+void sched_send_restart(uint32_t interval);
+void sched_send_check(void);
+void sched_run(void);
+
+/** Sensor acquisition pipeline stages */
+enum pipe_stage
+{
+	PIPE_GNSS = 0,
+	PIPE_ENV,
+	PIPE_BATT,
+	PIPE_ACC,
+	PIPE_NUM_STAGES
+};
+void pipe_start(uint8_t stages, uint32_t timeout);
+void pipe_done(uint8_t stage);
+void pipe_timeout(void);
+void pipe_reset(void);
+void pipe_status(char *buffer, size_t size);
+
+/** Send cycle */
+void init_cycle(void);
+void cycle_start(void);
+void cycle_status(void);
+void cycle_motion(void);
+void cycle_location(void);
+void cycle_tx_finished(bool success);
+void send_location(void);
+void send_packet(void);
+extern bool init_result;
+
+/** Shared I2C bus */
+void init_i2c_bus(void);
+void i2c_lock(void);
+void i2c_unlock(void);
+bool i2c_read_regs(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len, bool auto_inc);
+
 /** Accelerometer stuff */
 #include <SparkFunLIS3DH.h>
 #define INT1_PIN WB_IO1 // Slot A or WB_IO3 // Slot C or WB_IO5 // Slot D or WB_IO3 // Slot C or
@@ -89,6 +160,7 @@ extern bool acc_ok;
 #include "TinyGPS++.h"
 #include <SparkFun_u-blox_GNSS_Arduino_Library.h>
 bool init_gnss(void);
+bool start_gnss_task(void);
 bool poll_gnss(void);
 void gnss_task(void *pvParameters);
 extern SemaphoreHandle_t g_gnss_sem;
@@ -97,13 +169,27 @@ extern volatile bool last_read_ok;
 extern uint8_t gnss_option;
 extern bool gnss_ok;
 extern bool g_loc_high_prec;
+extern uint16_t g_filter_distance;
+extern uint16_t g_filter_time;
+extern uint16_t g_cache_max_age;
+extern uint16_t g_motion_fix_age;
+uint32_t gnss_distance(int32_t lat_1, int32_t lon_1, int32_t lat_2, int32_t lon_2);
+bool gnss_skip_search(void);
+void gnss_motion(void);
+uint32_t gnss_search_time(void);
+void gnss_start_search(void);
+void gnss_search_timeout(void);
+void gnss_search_done(void);
+void gnss_uart_begin(uint32_t baudrate);
+void gnss_uart_end(void);
+uint16_t gnss_uart_receive(uint8_t **data, uint32_t timeout);
 
 /** Temperature + Humidity stuff */
 #include <Adafruit_Sensor.h>
 #include <Adafruit_BME680.h>
 bool init_bme(void);
 bool read_bme(void);
-void start_bme(void);
+bool start_bme(void);
 extern bool has_env_sensor;
 
 // LoRaWan functions
@@ -119,6 +205,235 @@ extern WisCayenne g_data_packet;
 
 extern uint8_t g_last_fport;
 
+// Payload packer
+/** Payload fields, the order is the packing priority */
+enum payload_fields
+{
+	PAYLOAD_LOCATION = 0,
+	PAYLOAD_BATTERY,
+	PAYLOAD_ACC,
+	PAYLOAD_ENV,
+	PAYLOAD_FIX_AGE,
+	PAYLOAD_MOTION,
+	PAYLOAD_AIRTIME,
+	PAYLOAD_MEMORY,
+	PAYLOAD_NUM_FIELDS
+};
+
+/** Sensor values collected for one uplink */
+struct tracker_data_s
+{
+	/** Valid fields, bit number is the payload_fields value */
+	uint8_t valid = 0;
+	/** Latitude and longitude in 1/10000000 degree, altitude in mm */
+	int32_t latitude = 0;
+	int32_t longitude = 0;
+	int32_t altitude = 0;
+	/** GNSS time of the location in seconds since 1970-01-01 UTC, 0 if unknown */
+	uint32_t fix_time = 0;
+	/** Speed in km/h and heading in degree of the location, not sent */
+	float speed = 0.0;
+	float heading = 0.0;
+	/** Age of a cached location in s */
+	uint32_t fix_age = 0;
+	/** Set for the last known location that is sent immediately on an ACC trigger */
+	uint8_t moving = 0;
+	/** Battery voltage in V */
+	float battery = 0.0;
+	/** Acceleration in g */
+	float acc_x = 0.0;
+	float acc_y = 0.0;
+	float acc_z = 0.0;
+	/** Humidity in %RH, temperature in degC, pressure in hPa, gas resistance in kOhm */
+	float humidity = 0.0;
+	float temperature = 0.0;
+	float pressure = 0.0;
+	float gas = 0.0;
+	/** Airtime used in the rolling window in s */
+	float airtime = 0.0;
+	/** Minimum free heap in bytes, lowest stack high water mark of all tasks in words */
+	uint32_t heap_min = 0;
+	uint32_t stack_min = 0;
+};
+extern tracker_data_s g_tracker_data;
+bool gnss_filter(tracker_data_s *data);
+bool gnss_cached_fix(tracker_data_s *data);
+bool gnss_motion_fix(tracker_data_s *data);
+bool gnss_take_fix(tracker_data_s *data);
+void gnss_cache_fix(int32_t latitude, int32_t longitude, int32_t altitude, uint32_t fix_time);
+uint8_t get_current_dr(void);
+uint8_t get_max_payload(void);
+void pack_collect(void);
+uint8_t pack_payload(uint8_t max_size);
+uint8_t *pack_buffer(void);
+uint8_t pack_size(void);
+void pack_sent(bool enqueued);
+void pack_acked(void);
+void pack_tx_finished(bool success, bool confirmed);
+
+// Compact data format
+#include "tracker_codec.h"
+extern bool g_is_compact;
+extern uint8_t g_delta_interval;
+
+// Batch mode
+/** Maximum number of locations in the batch buffer */
+#define BATCH_MAX_POINTS 32
+extern uint8_t g_batch_size;
+bool batch_add(tracker_data_s *data, bool send_now);
+uint8_t batch_count(void);
+uint8_t batch_fit(uint8_t fields, uint8_t max_size, size_t *point_bits);
+tc_point_s *batch_points(void);
+void batch_sending(uint8_t points_num);
+void batch_tx_finished(bool success);
+void batch_flush(void);
+extern uint16_t g_simplify_tolerance;
+void batch_simplify_status(char *buffer, size_t size);
+
+// Cached location
+/** LPP channel of the age of a cached location */
+#define LPP_CHANNEL_FIX_AGE 13
+/** LPP channel of the moving flag of a location sent on an ACC trigger */
+#define LPP_CHANNEL_MOTION 14
+
+// Geofences
+bool init_geofence(void);
+void geofence_check(int32_t latitude, int32_t longitude);
+bool geofence_event(void);
+uint32_t geofence_interval(uint32_t next_interval);
+bool geofence_write(uint32_t offset, uint8_t *data, uint16_t len);
+void geofence_clear(void);
+void geofence_status(char *buffer, size_t size);
+
+// Helium Mapper cell deduplication
+extern uint8_t g_mapper_res;
+extern uint16_t g_mapper_window;
+bool mapper_check(int32_t latitude, int32_t longitude);
+bool mapper_skip(void);
+void mapper_sent(void);
+void mapper_clear(void);
+void mapper_status(char *buffer, size_t size);
+
+// Airtime budget
+/** LPP channel of the used airtime */
+#define LPP_CHANNEL_AIRTIME 12
+extern uint32_t g_airtime_budget;
+extern uint16_t g_airtime_window;
+extern bool g_airtime_payload;
+uint32_t airtime_toa(uint8_t size);
+uint32_t airtime_p2p_toa(uint8_t size);
+uint32_t airtime_rx(void);
+uint32_t airtime_used(void);
+uint8_t airtime_max_payload(uint8_t max_size);
+void airtime_add(uint8_t size);
+void airtime_status(char *buffer, size_t size);
+
+// Memory telemetry
+/** LPP channels of the minimum free heap and the lowest stack high water mark */
+#define LPP_CHANNEL_HEAP 15
+#define LPP_CHANNEL_STACK 16
+extern bool g_mem_payload;
+void mem_sample(void);
+void mem_payload(tracker_data_s *data);
+void mem_status(char *buffer, size_t size);
+
+// Latency trace
+/** Trace points, the IDs are used by tools/trace_decode.cpp */
+enum trace_id
+{
+	TRACE_ACC_ISR = 1,
+	TRACE_LOOP_WAKE,
+	TRACE_GNSS_START,
+	TRACE_NAV_EPOCH,
+	TRACE_FIX,
+	TRACE_BME_DONE,
+	TRACE_LORA_SEND,
+	TRACE_LORA_TX_FIN
+};
+#if TRACE_SIZE > 0
+void init_trace(void);
+void trace_event(uint8_t id);
+void trace_clear(void);
+void trace_dump(void);
+void trace_status(char *buffer, size_t size);
+#define TRACE(id) trace_event(id)
+#else
+#define TRACE(id)
+#endif
+
+// Energy accounting
+/** Power relevant states */
+enum energy_state
+{
+	ENERGY_SLEEP = 0,
+	ENERGY_CPU,
+	ENERGY_GNSS,
+	ENERGY_TX,
+	ENERGY_RX,
+	ENERGY_BME,
+	ENERGY_ACC,
+	ENERGY_NUM_STATES
+};
+extern const uint32_t g_energy_default[ENERGY_NUM_STATES];
+extern uint32_t g_energy_current[ENERGY_NUM_STATES];
+void init_energy(void);
+void energy_on(uint8_t state);
+void energy_off(uint8_t state);
+void energy_add(uint8_t state, uint32_t time);
+void energy_sample(void);
+void energy_reset(void);
+float energy_consumed(void);
+void energy_status(char *buffer, size_t size);
+
+// Speed adaptive send interval
+/** Maximum number of speed steps */
+#define ADAPT_MAX_STEPS 6
+/** Send interval from a speed on */
+struct adapt_step_s
+{
+	/** Speed in km/h */
+	uint16_t speed;
+	/** Send interval in s */
+	uint32_t interval;
+};
+/** Interval table */
+struct adapt_settings_s
+{
+	/** Send interval in s if the tracker does not move, 0 = use the first step */
+	uint32_t parked = 0;
+	/** Number of steps, 0 = fixed send interval */
+	uint8_t steps_num = 0;
+	/** Steps sorted by speed */
+	adapt_step_s steps[ADAPT_MAX_STEPS];
+};
+extern adapt_settings_s g_adapt_settings;
+void adapt_motion(void);
+void adapt_reset(void);
+uint32_t adapt_interval(void);
+uint32_t adapt_next(tracker_data_s *data);
+void adapt_status(char *buffer, size_t size);
+
+// Store and forward queue
+/** First LPP channel for queued locations */
+#define LPP_CHANNEL_QUEUED 20
+/** Queued location */
+struct fq_record_s
+{
+	uint32_t seq;
+	int32_t latitude;
+	int32_t longitude;
+	int32_t altitude;
+};
+void init_fix_queue(void);
+void fq_commit(void);
+void fq_push(int32_t latitude, int32_t longitude, int32_t altitude);
+uint8_t fq_peek(fq_record_s *records, uint8_t max_num);
+uint16_t fq_depth(void);
+void fq_sending(tracker_data_s *data, uint8_t queued_num);
+void fq_tx_finished(bool success);
+void fq_clear(void);
+void fq_status(char *buffer, size_t size);
+
 extern bool g_gps_prec_6;
 extern bool g_is_helium;
 
@@ -0,0 +1,235 @@
+/**
+ * @file batch.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Collect several locations and send them in one batch frame
+ *        of the compact data format. Locations on straight sections are
+ *        removed by the track simplification before they are collected.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "track_simplify.h"
+
+/** Collected locations, oldest first */
+static tc_point_s batch_buffer[BATCH_MAX_POINTS];
+/** Number of collected locations */
+static uint8_t batch_num = 0;
+/** Number of locations in the uplink that is in progress */
+static uint8_t batch_inflight = 0;
+
+/** Track simplification */
+static track_simplifier simplifier;
+/** Statistics of the track simplification */
+static uint32_t simplify_in = 0;
+static uint32_t simplify_kept = 0;
+
+/**
+ * @brief Remove the oldest locations from the batch
+ *
+ * @param num number of locations to remove
+ */
+static void batch_remove(uint8_t num)
+{
+	if (num > batch_num)
+	{
+		num = batch_num;
+	}
+	for (uint8_t idx = num; idx < batch_num; idx++)
+	{
+		batch_buffer[idx - num] = batch_buffer[idx];
+	}
+	batch_num -= num;
+}
+
+/**
+ * @brief Store a location in the batch
+ *
+ * @param point location
+ */
+static void batch_store(const tc_point_s &point)
+{
+	if (batch_num == BATCH_MAX_POINTS)
+	{
+		if (batch_inflight >= batch_num)
+		{
+			// All locations are in the uplink in progress, the new location goes into the store and forward queue
+			fq_push(point.latitude, point.longitude, point.altitude);
+			simplify_kept++;
+			return;
+		}
+		// Batch could not be sent for a while, the oldest location that is not in the uplink
+		// in progress goes into the store and forward queue
+		tc_point_s &oldest = batch_buffer[batch_inflight];
+		fq_push(oldest.latitude, oldest.longitude, oldest.altitude);
+		for (uint8_t idx = batch_inflight + 1; idx < batch_num; idx++)
+		{
+			batch_buffer[idx - 1] = batch_buffer[idx];
+		}
+		batch_num--;
+	}
+	batch_buffer[batch_num] = point;
+	batch_num++;
+	simplify_kept++;
+	MYLOG("BATCH", "Location %d of %d", batch_num, g_batch_size);
+}
+
+/**
+ * @brief Keep the newest location of the track simplification, it is needed
+ *        before the batch is sent to report the current location
+ *
+ */
+static void batch_simplify_flush(void)
+{
+	tc_point_s kept;
+	if (simplifier.flush(kept))
+	{
+		batch_store(kept);
+	}
+}
+
+/**
+ * @brief Add the location of a cycle to the batch
+ *
+ * @param data collected values, the location is moved into the batch
+ * @param send_now true to send the batch with this location (e.g. after a geofence event)
+ * @return true if the batch should be sent now (batch is full, exceeds the
+ *         maximum payload size of the current datarate, there is no location or send_now is set)
+ * @return false if the batch is still collecting
+ */
+bool batch_add(tracker_data_s *data, bool send_now)
+{
+	if ((data->valid & (1 << PAYLOAD_LOCATION)) == 0)
+	{
+		// No location, send the values and the locations collected so far
+		batch_simplify_flush();
+		return true;
+	}
+	data->valid &= ~(1 << PAYLOAD_LOCATION);
+
+	tc_point_s point;
+	// Without GNSS time use the uptime, the decoder gets at least the time between the locations
+	point.time = data->fix_time != 0 ? data->fix_time : millis() / 1000;
+	point.latitude = data->latitude;
+	point.longitude = data->longitude;
+	point.altitude = data->altitude;
+
+	simplify_in++;
+	simplifier.set_tolerance(g_simplify_tolerance);
+	tc_point_s kept;
+	if (simplifier.add(point, kept))
+	{
+		batch_store(kept);
+	}
+
+	if (send_now || (batch_num >= g_batch_size) || (batch_fit(0, get_max_payload(), NULL) < batch_num))
+	{
+		batch_simplify_flush();
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Number of collected locations
+ *
+ * @return uint8_t number of locations
+ */
+uint8_t batch_count(void)
+{
+	return batch_num;
+}
+
+/**
+ * @brief Get the number of locations that fit into a batch frame
+ *
+ * @param fields TC_FIELD_xxx flags of the other values in the frame
+ * @param max_size maximum payload size
+ * @param point_bits if not NULL, size of the fitting locations in bits
+ * @return uint8_t number of locations
+ */
+uint8_t batch_fit(uint8_t fields, uint8_t max_size, size_t *point_bits)
+{
+	size_t bits = 0;
+	uint8_t num = 0;
+	while (num < batch_num)
+	{
+		size_t next_bits = bits + tc_point_bits(num == 0 ? NULL : &batch_buffer[num - 1], batch_buffer[num]);
+		if (tc_batch_size(fields, next_bits) > max_size)
+		{
+			break;
+		}
+		bits = next_bits;
+		num++;
+	}
+	if (point_bits != NULL)
+	{
+		*point_bits = bits;
+	}
+	return num;
+}
+
+/**
+ * @brief Get the collected locations
+ *
+ * @return tc_point_s* locations, oldest first
+ */
+tc_point_s *batch_points(void)
+{
+	return batch_buffer;
+}
+
+/**
+ * @brief Remember the number of locations in the uplink
+ *
+ * @param points_num number of locations in the uplink
+ */
+void batch_sending(uint8_t points_num)
+{
+	batch_inflight = points_num;
+}
+
+/**
+ * @brief Handle the result of the last uplink
+ *
+ * @param success true if the uplink was sent (or ACK'd for confirmed uplinks)
+ *        if false the locations are sent again with the next batch
+ */
+void batch_tx_finished(bool success)
+{
+	if (success && (batch_inflight != 0))
+	{
+		batch_remove(batch_inflight);
+	}
+	batch_inflight = 0;
+}
+
+/**
+ * @brief Move all collected locations into the store and forward queue,
+ *        used if the batch mode was switched off
+ *
+ */
+void batch_flush(void)
+{
+	batch_simplify_flush();
+	for (uint8_t idx = 0; idx < batch_num; idx++)
+	{
+		fq_push(batch_buffer[idx].latitude, batch_buffer[idx].longitude, batch_buffer[idx].altitude);
+	}
+	batch_num = 0;
+	batch_inflight = 0;
+	simplifier.reset();
+}
+
+/**
+ * @brief Write the status of the track simplification into a buffer
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void batch_simplify_status(char *buffer, size_t size)
+{
+	snprintf(buffer, size, "Tolerance %d m, kept %ld of %ld locations", g_simplify_tolerance, (long)simplify_kept, (long)simplify_in);
+}
@@ -14,6 +14,9 @@
 /** Instance of the BME680 class */
 Adafruit_BME680 bme;
 
+/** Heating time of the gas sensor in ms */
+#define BME_HEATER_TIME 150
+
 /**
  * @brief Initialize the BME680 sensor
  * 
@@ -22,8 +25,10 @@ Adafruit_BME680 bme;
  */
 bool init_bme(void)
 {
+	i2c_lock();
 	if (!bme.begin(0x76, false))
 	{
+		i2c_unlock();
 		MYLOG("BME", "Could not find a valid BME680 sensor, check wiring!");
 		return false;
 	}
@@ -32,7 +37,8 @@ bool init_bme(void)
 	bme.setHumidityOversampling(BME680_OS_2X);
 	bme.setPressureOversampling(BME680_OS_4X);
 	bme.setIIRFilterSize(BME680_FILTER_SIZE_3);
-	bme.setGasHeater(320, 150); // 320*C for 150 ms
+	bme.setGasHeater(320, BME_HEATER_TIME); // 320*C for 150 ms
+	i2c_unlock();
 
 	return true;
 }
@@ -40,11 +46,23 @@ bool init_bme(void)
 /**
  * @brief Start sensing on the BME6860
  * 
+ * @return true if the conversion was started, the values are read by the scheduler
  */
-void start_bme(void)
+bool start_bme(void)
 {
 	MYLOG("BME", "Start BME reading");
-	bme.beginReading();
+	i2c_lock();
+	unsigned long end_time = bme.beginReading();
+	i2c_unlock();
+	if (end_time != 0)
+	{
+		energy_add(ENERGY_BME, BME_HEATER_TIME);
+		// Read the values when the conversion is finished
+		uint32_t wait_time = (long)(end_time - millis()) > 0 ? end_time - millis() : 0;
+		sched_arm(SCHED_BME, sched_now() + wait_time);
+		return true;
+	}
+	return false;
 }
 
 /**
@@ -59,9 +77,12 @@ bool read_bme(void)
 	bool read_success = false;
 	while ((millis() - wait_start) < 5000)
 	{
-		if (bme.endReading())
+		// The data block is read in a single transfer by the driver
+		i2c_lock();
+		read_success = bme.endReading();
+		i2c_unlock();
+		if (read_success)
 		{
-			read_success = true;
 			break;
 		}
 	}
@@ -78,10 +99,12 @@ bool read_bme(void)
 	uint16_t gasres_int = (uint16_t)(bme.gas_resistance / 10);
 #endif
 
-	g_data_packet.addRelativeHumidity(LPP_CHANNEL_HUMID, bme.humidity);
-	g_data_packet.addTemperature(LPP_CHANNEL_TEMP, bme.temperature);
-	g_data_packet.addBarometricPressure(LPP_CHANNEL_PRESS, bme.pressure / 100);
-	g_data_packet.addAnalogInput(LPP_CHANNEL_GAS, (float)(bme.gas_resistance) / 1000.0);
+	g_tracker_data.humidity = bme.humidity;
+	g_tracker_data.temperature = bme.temperature;
+	g_tracker_data.pressure = bme.pressure / 100;
+	g_tracker_data.gas = (float)(bme.gas_resistance) / 1000.0;
+	g_tracker_data.valid |= 1 << PAYLOAD_ENV;
+	TRACE(TRACE_BME_DONE);
 
 #if MY_DEBUG > 0
 	MYLOG("BME", "RH= %.2f T= %.2f", (float)(humid_int / 2.0), (float)(temp_int / 10.0));
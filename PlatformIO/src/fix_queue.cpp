@@ -0,0 +1,379 @@
+/**
+ * @file fix_queue.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Store and forward queue for locations that could not be sent.
+ *        Append-only ring log in InternalFS, split into segment files that are
+ *        reused in rotation. New records are staged in RAM and written in batches.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Number of segment files */
+#define FQ_SEGMENTS 4
+/** Records per segment file */
+#define FQ_SEG_RECORDS 32
+/** Records staged in RAM before they are written to flash */
+#define FQ_BATCH 4
+/** Assumed flash bytes for the LittleFS metadata update of each commit. Not measured, the real
+ *  cost depends on the state of the metadata blocks (a compaction rewrites a whole 4 kB block),
+ *  so the write amplification of AT+FQ is an estimate. */
+#define FQ_META_BYTES 128
+
+/** Filename of the read pointer */
+static const char fq_head_name[] = "FQH";
+
+/** File for queue access */
+File fq_file(InternalFS);
+
+/** Sequence number of the oldest unsent record */
+static uint32_t fq_head = 0;
+/** Sequence number of the oldest record staged in RAM */
+static uint32_t fq_committed = 0;
+/** Sequence number for the next record */
+static uint32_t fq_tail = 0;
+/** Read pointer saved in flash */
+static uint32_t fq_saved_head = 0;
+
+/** Records not yet written to flash */
+static fq_record_s fq_staged[FQ_BATCH];
+
+/** Number of queued records in the last uplink */
+static uint8_t fq_inflight_num = 0;
+/** Location sent with the last uplink */
+static fq_record_s fq_inflight_fix;
+/** Flag if the last uplink included a location */
+static bool fq_inflight_has_fix = false;
+
+/** Statistics */
+static uint32_t fq_dropped = 0;
+static uint32_t fq_commits = 0;
+static uint32_t fq_payload_bytes = 0;
+static uint32_t fq_flash_bytes = 0;
+
+/**
+ * @brief Create the filename of a segment
+ *
+ * @param name buffer for the name, at least 6 bytes
+ * @param seq sequence number of a record in the segment
+ */
+static void fq_seg_name(char *name, uint32_t seq)
+{
+	snprintf(name, 6, "FQ%d", (int)((seq / FQ_SEG_RECORDS) % FQ_SEGMENTS));
+}
+
+/**
+ * @brief Save the read pointer to flash
+ *
+ */
+static void fq_save_head(void)
+{
+	if (fq_saved_head == fq_head)
+	{
+		return;
+	}
+	InternalFS.remove(fq_head_name);
+	fq_file.open(fq_head_name, FILE_O_WRITE);
+	fq_file.write((uint8_t *)&fq_head, sizeof(fq_head));
+	fq_file.close();
+	fq_saved_head = fq_head;
+	fq_flash_bytes += sizeof(fq_head) + FQ_META_BYTES;
+}
+
+/**
+ * @brief Read a record from the staging buffer or from flash
+ *
+ * @param seq sequence number of the record
+ * @param record buffer for the record
+ * @return true if the record was found
+ * @return false if the record could not be read
+ */
+static bool fq_read(uint32_t seq, fq_record_s *record)
+{
+	if (seq >= fq_committed)
+	{
+		*record = fq_staged[seq - fq_committed];
+		return true;
+	}
+
+	char name[6];
+	fq_seg_name(name, seq);
+	bool result = false;
+	if (fq_file.open(name, FILE_O_READ))
+	{
+		if (fq_file.seek((seq % FQ_SEG_RECORDS) * sizeof(fq_record_s)))
+		{
+			result = (fq_file.read(record, sizeof(fq_record_s)) == sizeof(fq_record_s)) && (record->seq == seq);
+		}
+		fq_file.close();
+	}
+	return result;
+}
+
+/**
+ * @brief Find the queue pointers from the segment files
+ *
+ */
+void init_fix_queue(void)
+{
+	bool found = false;
+	uint32_t min_seq = 0;
+	uint32_t max_seq = 0;
+	fq_record_s record;
+	char name[6];
+
+	for (uint8_t seg = 0; seg < FQ_SEGMENTS; seg++)
+	{
+		fq_seg_name(name, seg * FQ_SEG_RECORDS);
+		if (!fq_file.open(name, FILE_O_READ))
+		{
+			continue;
+		}
+		uint32_t num = fq_file.size() / sizeof(fq_record_s);
+		if (num != 0)
+		{
+			// Records in a segment are consecutive, first and last are enough
+			fq_file.read(&record, sizeof(fq_record_s));
+			if (!found || (record.seq < min_seq))
+			{
+				min_seq = record.seq;
+			}
+			fq_file.seek((num - 1) * sizeof(fq_record_s));
+			fq_file.read(&record, sizeof(fq_record_s));
+			if (!found || (record.seq > max_seq))
+			{
+				max_seq = record.seq;
+			}
+			found = true;
+		}
+		fq_file.close();
+	}
+
+	if (fq_file.open(fq_head_name, FILE_O_READ))
+	{
+		fq_file.read(&fq_head, sizeof(fq_head));
+		fq_file.close();
+	}
+
+	if (found)
+	{
+		fq_tail = max_seq + 1;
+		if (fq_head < min_seq)
+		{
+			fq_head = min_seq;
+		}
+	}
+	else
+	{
+		fq_tail = fq_head;
+	}
+	if (fq_head > fq_tail)
+	{
+		fq_head = fq_tail;
+	}
+	fq_committed = fq_tail;
+	fq_saved_head = fq_head;
+	MYLOG("FQ", "Queue %ld records, head %ld tail %ld", (long)(fq_tail - fq_head), (long)fq_head, (long)fq_tail);
+}
+
+/**
+ * @brief Write the staged records to flash
+ *
+ */
+void fq_commit(void)
+{
+	if (fq_tail != fq_committed)
+	{
+		char name[6];
+		bool is_open = false;
+		for (uint32_t seq = fq_committed; seq < fq_tail; seq++)
+		{
+			if ((seq % FQ_SEG_RECORDS) == 0)
+			{
+				// Start of a segment, the oldest records are overwritten
+				if (is_open)
+				{
+					fq_file.close();
+					is_open = false;
+				}
+				uint32_t seg_end = seq + FQ_SEG_RECORDS;
+				if ((seg_end > (FQ_SEGMENTS * FQ_SEG_RECORDS)) && (fq_head < (seg_end - (FQ_SEGMENTS * FQ_SEG_RECORDS))))
+				{
+					fq_dropped += seg_end - (FQ_SEGMENTS * FQ_SEG_RECORDS) - fq_head;
+					fq_head = seg_end - (FQ_SEGMENTS * FQ_SEG_RECORDS);
+					MYLOG("FQ", "Queue full, dropped oldest records");
+				}
+				fq_seg_name(name, seq);
+				InternalFS.remove(name);
+			}
+			if (!is_open)
+			{
+				fq_seg_name(name, seq);
+				fq_file.open(name, FILE_O_WRITE);
+				is_open = true;
+			}
+			fq_file.seek((seq % FQ_SEG_RECORDS) * sizeof(fq_record_s));
+			fq_file.write((uint8_t *)&fq_staged[seq - fq_committed], sizeof(fq_record_s));
+			fq_flash_bytes += sizeof(fq_record_s);
+		}
+		if (is_open)
+		{
+			fq_file.close();
+		}
+		fq_flash_bytes += FQ_META_BYTES;
+		fq_commits++;
+		fq_committed = fq_tail;
+	}
+	fq_save_head();
+}
+
+/**
+ * @brief Add a location to the queue
+ *
+ * @param latitude latitude in 1/10000000 degree
+ * @param longitude longitude in 1/10000000 degree
+ * @param altitude altitude in mm
+ */
+void fq_push(int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	fq_record_s *record = &fq_staged[fq_tail - fq_committed];
+	record->seq = fq_tail;
+	record->latitude = latitude;
+	record->longitude = longitude;
+	record->altitude = altitude;
+	fq_tail++;
+	fq_payload_bytes += sizeof(fq_record_s);
+	MYLOG("FQ", "Queued location %ld, %d in queue", (long)record->seq, fq_depth());
+
+	if ((fq_tail - fq_committed) == FQ_BATCH)
+	{
+		fq_commit();
+	}
+}
+
+/**
+ * @brief Get the oldest records of the queue
+ *
+ * @param records buffer for the records
+ * @param max_num maximum number of records
+ * @return uint8_t number of records
+ */
+uint8_t fq_peek(fq_record_s *records, uint8_t max_num)
+{
+	uint8_t num = 0;
+	while ((num < max_num) && ((fq_head + num) < fq_tail))
+	{
+		if (!fq_read(fq_head + num, &records[num]))
+		{
+			if (num != 0)
+			{
+				break;
+			}
+			// Oldest record is lost, skip it
+			fq_head++;
+			fq_dropped++;
+			continue;
+		}
+		num++;
+	}
+	return num;
+}
+
+/**
+ * @brief Number of queued records
+ *
+ * @return uint16_t number of records
+ */
+uint16_t fq_depth(void)
+{
+	return (uint16_t)(fq_tail - fq_head);
+}
+
+/**
+ * @brief Remember what was sent with the last uplink
+ *
+ * @param data values of the uplink, the location is queued if the uplink fails
+ * @param queued_num number of queued records in the uplink
+ */
+void fq_sending(tracker_data_s *data, uint8_t queued_num)
+{
+	fq_inflight_has_fix = (data->valid & (1 << PAYLOAD_LOCATION)) != 0;
+	fq_inflight_fix.latitude = data->latitude;
+	fq_inflight_fix.longitude = data->longitude;
+	fq_inflight_fix.altitude = data->altitude;
+	fq_inflight_num = queued_num;
+}
+
+/**
+ * @brief Handle the result of the last uplink
+ *
+ * @param success true if the uplink was sent (or ACK'd for confirmed uplinks)
+ */
+void fq_tx_finished(bool success)
+{
+	if (success)
+	{
+		if (fq_inflight_num != 0)
+		{
+			// Queued records were delivered
+			fq_head += fq_inflight_num;
+			if (fq_head > fq_tail)
+			{
+				fq_head = fq_tail;
+			}
+			if ((fq_head == fq_tail) || ((fq_head - fq_saved_head) >= FQ_BATCH))
+			{
+				fq_save_head();
+			}
+		}
+	}
+	else if (fq_inflight_has_fix)
+	{
+		fq_push(fq_inflight_fix.latitude, fq_inflight_fix.longitude, fq_inflight_fix.altitude);
+	}
+	fq_inflight_num = 0;
+	fq_inflight_has_fix = false;
+}
+
+/**
+ * @brief Remove all records from the queue
+ *
+ */
+void fq_clear(void)
+{
+	char name[6];
+	for (uint8_t seg = 0; seg < FQ_SEGMENTS; seg++)
+	{
+		fq_seg_name(name, seg * FQ_SEG_RECORDS);
+		InternalFS.remove(name);
+	}
+	fq_head = fq_tail;
+	fq_committed = fq_tail;
+	fq_save_head();
+	fq_inflight_num = 0;
+}
+
+/**
+ * @brief Write the queue status into a buffer
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void fq_status(char *buffer, size_t size)
+{
+	// Estimated write amplification as flash bytes per queued byte x 100
+	uint32_t write_amp = 0;
+	if (fq_payload_bytes != 0)
+	{
+		write_amp = (uint32_t)(((uint64_t)fq_flash_bytes * 100) / fq_payload_bytes);
+	}
+	snprintf(buffer, size, "Queue %d, staged %d, dropped %ld, commits %ld, est. WA %ld.%02ld",
+			 fq_depth(), (int)(fq_tail - fq_committed), (long)fq_dropped, (long)fq_commits,
+			 (long)(write_amp / 100), (long)(write_amp % 100));
+}
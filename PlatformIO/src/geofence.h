@@ -0,0 +1,313 @@
+/**
+ * @file geofence.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Geofence index with a uniform grid. The index is read in place from
+ *        a reader (a file in flash on the device, a buffer on a host), a query
+ *        reads only the fences that overlap the grid cell of the location.
+ *        Integer math only, header only and without Arduino dependencies.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Index layout, all values little endian, coordinates in 1/10000000 degree:
+ * | Header      | 28 bytes, gf_header_s                                      |
+ * | Cell table  | (cols * rows + 1) x uint16, first candidate of each cell   |
+ * | Candidates  | uint16 fence numbers, the candidates of each cell          |
+ * | Fence table | fence_num x uint32, offset of each fence from the start    |
+ * | Fences      | gf_fence_s, circles followed by the radius in m, polygons  |
+ * |             | followed by the vertices as int32 latitude/longitude pairs |
+ */
+
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "track_simplify.h"
+
+/** "GFI1" */
+#define GF_MAGIC 0x31494647
+/** Fence types */
+#define GF_TYPE_CIRCLE 0
+#define GF_TYPE_POLYGON 1
+/** Fence flags */
+#define GF_FLAG_HOME 0x01
+/** Vertices read at once */
+#define GF_VERTEX_CHUNK 8
+
+/** Index header */
+struct gf_header_s
+{
+	uint32_t magic;
+	uint16_t fence_num;
+	uint8_t cols;
+	uint8_t rows;
+	/** Send interval in minutes inside a home fence, 0 = unchanged */
+	uint16_t home_interval;
+	uint16_t reserved;
+	/** South west corner of the grid */
+	int32_t lat_min;
+	int32_t lon_min;
+	/** Size of a grid cell */
+	int32_t cell_lat;
+	int32_t cell_lon;
+};
+
+/** Fence record */
+struct gf_fence_s
+{
+	uint8_t type;
+	uint8_t flags;
+	uint16_t id;
+	/** Circle: center, polygon: number of vertices in latitude, unused longitude */
+	int32_t latitude;
+	int32_t longitude;
+	/** Circle: radius in m, polygon: unused */
+	uint32_t radius;
+};
+
+/**
+ * @brief Random access to the index
+ *
+ */
+class gf_reader
+{
+public:
+	/**
+	 * @brief Read from the index
+	 *
+	 * @param offset offset from the start of the index
+	 * @param buffer buffer for the data
+	 * @param len number of bytes
+	 * @return true if all bytes were read
+	 */
+	virtual bool read(uint32_t offset, void *buffer, size_t len) = 0;
+};
+
+/**
+ * @brief Geofence index
+ *
+ */
+class gf_index
+{
+public:
+	gf_index(void) : _reader(NULL), _fence_table(0), _size(0) {}
+
+	/**
+	 * @brief Check the index and remember the reader
+	 *
+	 * @param reader access to the index
+	 * @param size size of the index in bytes
+	 * @return true if the index is valid
+	 */
+	bool load(gf_reader *reader, uint32_t size)
+	{
+		_reader = NULL;
+		if ((size < sizeof(gf_header_s)) || !reader->read(0, &_header, sizeof(gf_header_s)))
+		{
+			return false;
+		}
+		if ((_header.magic != GF_MAGIC) || (_header.cols == 0) || (_header.rows == 0) || (_header.cell_lat <= 0) || (_header.cell_lon <= 0))
+		{
+			return false;
+		}
+		uint32_t cells = (uint32_t)_header.cols * _header.rows;
+		uint16_t candidates;
+		if (!reader->read(sizeof(gf_header_s) + cells * 2, &candidates, 2))
+		{
+			return false;
+		}
+		_fence_table = sizeof(gf_header_s) + (cells + 1) * 2 + (uint32_t)candidates * 2;
+		if ((_fence_table + (uint32_t)_header.fence_num * 4) > size)
+		{
+			return false;
+		}
+		_size = size;
+		_reader = reader;
+		return true;
+	}
+
+	/**
+	 * @brief Forget the index
+	 *
+	 */
+	void unload(void)
+	{
+		_reader = NULL;
+	}
+
+	/**
+	 * @brief Check if an index is loaded
+	 *
+	 */
+	bool loaded(void)
+	{
+		return _reader != NULL;
+	}
+
+	/**
+	 * @brief Header of the loaded index
+	 *
+	 */
+	const gf_header_s &header(void)
+	{
+		return _header;
+	}
+
+	/**
+	 * @brief Find the fences that contain a location
+	 *
+	 * @param latitude latitude in 1/10000000 degree
+	 * @param longitude longitude in 1/10000000 degree
+	 * @param ids buffer for the IDs of the fences
+	 * @param max_num size of the buffer
+	 * @param home set to true if one of the fences is a home fence, can be NULL
+	 * @return uint8_t number of fences that contain the location
+	 */
+	uint8_t query(int32_t latitude, int32_t longitude, uint16_t *ids, uint8_t max_num, bool *home)
+	{
+		if (home != NULL)
+		{
+			*home = false;
+		}
+		if (_reader == NULL)
+		{
+			return 0;
+		}
+		int64_t row = ((int64_t)latitude - _header.lat_min) / _header.cell_lat;
+		int64_t col = ((int64_t)longitude - _header.lon_min) / _header.cell_lon;
+		if ((latitude < _header.lat_min) || (longitude < _header.lon_min) || (row >= _header.rows) || (col >= _header.cols))
+		{
+			// Outside of all fences
+			return 0;
+		}
+		uint32_t cell = (uint32_t)row * _header.cols + (uint32_t)col;
+		uint16_t range[2];
+		if (!_reader->read(sizeof(gf_header_s) + cell * 2, range, 4))
+		{
+			return 0;
+		}
+		uint32_t candidates = sizeof(gf_header_s) + ((uint32_t)_header.cols * _header.rows + 1) * 2;
+
+		uint8_t found = 0;
+		for (uint16_t idx = range[0]; (idx < range[1]) && (found < max_num); idx++)
+		{
+			uint16_t fence_num;
+			uint32_t offset;
+			gf_fence_s fence;
+			if (!_reader->read(candidates + idx * 2, &fence_num, 2) || (fence_num >= _header.fence_num) ||
+				!_reader->read(_fence_table + fence_num * 4, &offset, 4) || ((offset + sizeof(gf_fence_s)) > _size) ||
+				!_reader->read(offset, &fence, sizeof(gf_fence_s)))
+			{
+				continue;
+			}
+			bool inside = false;
+			if (fence.type == GF_TYPE_CIRCLE)
+			{
+				inside = in_circle(fence, latitude, longitude);
+			}
+			else if (fence.type == GF_TYPE_POLYGON)
+			{
+				inside = in_polygon(offset + sizeof(gf_fence_s), (uint32_t)fence.latitude, latitude, longitude);
+			}
+			if (inside)
+			{
+				ids[found++] = fence.id;
+				if ((home != NULL) && ((fence.flags & GF_FLAG_HOME) != 0))
+				{
+					*home = true;
+				}
+			}
+		}
+		return found;
+	}
+
+private:
+	/**
+	 * @brief Check if a location is inside a circle, equirectangular approximation
+	 *
+	 */
+	bool in_circle(const gf_fence_s &fence, int32_t latitude, int32_t longitude)
+	{
+		int64_t d_x = (((int64_t)longitude - fence.longitude) * ts_cos_q15(fence.latitude)) >> 15;
+		int64_t d_y = (int64_t)latitude - fence.latitude;
+		if ((ts_abs(d_x) > TS_MAX_DELTA) || (ts_abs(d_y) > TS_MAX_DELTA))
+		{
+			return false;
+		}
+		// 1 m is ~89.83 units of 1/10000000 degree latitude
+		int64_t radius = ((int64_t)fence.radius * 8983) / 100;
+		return (d_x * d_x + d_y * d_y) <= (radius * radius);
+	}
+
+	/**
+	 * @brief Check if a location is inside a polygon, crossing number test.
+	 *        The vertices are read in chunks.
+	 *
+	 */
+	bool in_polygon(uint32_t offset, uint32_t vertex_num, int32_t latitude, int32_t longitude)
+	{
+		if ((vertex_num < 3) || ((offset + vertex_num * 8) > _size))
+		{
+			return false;
+		}
+		int32_t chunk[GF_VERTEX_CHUNK * 2];
+		int32_t first[2];
+		int32_t prev[2];
+		bool inside = false;
+		for (uint32_t start = 0; start < vertex_num; start += GF_VERTEX_CHUNK)
+		{
+			uint32_t num = vertex_num - start < GF_VERTEX_CHUNK ? vertex_num - start : GF_VERTEX_CHUNK;
+			if (!_reader->read(offset + start * 8, chunk, num * 8))
+			{
+				return false;
+			}
+			for (uint32_t idx = 0; idx < num; idx++)
+			{
+				int32_t *vertex = &chunk[idx * 2];
+				if ((start + idx) == 0)
+				{
+					first[0] = vertex[0];
+					first[1] = vertex[1];
+				}
+				else if (crosses(prev, vertex, latitude, longitude))
+				{
+					inside = !inside;
+				}
+				prev[0] = vertex[0];
+				prev[1] = vertex[1];
+			}
+		}
+		// Closing edge
+		if (crosses(prev, first, latitude, longitude))
+		{
+			inside = !inside;
+		}
+		return inside;
+	}
+
+	/**
+	 * @brief Check if the edge a -> b crosses the ray from the location to the east
+	 *
+	 */
+	static bool crosses(const int32_t *a, const int32_t *b, int32_t latitude, int32_t longitude)
+	{
+		if ((a[0] > latitude) == (b[0] > latitude))
+		{
+			return false;
+		}
+		// longitude < a_lon + (b_lon - a_lon) * (latitude - a_lat) / (b_lat - a_lat), without the division
+		int64_t d_lat = (int64_t)b[0] - a[0];
+		int64_t lhs = ((int64_t)longitude - a[1]) * d_lat;
+		int64_t rhs = ((int64_t)b[1] - a[1]) * ((int64_t)latitude - a[0]);
+		return d_lat > 0 ? lhs < rhs : lhs > rhs;
+	}
+
+	gf_reader *_reader;
+	gf_header_s _header;
+	uint32_t _fence_table;
+	uint32_t _size;
+};
+
+#endif
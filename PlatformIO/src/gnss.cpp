@@ -22,12 +22,35 @@ void gnss_task(void *pvParameters);
 /** Semaphore for GNSS aquisition task */
 SemaphoreHandle_t g_gnss_sem;
 
+/** Stack size of the GNSS task in words */
+#define GNSS_TASK_STACK 4096
+
+#if STATIC_MEM > 0
+/** Task and semaphore memory for the static memory mode */
+static StackType_t gnss_task_stack[GNSS_TASK_STACK];
+static StaticTask_t gnss_task_tcb;
+static StaticSemaphore_t gnss_sem_buf;
+#endif
+
 /** GNSS polling function */
 bool poll_gnss(void);
 
 /** Flag if location was found */
 volatile bool last_read_ok = false;
 
+/** Flag if the location search timed out, set by the scheduler */
+static volatile bool search_timeout = false;
+/** Number of location searches started by the app loop and finished by the GNSS task */
+static uint16_t search_started = 0;
+static volatile uint16_t search_finished = 0;
+
+/** Latest navigation epoch of the RAK12500, written by the autoPVT callback in the GNSS task */
+static UBX_NAV_PVT_data_t gnss_pvt;
+/** Flag if a new navigation epoch was received */
+static bool gnss_pvt_new = false;
+/** Navigation rate of the RAK12500 in ms */
+static uint16_t gnss_nav_rate = 500;
+
 /** Flag if GNSS is serial or I2C */
 bool i2c_gnss = false;
 
@@ -42,6 +65,130 @@ int64_t fake_longitude[] = {1210069140, -816814860, -349049060, 1530410440};
 
 // PH 144213730, 1210069140, 35.000 // Ohio 414861950, -816814860 // Recife -80533010, -349049060 // Brisbane -274789700, 1530410440
 
+/** Location found by the GNSS task */
+struct gnss_fix_s
+{
+	int32_t latitude;
+	int32_t longitude;
+	int32_t altitude;
+	int32_t accuracy;
+	uint32_t fix_time;
+	float speed;
+	float heading;
+	/** Fake location, not cached and not checked against the geofences */
+	bool fake;
+};
+
+/** Number of slots for the handoff, power of 2 */
+#define GNSS_FIX_SLOTS 2
+
+/**
+ * Handoff of the locations from the GNSS task to the app loop without locks.
+ * Single producer (GNSS task) writes a free slot and then advances fix_head,
+ * single consumer (app loop) copies the slot and then advances fix_tail.
+ * All values of g_tracker_data and g_data_packet are only written by the app loop.
+ */
+static gnss_fix_s fix_slots[GNSS_FIX_SLOTS];
+static uint8_t fix_head = 0;
+static uint8_t fix_tail = 0;
+/** Locations dropped because the app loop did not take the older ones */
+static uint16_t fix_dropped = 0;
+
+/**
+ * @brief Convert a GNSS date and time into seconds since 1970-01-01 UTC
+ *
+ * @return uint32_t seconds since 1970-01-01
+ */
+static uint32_t gnss_epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+	// Days since 1970-01-01, years start in March to put the leap day at the end
+	uint32_t years = year - (month <= 2 ? 1 : 0);
+	uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	uint32_t days = years * 365 + years / 4 - years / 100 + years / 400 + day_of_year - 719468;
+	return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+/**
+ * @brief Hand a location over to the app loop, called by the GNSS task
+ *
+ * @param fix location
+ */
+static void gnss_publish(gnss_fix_s *fix)
+{
+	uint8_t head = __atomic_load_n(&fix_head, __ATOMIC_RELAXED);
+	uint8_t tail = __atomic_load_n(&fix_tail, __ATOMIC_ACQUIRE);
+	if ((uint8_t)(head - tail) >= GNSS_FIX_SLOTS)
+	{
+		// Both slots are full, the app loop did not handle the last GNSS_FIN yet
+		fix_dropped++;
+		return;
+	}
+	fix_slots[head & (GNSS_FIX_SLOTS - 1)] = *fix;
+	__atomic_store_n(&fix_head, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take the newest location of the GNSS task, called by the app loop on GNSS_FIN.
+ *        The location is added to the collected values (or the Helium Mapper packet),
+ *        checked against the geofences and kept for cycles without movement.
+ *
+ * @param data collected values, the location is added
+ * @return true if a location was found
+ */
+bool gnss_take_fix(tracker_data_s *data)
+{
+	uint8_t tail = __atomic_load_n(&fix_tail, __ATOMIC_RELAXED);
+	uint8_t head = __atomic_load_n(&fix_head, __ATOMIC_ACQUIRE);
+	if (tail == head)
+	{
+		return false;
+	}
+	if ((uint8_t)(head - tail) > 1)
+	{
+		MYLOG("GNSS", "%d older locations replaced, %d dropped", (uint8_t)(head - tail - 1), fix_dropped);
+	}
+	gnss_fix_s fix = fix_slots[(uint8_t)(head - 1) & (GNSS_FIX_SLOTS - 1)];
+	__atomic_store_n(&fix_tail, head, __ATOMIC_RELEASE);
+
+	if (!g_is_helium)
+	{
+		// Precision is selected by the packer
+		data->latitude = fix.latitude;
+		data->longitude = fix.longitude;
+		data->altitude = fix.altitude;
+		data->fix_time = fix.fix_time;
+		data->speed = fix.speed;
+		data->heading = fix.heading;
+		data->valid |= 1 << PAYLOAD_LOCATION;
+	}
+	else if (mapper_check(fix.latitude, fix.longitude))
+	{
+		// Save default Cayenne LPP precision, only if the cell was not mapped recently
+		g_data_packet.addGNSS_H(fix.latitude, fix.longitude, fix.altitude, fix.accuracy, read_batt());
+	}
+
+	if (!fix.fake)
+	{
+		// Check the geofences
+		geofence_check(fix.latitude, fix.longitude);
+
+		// Keep the location for cycles without movement
+		gnss_cache_fix(fix.latitude, fix.longitude, fix.altitude, fix.fix_time);
+	}
+	return true;
+}
+
+/**
+ * @brief Called by the u-blox driver from checkCallbacks() for each NAV-PVT read from the RAK12500
+ *
+ * @param pvt navigation solution
+ */
+static void gnss_pvt_cb(UBX_NAV_PVT_data_t *pvt)
+{
+	gnss_pvt = *pvt;
+	gnss_pvt_new = true;
+}
+
 /**
  * @brief Initialize GNSS module
  *
@@ -54,12 +201,14 @@ bool init_gnss(void)
 
 	// Power on the GNSS module
 	digitalWrite(WB_IO2, HIGH);
+	energy_on(ENERGY_GNSS);
 
 	// Give the module some time to power up
 	delay(500);
 
 	if (gnss_option == NO_GNSS_INIT)
 	{
+		i2c_lock();
 		if (!my_gnss.begin())
 		{
 			MYLOG("GNSS", "UBLOX did not answer on I2C, retry on Serial1");
@@ -123,17 +272,17 @@ bool init_gnss(void)
 			my_gnss.saveConfiguration(); // Save the current settings to flash and BBR
 
 			my_gnss.setMeasurementRate(500);
+			gnss_nav_rate = 500;
+			i2c_unlock();
 			return true;
 		}
+		i2c_unlock();
 
 		// No RAK12500 found, assume RAK1910 is plugged in
 		gnss_option = RAK1910_GNSS;
 		MYLOG("GNSS", "Initialize RAK1910");
-		// Serial1.end();
 		delay(500);
-		Serial1.begin(9600);
-		// while (!Serial1)
-		// 	;
+		gnss_uart_begin(9600);
 		MYLOG("GNSS", "RAK1910 finished");
 		return true;
 	}
@@ -141,6 +290,7 @@ bool init_gnss(void)
 	{
 		if (gnss_option == RAK12500_GNSS)
 		{
+			i2c_lock();
 			if (i2c_gnss)
 			{
 				my_gnss.begin();
@@ -153,12 +303,12 @@ bool init_gnss(void)
 				my_gnss.setUART1Output(COM_TYPE_UBX); // Set the UART port to output UBX only
 			}
 			my_gnss.setMeasurementRate(500);
+			gnss_nav_rate = 500;
+			i2c_unlock();
 		}
 		else
 		{
-			Serial1.begin(9600);
-			while (!Serial1)
-				;
+			gnss_uart_begin(9600);
 		}
 		return true;
 	}
@@ -182,44 +332,58 @@ bool poll_gnss(void)
 		init_gnss();
 	}
 
-	time_t time_out = millis();
 	int64_t latitude = 0;
 	int64_t longitude = 0;
 	int32_t altitude = 0;
 	int32_t accuracy = 0;
-
-	time_t check_limit = 90000;
-
-	if (g_lorawan_settings.send_repeat_time == 0)
-	{
-		check_limit = 90000;
-	}
-	else if (g_lorawan_settings.send_repeat_time <= 90000)
-	{
-		check_limit = g_lorawan_settings.send_repeat_time / 2;
-	}
-	else
-	{
-		check_limit = 90000;
-	}
-
-#if FAKE_GPS > 0
-	check_limit = 1000;
-#endif
-	MYLOG("GNSS", "GNSS timeout %ld", (long int)check_limit);
+	uint32_t fix_time = 0;
+	float speed = 0.0;
+	float heading = 0.0;
 
 	MYLOG("GNSS", "Using %s", gnss_option == RAK12500_GNSS ? "RAK12500" : "RAK1910");
 
 	bool has_pos = false;
 	bool has_alt = false;
+	/** First navigation epoch or NMEA sentence of the search */
+	bool epoch_seen = false;
+
+	if (gnss_option == RAK12500_GNSS)
+	{
+		// One NAV-PVT per navigation epoch (autoPVT) holds all values, no polling of single values
+		gnss_pvt_new = false;
+		i2c_lock();
+		my_gnss.setAutoPVTcallbackPtr(&gnss_pvt_cb);
+		i2c_unlock();
+	}
 
-	while ((millis() - time_out) < check_limit)
+	// The timeout is set by the scheduler
+	while (!search_timeout)
 	{
 		if (gnss_option == RAK12500_GNSS)
 		{
-			if (my_gnss.getGnssFixOk())
+			// Poll the module for the NAV-PVT of a new navigation epoch
+			i2c_lock();
+			my_gnss.checkUblox();
+			my_gnss.checkCallbacks();
+			i2c_unlock();
+			if (!gnss_pvt_new)
+			{
+				// No new epoch yet, poll again after 1/8 of the navigation rate.
+				// Only the search timeout notifies the task, otherwise the wait runs out.
+				ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(gnss_nav_rate / 8));
+				continue;
+			}
+			gnss_pvt_new = false;
+			if (!epoch_seen)
+			{
+				epoch_seen = true;
+				TRACE(TRACE_NAV_EPOCH);
+			}
+
+			bool fix_sufficient = false;
+			if (gnss_pvt.flags.bits.gnssFixOK)
 			{
-				byte fix_type = my_gnss.getFixType(); // Get the fix type
+				byte fix_type = gnss_pvt.fixType; // Get the fix type
 				char fix_type_str[32] = {0};
 				if (fix_type == 1)
 					sprintf(fix_type_str, "Dead reckoning");
@@ -234,9 +398,14 @@ bool poll_gnss(void)
 				else
 					sprintf(fix_type_str, "No Fix");
 
-				bool fix_sufficient = false;
-				uint8_t sat_num = my_gnss.getSIV();
-				accuracy = my_gnss.getHorizontalDOP();
+				uint8_t sat_num = gnss_pvt.numSV;
+				if (fix_type >= 3)
+				{
+					// HDOP is not part of the PVT message
+					i2c_lock();
+					accuracy = my_gnss.getHorizontalDOP();
+					i2c_unlock();
+				}
 				if (g_loc_high_prec)
 				{
 					MYLOG("GNSS", "H Fixtype: %d %s", fix_type, fix_type_str);
@@ -256,41 +425,45 @@ bool poll_gnss(void)
 						fix_sufficient = true;
 					}
 				}
-				if (fix_sufficient) /** Fix type 3D */
+			}
+			if (fix_sufficient) /** Fix type 3D */
+			{
+				last_read_ok = true;
+				latitude = gnss_pvt.lat;
+				longitude = gnss_pvt.lon;
+				altitude = gnss_pvt.height;
+				speed = gnss_pvt.gSpeed * 0.0036;
+				heading = gnss_pvt.headMot / 100000.0;
+				if (gnss_pvt.valid.bits.validTime && gnss_pvt.valid.bits.validDate)
 				{
-					last_read_ok = true;
-					latitude = my_gnss.getLatitude();
-					longitude = my_gnss.getLongitude();
-					altitude = my_gnss.getAltitude();
-					accuracy = my_gnss.getHorizontalDOP();
+					fix_time = gnss_epoch(gnss_pvt.year, gnss_pvt.month, gnss_pvt.day, gnss_pvt.hour, gnss_pvt.min, gnss_pvt.sec);
+				}
 
-					MYLOG("GNSS", "Fixtype: %d %s", my_gnss.getFixType(), fix_type_str);
-					MYLOG("GNSS", "Lat: %.4f Lon: %.4f", latitude / 10000000.0, longitude / 10000000.0);
-					MYLOG("GNSS", "Alt: %.2f", altitude / 1000.0);
-					MYLOG("GNSS", "Acy: %.2f ", accuracy / 100.0);
+				MYLOG("GNSS", "Fixtype: %d", gnss_pvt.fixType);
+				MYLOG("GNSS", "Lat: %.4f Lon: %.4f", latitude / 10000000.0, longitude / 10000000.0);
+				MYLOG("GNSS", "Alt: %.2f", altitude / 1000.0);
+				MYLOG("GNSS", "Acy: %.2f ", accuracy / 100.0);
 
-					// Break the while()
-					break;
-				}
-			}
-			else
-			{
-				delay(1000);
+				// Break the while()
+				break;
 			}
+			// The next epoch is not ready before the navigation rate, poll again shortly before it
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(gnss_nav_rate - gnss_nav_rate / 4));
 		}
 		else
 		{
-			while (Serial1.available() > 0)
+			// Wait for the next chunk of NMEA data, the UARTE receives with EasyDMA
+			uint8_t *chunk = NULL;
+			uint16_t chunk_len = gnss_uart_receive(&chunk, 1000);
+			for (uint16_t idx = 0; idx < chunk_len; idx++)
 			{
-				// char gnss = Serial1.read();
-				// Serial.print(gnss);
-				// if (g_ble_uart_is_connected)
-				// {
-				// 	g_ble_uart.print(gnss);
-				// }
-				// if (my_rak1910_gnss.encode(gnss))
-				if (my_rak1910_gnss.encode(Serial1.read()))
+				if (my_rak1910_gnss.encode(chunk[idx]))
 				{
+					if (!epoch_seen)
+					{
+						epoch_seen = true;
+						TRACE(TRACE_NAV_EPOCH);
+					}
 					if (my_rak1910_gnss.location.isUpdated() && my_rak1910_gnss.location.isValid())
 					{
 						MYLOG("GNSS", "Location valid");
@@ -312,6 +485,16 @@ bool poll_gnss(void)
 				// if (has_pos && has_alt)
 				if (has_pos && has_alt)
 				{
+					if (my_rak1910_gnss.date.isValid() && my_rak1910_gnss.time.isValid())
+					{
+						fix_time = gnss_epoch(my_rak1910_gnss.date.year(), my_rak1910_gnss.date.month(), my_rak1910_gnss.date.day(),
+											  my_rak1910_gnss.time.hour(), my_rak1910_gnss.time.minute(), my_rak1910_gnss.time.second());
+					}
+					if (my_rak1910_gnss.speed.isValid() && my_rak1910_gnss.course.isValid())
+					{
+						speed = my_rak1910_gnss.speed.kmph();
+						heading = my_rak1910_gnss.course.deg();
+					}
 					MYLOG("GNSS", "Lat: %.4f Lon: %.4f", latitude / 10000000.0, longitude / 10000000.0);
 					MYLOG("GNSS", "Alt: %.2f", altitude / 1000.0);
 					MYLOG("GNSS", "Acy: %.2f ", accuracy / 100.0);
@@ -327,10 +510,20 @@ bool poll_gnss(void)
 		}
 	}
 
+	if (gnss_option == RAK12500_GNSS)
+	{
+		// No navigation epochs between the searches
+		i2c_lock();
+		my_gnss.setAutoPVT(false);
+		i2c_unlock();
+	}
+
 	if (!g_is_helium)
 	{
 		// Power down the module
+		gnss_uart_end();
 		digitalWrite(WB_IO2, LOW);
+		energy_off(ENERGY_GNSS);
 		delay(100);
 	}
 
@@ -341,30 +534,19 @@ bool poll_gnss(void)
 			last_read_ok = false;
 			return false;
 		}
-		if (!g_is_helium)
-		{
-			if (g_gps_prec_6)
-			{
-				// Save extended precision, not Cayenne LPP compatible
-				g_data_packet.addGNSS_6(LPP_CHANNEL_GPS, latitude, longitude, altitude);
-			}
-			else
-			{
-				// Save default Cayenne LPP precision
-				g_data_packet.addGNSS_4(LPP_CHANNEL_GPS, latitude, longitude, altitude);
-			}
-		}
-		else
-		{
-			// Save default Cayenne LPP precision
-			g_data_packet.addGNSS_H(latitude, longitude, altitude, accuracy, read_batt());
-		}
+		// Hand the location over to the app loop
+		gnss_fix_s fix = {(int32_t)latitude, (int32_t)longitude, altitude, accuracy, fix_time, speed, heading, false};
+		TRACE(TRACE_FIX);
+		gnss_publish(&fix);
 
 		if (g_is_helium)
 		{
+			i2c_lock();
 			my_gnss.setMeasurementRate(10000);
+			gnss_nav_rate = 10000;
 			my_gnss.setNavigationFrequency(1, 10000);
 			my_gnss.powerSaveMode(true, 10000);
+			i2c_unlock();
 		}
 
 		return true;
@@ -385,24 +567,9 @@ bool poll_gnss(void)
 		altitude = 35000;
 		accuracy = 100;
 
-		if (!g_is_helium)
-		{
-			if (g_gps_prec_6)
-			{
-				// Save extended precision, not Cayenne LPP compatible
-				g_data_packet.addGNSS_6(LPP_CHANNEL_GPS, latitude, longitude, altitude);
-			}
-			else
-			{
-				// Save default Cayenne LPP precision
-				g_data_packet.addGNSS_4(LPP_CHANNEL_GPS, latitude, longitude, altitude);
-			}
-		}
-		else
-		{
-			// Save default Cayenne LPP precision
-			g_data_packet.addGNSS_H(latitude, longitude, altitude, accuracy, read_batt());
-		}
+		// Hand the location over to the app loop
+		gnss_fix_s fix = {(int32_t)latitude, (int32_t)longitude, altitude, accuracy, fix_time, speed, heading, true};
+		gnss_publish(&fix);
 		last_read_ok = true;
 		return true;
 #endif
@@ -415,13 +582,65 @@ bool poll_gnss(void)
 	{
 		if (gnss_option == RAK12500_GNSS)
 		{
+			i2c_lock();
 			my_gnss.setMeasurementRate(1000);
+			gnss_nav_rate = 1000;
+			i2c_unlock();
 		}
 	}
 
 	return false;
 }
 
+/**
+ * @brief Start a location search in the GNSS task, the timeout is armed in the scheduler
+ *
+ */
+void gnss_start_search(void)
+{
+	if (search_started != search_finished)
+	{
+		// The running search delivers the location
+		MYLOG("GNSS", "Location search already running");
+		return;
+	}
+
+	uint32_t check_limit = gnss_search_time();
+	MYLOG("GNSS", "GNSS timeout %ld", (long int)check_limit);
+
+	search_timeout = false;
+	search_started++;
+	sched_arm(SCHED_GNSS, sched_now() + check_limit);
+	TRACE(TRACE_GNSS_START);
+	xSemaphoreGive(g_gnss_sem);
+}
+
+/**
+ * @brief Location search finished, the timeout is not needed anymore
+ *
+ */
+void gnss_search_done(void)
+{
+	if (search_started == search_finished)
+	{
+		sched_cancel(SCHED_GNSS);
+	}
+}
+
+/**
+ * @brief Stop the location search, called by the scheduler
+ *
+ */
+void gnss_search_timeout(void)
+{
+	search_timeout = true;
+	// Wake up the task if it waits for the next poll of the RAK12500
+	if (gnss_task_handle != NULL)
+	{
+		xTaskNotifyGive(gnss_task_handle);
+	}
+}
+
 /**
  * @brief Task to read from GNSS module without stopping the loop
  *
@@ -434,7 +653,9 @@ void gnss_task(void *pvParameters)
 	if (!g_is_helium)
 	{
 		// Power down the module
+		gnss_uart_end();
 		digitalWrite(WB_IO2, LOW);
+		energy_off(ENERGY_GNSS);
 		delay(100);
 	}
 
@@ -447,13 +668,55 @@ void gnss_task(void *pvParameters)
 			// Get location
 			bool got_location = poll_gnss();
 			AT_PRINTF("+EVT:LOCATION %s\n", got_location ? "FIX" : "NOFIX");
+			search_finished++;
 
 			// if ((g_task_sem != NULL) && got_location)
 			if (g_task_sem != NULL)
 			{
-				api_wake_loop(GNSS_FIN);
+				app_wake(GNSS_FIN);
 			}
 			MYLOG("GNSS", "GNSS Task finished");
 		}
 	}
 }
+
+/**
+ * @brief Create the GNSS semaphore and start the GNSS task.
+ *        The task is started only once, a later join keeps the running task.
+ *
+ * @return true if the task is running
+ * @return false if the task could not be started
+ */
+bool start_gnss_task(void)
+{
+	if (gnss_task_handle != NULL)
+	{
+		return true;
+	}
+
+	// Create the GNSS event semaphore
+#if STATIC_MEM > 0
+	g_gnss_sem = xSemaphoreCreateBinaryStatic(&gnss_sem_buf);
+#else
+	g_gnss_sem = xSemaphoreCreateBinary();
+#endif
+	// Initialize semaphore
+	xSemaphoreGive(g_gnss_sem);
+	// Take semaphore
+	xSemaphoreTake(g_gnss_sem, 10);
+
+#if STATIC_MEM > 0
+	gnss_task_handle = xTaskCreateStatic(gnss_task, "GNSS", GNSS_TASK_STACK, NULL, TASK_PRIO_LOW, gnss_task_stack, &gnss_task_tcb);
+#else
+	if (!xTaskCreate(gnss_task, "GNSS", GNSS_TASK_STACK, NULL, TASK_PRIO_LOW, &gnss_task_handle))
+	{
+		gnss_task_handle = NULL;
+	}
+#endif
+	if (gnss_task_handle == NULL)
+	{
+		MYLOG("GNSS", "Failed to start GNSS task");
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file gnss_uart.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Receive driver for the NMEA data of the RAK1910.
+ *        UARTE1 receives with EasyDMA into two buffers. A timer, restarted by each
+ *        received byte over PPI, stops the reception when the line is idle, so the
+ *        GNSS task gets whole chunks and sleeps in between instead of reading byte by byte.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** UARTE0 is used by Serial1 */
+#define GNSS_UARTE NRF_UARTE1
+#define GNSS_UARTE_IRQn UARTE1_IRQn
+/** Timer for the idle line detection */
+#define GNSS_TIMER NRF_TIMER4
+/** PPI channels, RXDRDY clears and starts the timer, the timeout stops the reception */
+#define GNSS_PPI_CLEAR 10
+#define GNSS_PPI_START 11
+#define GNSS_PPI_STOP 12
+#define GNSS_PPI_MASK ((1UL << GNSS_PPI_CLEAR) | (1UL << GNSS_PPI_START) | (1UL << GNSS_PPI_STOP))
+
+/** Size of a receive buffer, ~260 ms of data at 9600 baud */
+#define GNSS_UART_BUF 256
+/** Idle time in byte times before a partly filled buffer is handed over */
+#define GNSS_UART_IDLE_BYTES 4
+
+/** Chunk of received data */
+struct gnss_chunk_s
+{
+	uint8_t buf;
+	uint16_t len;
+};
+
+/** Receive buffers */
+static uint8_t gnss_rx_buf[2][GNSS_UART_BUF];
+/** Buffer that is filled by EasyDMA */
+static volatile uint8_t gnss_rx_filling = 0;
+/** Received chunks for the GNSS task */
+static QueueHandle_t gnss_rx_queue = NULL;
+#if STATIC_MEM > 0
+static uint8_t gnss_rx_queue_storage[2 * sizeof(gnss_chunk_s)];
+static StaticQueue_t gnss_rx_queue_buf;
+#endif
+/** Flag if the reception is running */
+static volatile bool gnss_uart_active = false;
+
+/**
+ * @brief UARTE interrupt, hands over the received chunks and restarts the reception
+ *
+ */
+extern "C" void UARTE1_IRQHandler(void)
+{
+	BaseType_t task_woken = pdFALSE;
+
+	if (GNSS_UARTE->EVENTS_ENDRX)
+	{
+		GNSS_UARTE->EVENTS_ENDRX = 0;
+		gnss_chunk_s chunk = {gnss_rx_filling, (uint16_t)GNSS_UARTE->RXD.AMOUNT};
+		gnss_rx_filling ^= 1;
+		if (chunk.len == GNSS_UART_BUF)
+		{
+			// Buffer is full, continue in the other buffer.
+			// A partly filled buffer was stopped by the idle timeout, the reception is restarted after RXTO
+			GNSS_UARTE->TASKS_STARTRX = 1;
+		}
+		if (chunk.len != 0)
+		{
+			xQueueSendFromISR(gnss_rx_queue, &chunk, &task_woken);
+		}
+	}
+
+	if (GNSS_UARTE->EVENTS_RXSTARTED)
+	{
+		GNSS_UARTE->EVENTS_RXSTARTED = 0;
+		// The pointer is double buffered, set the buffer for the next start
+		GNSS_UARTE->RXD.PTR = (uint32_t)gnss_rx_buf[gnss_rx_filling ^ 1];
+	}
+
+	if (GNSS_UARTE->EVENTS_RXTO)
+	{
+		GNSS_UARTE->EVENTS_RXTO = 0;
+		if (gnss_uart_active)
+		{
+			GNSS_UARTE->TASKS_STARTRX = 1;
+		}
+	}
+
+	if (GNSS_UARTE->EVENTS_ERROR)
+	{
+		GNSS_UARTE->EVENTS_ERROR = 0;
+		// Clear framing and overrun errors, the NMEA checksum drops broken sentences
+		GNSS_UARTE->ERRORSRC = GNSS_UARTE->ERRORSRC;
+	}
+
+	portYIELD_FROM_ISR(task_woken);
+}
+
+/**
+ * @brief Start the reception
+ *
+ * @param baudrate 9600, 38400 or 115200
+ */
+void gnss_uart_begin(uint32_t baudrate)
+{
+	if (gnss_uart_active)
+	{
+		return;
+	}
+	if (gnss_rx_queue == NULL)
+	{
+#if STATIC_MEM > 0
+		gnss_rx_queue = xQueueCreateStatic(2, sizeof(gnss_chunk_s), gnss_rx_queue_storage, &gnss_rx_queue_buf);
+#else
+		gnss_rx_queue = xQueueCreate(2, sizeof(gnss_chunk_s));
+#endif
+	}
+	else
+	{
+		// Drop chunks from the last search
+		gnss_chunk_s chunk;
+		while (xQueueReceive(gnss_rx_queue, &chunk, 0) == pdTRUE)
+		{
+		}
+	}
+
+	GNSS_UARTE->ENABLE = UARTE_ENABLE_ENABLE_Disabled;
+	GNSS_UARTE->PSEL.RXD = g_ADigitalPinMap[PIN_SERIAL1_RX];
+	GNSS_UARTE->PSEL.TXD = 0xFFFFFFFF;
+	GNSS_UARTE->PSEL.RTS = 0xFFFFFFFF;
+	GNSS_UARTE->PSEL.CTS = 0xFFFFFFFF;
+	GNSS_UARTE->CONFIG = 0;
+	switch (baudrate)
+	{
+	case 38400:
+		GNSS_UARTE->BAUDRATE = UARTE_BAUDRATE_BAUDRATE_Baud38400;
+		break;
+	case 115200:
+		GNSS_UARTE->BAUDRATE = UARTE_BAUDRATE_BAUDRATE_Baud115200;
+		break;
+	default:
+		baudrate = 9600;
+		GNSS_UARTE->BAUDRATE = UARTE_BAUDRATE_BAUDRATE_Baud9600;
+		break;
+	}
+	gnss_rx_filling = 0;
+	GNSS_UARTE->RXD.PTR = (uint32_t)gnss_rx_buf[0];
+	GNSS_UARTE->RXD.MAXCNT = GNSS_UART_BUF;
+	GNSS_UARTE->EVENTS_ENDRX = 0;
+	GNSS_UARTE->EVENTS_RXSTARTED = 0;
+	GNSS_UARTE->EVENTS_RXTO = 0;
+	GNSS_UARTE->EVENTS_ERROR = 0;
+	GNSS_UARTE->INTENSET = UARTE_INTENSET_ENDRX_Msk | UARTE_INTENSET_RXSTARTED_Msk | UARTE_INTENSET_RXTO_Msk | UARTE_INTENSET_ERROR_Msk;
+
+	// Idle timer with 1 MHz, stops itself on timeout
+	GNSS_TIMER->TASKS_STOP = 1;
+	GNSS_TIMER->TASKS_CLEAR = 1;
+	GNSS_TIMER->MODE = TIMER_MODE_MODE_Timer;
+	GNSS_TIMER->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+	GNSS_TIMER->PRESCALER = 4;
+	GNSS_TIMER->CC[0] = (GNSS_UART_IDLE_BYTES * 10 * 1000000UL) / baudrate;
+	GNSS_TIMER->SHORTS = TIMER_SHORTS_COMPARE0_STOP_Msk;
+	GNSS_TIMER->EVENTS_COMPARE[0] = 0;
+
+	sd_ppi_channel_assign(GNSS_PPI_CLEAR, &GNSS_UARTE->EVENTS_RXDRDY, &GNSS_TIMER->TASKS_CLEAR);
+	sd_ppi_channel_assign(GNSS_PPI_START, &GNSS_UARTE->EVENTS_RXDRDY, &GNSS_TIMER->TASKS_START);
+	sd_ppi_channel_assign(GNSS_PPI_STOP, &GNSS_TIMER->EVENTS_COMPARE[0], &GNSS_UARTE->TASKS_STOPRX);
+	sd_ppi_channel_enable_set(GNSS_PPI_MASK);
+
+	NVIC_SetPriority(GNSS_UARTE_IRQn, 3);
+	NVIC_ClearPendingIRQ(GNSS_UARTE_IRQn);
+	NVIC_EnableIRQ(GNSS_UARTE_IRQn);
+
+	gnss_uart_active = true;
+	GNSS_UARTE->ENABLE = UARTE_ENABLE_ENABLE_Enabled;
+	GNSS_UARTE->TASKS_STARTRX = 1;
+	MYLOG("GNSS", "UARTE started with %ld baud", (long)baudrate);
+}
+
+/**
+ * @brief Stop the reception, the UARTE and the timer release the high frequency clock
+ *
+ */
+void gnss_uart_end(void)
+{
+	if (!gnss_uart_active)
+	{
+		return;
+	}
+	gnss_uart_active = false;
+	sd_ppi_channel_enable_clr(GNSS_PPI_MASK);
+	GNSS_TIMER->TASKS_STOP = 1;
+
+	NVIC_DisableIRQ(GNSS_UARTE_IRQn);
+	GNSS_UARTE->INTENCLR = 0xFFFFFFFF;
+	GNSS_UARTE->EVENTS_RXTO = 0;
+	GNSS_UARTE->TASKS_STOPRX = 1;
+	// RXTO follows within a few byte times
+	time_t wait_start = millis();
+	while ((GNSS_UARTE->EVENTS_RXTO == 0) && ((millis() - wait_start) < 10))
+	{
+		delay(1);
+	}
+	GNSS_UARTE->EVENTS_RXTO = 0;
+	GNSS_UARTE->ENABLE = UARTE_ENABLE_ENABLE_Disabled;
+}
+
+/**
+ * @brief Wait for the next chunk of received data
+ *
+ * @param data pointer to the chunk, valid until the other buffer is filled
+ * @param timeout maximum wait time in ms
+ * @return uint16_t length of the chunk, 0 if nothing was received
+ */
+uint16_t gnss_uart_receive(uint8_t **data, uint32_t timeout)
+{
+	gnss_chunk_s chunk;
+	if (!gnss_uart_active || (xQueueReceive(gnss_rx_queue, &chunk, pdMS_TO_TICKS(timeout)) != pdTRUE))
+	{
+		return 0;
+	}
+	*data = gnss_rx_buf[chunk.buf];
+	return chunk.len;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file i2c_bus.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Shared I2C bus. The u-blox GNSS is polled from the GNSS task while the
+ *        app loop reads the LIS3DH and the BME680, the bus is owned by one task
+ *        at a time. Register blocks are read in a single transfer.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Bus owner, recursive, so a sensor function can call other bus functions */
+static SemaphoreHandle_t i2c_mutex = NULL;
+#if STATIC_MEM > 0
+static StaticSemaphore_t i2c_mutex_buf;
+#endif
+
+/** Register address bit for auto increment on the LIS3DH */
+#define I2C_AUTO_INC 0x80
+
+/**
+ * @brief Start the I2C bus and create the bus lock
+ *
+ */
+void init_i2c_bus(void)
+{
+#if STATIC_MEM > 0
+	i2c_mutex = xSemaphoreCreateRecursiveMutexStatic(&i2c_mutex_buf);
+#else
+	i2c_mutex = xSemaphoreCreateRecursiveMutex();
+#endif
+	Wire.begin();
+	Wire.setClock(400000);
+}
+
+/**
+ * @brief Take the bus, blocks until the other task released it
+ *
+ */
+void i2c_lock(void)
+{
+	if (i2c_mutex != NULL)
+	{
+		xSemaphoreTakeRecursive(i2c_mutex, portMAX_DELAY);
+	}
+}
+
+/**
+ * @brief Release the bus
+ *
+ */
+void i2c_unlock(void)
+{
+	if (i2c_mutex != NULL)
+	{
+		xSemaphoreGiveRecursive(i2c_mutex);
+	}
+}
+
+/**
+ * @brief Read consecutive registers in a single transfer,
+ *        register address write and data read with a repeated start
+ *
+ * @param addr I2C address of the device
+ * @param reg first register
+ * @param data buffer for the register values
+ * @param len number of registers
+ * @param auto_inc true if the device needs the auto increment bit in the register address
+ * @return true if all registers were read
+ * @return false if the device did not answer
+ */
+bool i2c_read_regs(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len, bool auto_inc)
+{
+	bool result = false;
+	i2c_lock();
+	Wire.beginTransmission(addr);
+	Wire.write(auto_inc ? (uint8_t)(reg | I2C_AUTO_INC) : reg);
+	if (Wire.endTransmission(false) == 0)
+	{
+		if (Wire.requestFrom(addr, (size_t)len) == len)
+		{
+			for (uint8_t idx = 0; idx < len; idx++)
+			{
+				data[idx] = Wire.read();
+			}
+			result = true;
+		}
+	}
+	i2c_unlock();
+	return result;
+}
@@ -0,0 +1,284 @@
+/**
+ * @file location.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Location rules of the send cycle: the distance filter, the skipped
+ *        location searches, the cached location and the search time. No
+ *        hardware access, the file is built into tools/battery_sim as well.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "track_simplify.h"
+
+/** Distance filter, minimum distance in m to the last sent location, 0 = off */
+uint16_t g_filter_distance = 0;
+/** Distance filter, maximum time in minutes between two uplinks, 0 = no limit */
+uint16_t g_filter_time = 0;
+
+/** Last location that passed the distance filter */
+static int32_t filter_latitude = 0;
+static int32_t filter_longitude = 0;
+static bool filter_valid = false;
+/** Time in ms (sched_now()) of the last location that passed the distance filter */
+static uint64_t filter_time = 0;
+/** Number of suppressed locations in a row */
+static uint8_t filter_suppressed = 0;
+/** Number of location searches that are skipped */
+static uint8_t filter_skip = 0;
+
+/** Maximum number of skipped location searches */
+#define FILTER_MAX_SKIP 15
+
+/** Maximum age in minutes of a cached location, 0 = always search the location */
+uint16_t g_cache_max_age = 0;
+/** Maximum age in minutes of the cached location sent immediately on an ACC trigger, 0 = off */
+uint16_t g_motion_fix_age = 0;
+
+/** Last good location */
+static int32_t cache_latitude = 0;
+static int32_t cache_longitude = 0;
+static int32_t cache_altitude = 0;
+static uint32_t cache_fix_time = 0;
+static bool cache_valid = false;
+/** Time in ms (sched_now()) of the last good location */
+static uint64_t cache_time = 0;
+/** Number of ACC interrupts since the last good location */
+static volatile uint16_t cache_motion = 0;
+
+/**
+ * @brief Distance between two locations, equirectangular approximation in fixed point
+ *        Error is below 0.5 % up to a few 100 km, larger distances are limited to ~3300 km
+ *
+ * @param lat_1 latitude of the first location in 1/10000000 degree
+ * @param lon_1 longitude of the first location in 1/10000000 degree
+ * @param lat_2 latitude of the second location in 1/10000000 degree
+ * @param lon_2 longitude of the second location in 1/10000000 degree
+ * @return uint32_t distance in m
+ */
+uint32_t gnss_distance(int32_t lat_1, int32_t lon_1, int32_t lat_2, int32_t lon_2)
+{
+	int64_t d_lon = (int64_t)lon_2 - lon_1;
+	// Shortest way over the date line
+	if (d_lon > 1800000000LL)
+	{
+		d_lon -= 3600000000LL;
+	}
+	else if (d_lon < -1800000000LL)
+	{
+		d_lon += 3600000000LL;
+	}
+	// Longitude scaled with the cosine of the mean latitude, units of 1/10000000 degree latitude
+	int64_t d_x = (d_lon * ts_cos_q15((int32_t)(((int64_t)lat_1 + lat_2) / 2))) >> 15;
+	int64_t d_y = (int64_t)lat_2 - lat_1;
+	if (ts_abs(d_x) > TS_MAX_DELTA)
+	{
+		d_x = TS_MAX_DELTA;
+	}
+	if (ts_abs(d_y) > TS_MAX_DELTA)
+	{
+		d_y = TS_MAX_DELTA;
+	}
+	// 1 m is ~89.83 units of 1/10000000 degree latitude
+	return ((uint64_t)ts_isqrt(d_x * d_x + d_y * d_y) * 100) / 8983;
+}
+
+/**
+ * @brief Check the location against the distance filter
+ *
+ * @param data collected values with the location
+ * @return true if the uplink should be suppressed, the location is too close to the last sent location
+ * @return false if the uplink should be sent
+ */
+bool gnss_filter(tracker_data_s *data)
+{
+	if ((g_filter_distance == 0) || ((data->valid & (1 << PAYLOAD_LOCATION)) == 0))
+	{
+		return false;
+	}
+
+	if (filter_valid)
+	{
+		uint32_t distance = gnss_distance(filter_latitude, filter_longitude, data->latitude, data->longitude);
+		bool timed_out = (g_filter_time != 0) && ((sched_now() - filter_time) >= (uint64_t)g_filter_time * 60000);
+		if ((distance <= g_filter_distance) && !timed_out)
+		{
+			// Every suppressed location doubles the number of skipped location searches
+			if (filter_suppressed < 8)
+			{
+				filter_suppressed++;
+			}
+			filter_skip = (1 << filter_suppressed) - 1;
+			if (filter_skip > FILTER_MAX_SKIP)
+			{
+				filter_skip = FILTER_MAX_SKIP;
+			}
+			MYLOG("GNSS", "Distance %ld m, uplink suppressed, skip %d searches", (long)distance, filter_skip);
+			return true;
+		}
+		MYLOG("GNSS", "Distance %ld m%s", (long)distance, timed_out ? ", time limit reached" : "");
+	}
+
+	filter_latitude = data->latitude;
+	filter_longitude = data->longitude;
+	filter_valid = true;
+	filter_time = sched_now();
+	filter_suppressed = 0;
+	filter_skip = 0;
+	return false;
+}
+
+/**
+ * @brief Check if the location search of this cycle can be skipped,
+ *        the last locations were suppressed by the distance filter
+ *
+ * @return true if the location search is skipped
+ */
+bool gnss_skip_search(void)
+{
+	if ((g_filter_distance == 0) || (filter_skip == 0))
+	{
+		return false;
+	}
+	if ((g_filter_time != 0) && ((sched_now() - filter_time) >= (uint64_t)g_filter_time * 60000))
+	{
+		// Time limit reached, a location has to be sent
+		return false;
+	}
+	filter_skip--;
+	return true;
+}
+
+/**
+ * @brief Movement detected, stop skipping location searches
+ *
+ */
+void gnss_motion(void)
+{
+	filter_skip = 0;
+	filter_suppressed = 0;
+	if (cache_motion < 0xFFFF)
+	{
+		cache_motion++;
+	}
+}
+
+/**
+ * @brief Add the last good location if it is not older than max_age
+ *
+ * @param data collected values, the cached location and its age are added
+ * @param max_age maximum age in minutes
+ * @return true if the cached location was added
+ */
+static bool gnss_add_cached(tracker_data_s *data, uint16_t max_age)
+{
+	if (!cache_valid || g_is_helium)
+	{
+		return false;
+	}
+	uint32_t age = (uint32_t)((sched_now() - cache_time) / 1000);
+	if (age >= (uint32_t)max_age * 60)
+	{
+		// Too old, get a new location
+		return false;
+	}
+	data->latitude = cache_latitude;
+	data->longitude = cache_longitude;
+	data->altitude = cache_altitude;
+	data->fix_time = cache_fix_time;
+	data->speed = 0.0;
+	data->heading = 0.0;
+	data->fix_age = age;
+	data->valid |= (1 << PAYLOAD_LOCATION) | (1 << PAYLOAD_FIX_AGE);
+	MYLOG("GNSS", "Cached location, age %ld s", (long)age);
+	return true;
+}
+
+/**
+ * @brief Use the last good location if the accelerometer did not detect a movement since then
+ *
+ * @param data collected values, the cached location and its age are added
+ * @return true if the cached location was added, the location search can be skipped
+ * @return false if a new location search is required
+ */
+bool gnss_cached_fix(tracker_data_s *data)
+{
+	// Without the accelerometer a movement is not detected, the location is searched in every cycle
+	if ((g_cache_max_age == 0) || !acc_ok || (cache_motion != 0))
+	{
+		return false;
+	}
+	return gnss_add_cached(data, g_cache_max_age);
+}
+
+/**
+ * @brief Use the last good location for an immediate uplink after an ACC trigger.
+ *        The location is marked as moving, the new location is sent after the search.
+ *
+ * @param data collected values, the cached location, its age and the moving flag are added
+ * @return true if the cached location was added
+ * @return false if the fast path is off or there is no recent location
+ */
+bool gnss_motion_fix(tracker_data_s *data)
+{
+	if (g_motion_fix_age == 0)
+	{
+		return false;
+	}
+	if (!gnss_add_cached(data, g_motion_fix_age))
+	{
+		return false;
+	}
+	data->moving = 1;
+	data->valid |= (1 << PAYLOAD_MOTION);
+	return true;
+}
+
+/**
+ * @brief Keep a good location for the cycles without movement
+ *
+ * @param latitude latitude in 1/10000000 degree
+ * @param longitude longitude in 1/10000000 degree
+ * @param altitude altitude in mm
+ * @param fix_time time of the location
+ */
+void gnss_cache_fix(int32_t latitude, int32_t longitude, int32_t altitude, uint32_t fix_time)
+{
+	cache_latitude = latitude;
+	cache_longitude = longitude;
+	cache_altitude = altitude;
+	cache_fix_time = fix_time;
+	cache_time = sched_now();
+	cache_motion = 0;
+	cache_valid = true;
+}
+
+/**
+ * @brief Get the maximum time of a location search
+ *
+ * @return uint32_t time in ms
+ */
+uint32_t gnss_search_time(void)
+{
+	uint32_t check_limit = 90000;
+
+	if (g_lorawan_settings.send_repeat_time == 0)
+	{
+		check_limit = 90000;
+	}
+	else if (g_lorawan_settings.send_repeat_time <= 90000)
+	{
+		check_limit = g_lorawan_settings.send_repeat_time / 2;
+	}
+	else
+	{
+		check_limit = 90000;
+	}
+
+#if FAKE_GPS > 0
+	check_limit = 1000;
+#endif
+	return check_limit;
+}
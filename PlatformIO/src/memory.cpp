@@ -0,0 +1,136 @@
+/**
+ * @file memory.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Memory telemetry, stack high water marks of the tasks and heap statistics.
+ *        The heap of the core is the newlib heap, FreeRTOS has no minimum ever free
+ *        heap for it, the minimum is sampled on each STATUS event and uplink.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include <malloc.h>
+#include <unistd.h>
+
+/** Maximum number of tasks in the status */
+#define MEM_MAX_TASKS 12
+
+/** Free chunk of the newlib nano malloc */
+struct mem_chunk_s
+{
+	long size;
+	mem_chunk_s *next;
+};
+/** Free list of the newlib nano malloc */
+extern "C" mem_chunk_s *__malloc_free_list;
+/** End of the heap from the linker script */
+extern "C" unsigned char __HeapLimit[];
+
+/** Flag if the memory values are added to the payload */
+bool g_mem_payload = false;
+
+/** Lowest free heap seen */
+static uint32_t mem_min_free = 0xFFFFFFFF;
+
+/** Task list, static to keep it off the stack of the caller */
+static TaskStatus_t mem_tasks[MEM_MAX_TASKS];
+
+/**
+ * @brief Get the free heap and update the minimum
+ *
+ * @return uint32_t free heap in bytes
+ */
+static uint32_t mem_free(void)
+{
+	uint32_t free_heap = (uint32_t)(dbgHeapTotal() - dbgHeapUsed());
+	if (free_heap < mem_min_free)
+	{
+		mem_min_free = free_heap;
+	}
+	return free_heap;
+}
+
+/**
+ * @brief Get the largest block that can be allocated, the largest free chunk
+ *        or the part of the heap that malloc did not take yet
+ *
+ * @return uint32_t size in bytes
+ */
+static uint32_t mem_largest(void)
+{
+	uint32_t largest = (uint32_t)(__HeapLimit - (unsigned char *)sbrk(0));
+	// The malloc lock of the core suspends the scheduler as well
+	vTaskSuspendAll();
+	for (mem_chunk_s *chunk = __malloc_free_list; chunk != NULL; chunk = chunk->next)
+	{
+		if ((uint32_t)chunk->size > largest)
+		{
+			largest = (uint32_t)chunk->size;
+		}
+	}
+	xTaskResumeAll();
+	return largest;
+}
+
+/**
+ * @brief Get the task list
+ *
+ * @return UBaseType_t number of tasks in mem_tasks
+ */
+static UBaseType_t mem_task_list(void)
+{
+	return uxTaskGetSystemState(mem_tasks, MEM_MAX_TASKS, NULL);
+}
+
+/**
+ * @brief Sample the free heap, called on each STATUS event
+ *
+ */
+void mem_sample(void)
+{
+	mem_free();
+}
+
+/**
+ * @brief Add the minimum free heap and the lowest stack high water mark to the payload
+ *
+ * @param data tracker data
+ */
+void mem_payload(tracker_data_s *data)
+{
+	mem_free();
+	UBaseType_t num = mem_task_list();
+	uint32_t stack_min = 0xFFFFFFFF;
+	for (UBaseType_t idx = 0; idx < num; idx++)
+	{
+		if (mem_tasks[idx].usStackHighWaterMark < stack_min)
+		{
+			stack_min = mem_tasks[idx].usStackHighWaterMark;
+		}
+	}
+	data->heap_min = mem_min_free;
+	data->stack_min = num != 0 ? stack_min : 0;
+	data->valid |= (1 << PAYLOAD_MEMORY);
+}
+
+/**
+ * @brief Write the memory status into a buffer.
+ *        Heap <free>/<min free>/<largest block> in bytes and the stack high water mark
+ *        in words (4 bytes) per task.
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void mem_status(char *buffer, size_t size)
+{
+	uint32_t free_heap = mem_free();
+	int len = snprintf(buffer, size, "Heap %ld/%ld/%ld", (long)free_heap, (long)mem_min_free, (long)mem_largest());
+	UBaseType_t num = mem_task_list();
+	for (UBaseType_t idx = 0; (idx < num) && (len > 0) && ((size_t)len < size); idx++)
+	{
+		len += snprintf(&buffer[len], size - len, " %s %d", mem_tasks[idx].pcTaskName, mem_tasks[idx].usStackHighWaterMark);
+	}
+	MYLOG("MEM", "%s", buffer);
+}
@@ -0,0 +1,175 @@
+/**
+ * @file pipeline.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Sensor acquisition pipeline of a location uplink. The stages (GNSS,
+ *        BME680, battery, ACC) run at the same time and report when they are
+ *        finished, the uplink is sent when all required stages are finished
+ *        or the deadline of the cycle has passed.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Time in ms after the GNSS timeout until the uplink is sent without the missing stages */
+#define PIPE_MARGIN 5000
+
+/** Stage names for the status */
+static const char *pipe_names[PIPE_NUM_STAGES] = {"GNSS", "ENV", "BATT", "ACC"};
+
+/** Flag if a cycle is running */
+static bool pipe_active = false;
+/** Required and finished stages of the running cycle */
+static uint8_t pipe_required = 0;
+static uint8_t pipe_finished = 0;
+/** Start of the running cycle */
+static uint64_t pipe_start_time = 0;
+
+/** Statistics per stage and for the uplink */
+static uint32_t pipe_last[PIPE_NUM_STAGES + 1];
+static uint32_t pipe_max[PIPE_NUM_STAGES + 1];
+static uint16_t pipe_timeouts[PIPE_NUM_STAGES + 1];
+/** Stage completions that did not belong to a running cycle */
+static uint16_t pipe_late = 0;
+
+/**
+ * @brief Remember the latency of a stage or the uplink
+ *
+ */
+static void pipe_latency(uint8_t idx, uint32_t latency)
+{
+	pipe_last[idx] = latency;
+	if (latency > pipe_max[idx])
+	{
+		pipe_max[idx] = latency;
+	}
+}
+
+/**
+ * @brief All required stages are finished or the deadline passed, send the uplink
+ *
+ */
+static void pipe_complete(void)
+{
+	pipe_active = false;
+	sched_cancel(SCHED_PIPE);
+	pipe_latency(PIPE_NUM_STAGES, (uint32_t)(sched_now() - pipe_start_time));
+	MYLOG("PIPE", "Uplink after %ld ms", (long)pipe_last[PIPE_NUM_STAGES]);
+	send_location();
+}
+
+/**
+ * @brief Start a cycle or add stages to the running cycle
+ *
+ * @param stages bit mask of the required stages (1 << pipe_stage)
+ * @param timeout time in ms until the uplink is sent without the missing stages
+ */
+void pipe_start(uint8_t stages, uint32_t timeout)
+{
+	if (pipe_active)
+	{
+		// Stages that are already finished are not repeated
+		pipe_required |= stages;
+		MYLOG("PIPE", "Cycle running, stages %02X", pipe_required);
+	}
+	else
+	{
+		pipe_active = true;
+		pipe_required = stages;
+		pipe_finished = 0;
+		pipe_start_time = sched_now();
+	}
+	uint64_t deadline = sched_now() + timeout + PIPE_MARGIN;
+	if (deadline > sched_deadline(SCHED_PIPE))
+	{
+		sched_arm(SCHED_PIPE, deadline);
+	}
+}
+
+/**
+ * @brief A stage is finished
+ *
+ * @param stage pipe_stage value
+ */
+void pipe_done(uint8_t stage)
+{
+	uint8_t mask = 1 << stage;
+	if (!pipe_active || ((pipe_required & mask) == 0))
+	{
+		// Stage was started without a cycle or finished after the deadline, the value goes with the next uplink
+		pipe_late++;
+		MYLOG("PIPE", "%s finished without a cycle", pipe_names[stage]);
+		return;
+	}
+	if ((pipe_finished & mask) != 0)
+	{
+		return;
+	}
+	pipe_finished |= mask;
+	pipe_latency(stage, (uint32_t)(sched_now() - pipe_start_time));
+	MYLOG("PIPE", "%s finished after %ld ms", pipe_names[stage], (long)pipe_last[stage]);
+	if ((pipe_finished & pipe_required) == pipe_required)
+	{
+		pipe_complete();
+	}
+}
+
+/**
+ * @brief Deadline of the cycle passed, called by the scheduler
+ *
+ */
+void pipe_timeout(void)
+{
+	if (!pipe_active)
+	{
+		return;
+	}
+	for (uint8_t stage = 0; stage < PIPE_NUM_STAGES; stage++)
+	{
+		if (((pipe_required & (1 << stage)) != 0) && ((pipe_finished & (1 << stage)) == 0))
+		{
+			pipe_timeouts[stage]++;
+			MYLOG("PIPE", "%s timeout", pipe_names[stage]);
+		}
+	}
+	pipe_timeouts[PIPE_NUM_STAGES]++;
+	pipe_complete();
+}
+
+/**
+ * @brief Reset the statistics
+ *
+ */
+void pipe_reset(void)
+{
+	for (uint8_t idx = 0; idx <= PIPE_NUM_STAGES; idx++)
+	{
+		pipe_last[idx] = 0;
+		pipe_max[idx] = 0;
+		pipe_timeouts[idx] = 0;
+	}
+	pipe_late = 0;
+}
+
+/**
+ * @brief Write the latencies into a buffer, <last ms>/<max ms>/<timeouts> per stage and for the uplink,
+ *        followed by the number of stage completions without a cycle
+ *
+ * @param buffer buffer for the status
+ * @param size size of the buffer
+ */
+void pipe_status(char *buffer, size_t size)
+{
+	int len = 0;
+	for (uint8_t idx = 0; (idx <= PIPE_NUM_STAGES) && (len >= 0) && ((size_t)len < size); idx++)
+	{
+		len += snprintf(&buffer[len], size - len, "%s%s %ld/%ld/%d", idx == 0 ? "" : " ",
+						idx < PIPE_NUM_STAGES ? pipe_names[idx] : "UPLINK", (long)pipe_last[idx], (long)pipe_max[idx], pipe_timeouts[idx]);
+	}
+	if ((len >= 0) && ((size_t)len < size))
+	{
+		snprintf(&buffer[len], size - len, " LATE %d", pipe_late);
+	}
+}
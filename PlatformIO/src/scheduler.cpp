@@ -0,0 +1,228 @@
+/**
+ * @file scheduler.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Deadline scheduler for the periodic send, the delayed send, the BME680
+ *        conversion, the GNSS timeout and the uplink deadline. One timer is armed
+ *        for the earliest deadline, the due jobs are run in the app loop.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "scheduler.h"
+
+/** Longest timer period in ms, longer waits are split */
+#define SCHED_MAX_WAIT 3600000
+
+/** Timer for the earliest deadline */
+static TimerHandle_t sched_timer = NULL;
+#if STATIC_MEM > 0
+static StaticTimer_t sched_timer_buf;
+#endif
+/** Deadline the timer is armed for, 0 = timer stopped */
+static uint64_t sched_timer_deadline = 0;
+
+/** 64 bit time */
+static sched_clock sched_time;
+/** Armed jobs */
+static sched_heap sched_jobs;
+
+/** Interval of the periodic send in ms */
+static uint32_t sched_send_interval = 0;
+/** Send interval of the last check, changes by AT+SENDINT are detected */
+static uint32_t sched_send_setting = 0;
+
+/**
+ * @brief Timer callback, the due jobs are run in the app loop
+ *
+ * @param unused
+ */
+static void sched_timer_cb(TimerHandle_t unused)
+{
+	(void)unused;
+	app_wake(SCHED_DUE);
+}
+
+/**
+ * @brief Arm the timer for the earliest deadline
+ *
+ */
+static void sched_update_timer(void)
+{
+	if (sched_jobs.empty())
+	{
+		if (sched_timer_deadline != 0)
+		{
+			xTimerStop(sched_timer, 0);
+			sched_timer_deadline = 0;
+		}
+		return;
+	}
+	uint64_t earliest = sched_jobs.earliest();
+	if (earliest == sched_timer_deadline)
+	{
+		return;
+	}
+	uint64_t now = sched_now();
+	uint64_t wait = earliest > now ? earliest - now : 1;
+	if (wait > SCHED_MAX_WAIT)
+	{
+		wait = SCHED_MAX_WAIT;
+	}
+	// Changing the period starts the timer
+	xTimerChangePeriod(sched_timer, pdMS_TO_TICKS((uint32_t)wait), 0);
+	sched_timer_deadline = earliest;
+}
+
+/**
+ * @brief Initialize the scheduler timer
+ *
+ */
+void init_sched(void)
+{
+#if STATIC_MEM > 0
+	sched_timer = xTimerCreateStatic("SCHED", pdMS_TO_TICKS(SCHED_MAX_WAIT), pdFALSE, NULL, sched_timer_cb, &sched_timer_buf);
+#else
+	sched_timer = xTimerCreate("SCHED", pdMS_TO_TICKS(SCHED_MAX_WAIT), pdFALSE, NULL, sched_timer_cb);
+#endif
+	sched_send_setting = g_lorawan_settings.send_repeat_time;
+}
+
+/**
+ * @brief Get the time since boot, does not wrap.
+ *        Called from the app loop and the GNSS task, the counter is read and extended
+ *        in a critical section, otherwise an older value after a newer one counts as wrap.
+ *
+ * @return uint64_t time in ms
+ */
+uint64_t sched_now(void)
+{
+	taskENTER_CRITICAL();
+	uint64_t now = sched_time.extend(millis());
+	taskEXIT_CRITICAL();
+	return now;
+}
+
+/**
+ * @brief Arm a job, an armed job is moved to the new deadline
+ *
+ * @param job job ID
+ * @param deadline time in ms (sched_now() based)
+ */
+void sched_arm(uint8_t job, uint64_t deadline)
+{
+	sched_jobs.arm(job, deadline);
+	sched_update_timer();
+}
+
+/**
+ * @brief Cancel a job
+ *
+ * @param job job ID
+ */
+void sched_cancel(uint8_t job)
+{
+	sched_jobs.cancel(job);
+	sched_update_timer();
+}
+
+/**
+ * @brief Check if a job is armed
+ *
+ * @param job job ID
+ */
+bool sched_pending(uint8_t job)
+{
+	return sched_jobs.pending(job);
+}
+
+/**
+ * @brief Deadline of a job
+ *
+ * @param job job ID
+ * @return uint64_t deadline in ms, 0 if the job is not armed
+ */
+uint64_t sched_deadline(uint8_t job)
+{
+	return sched_jobs.deadline(job);
+}
+
+/**
+ * @brief Restart the periodic send with a new interval.
+ *        Replaces the timer of the WisBlock API, which is stopped.
+ *
+ * @param interval interval in ms
+ */
+void sched_send_restart(uint32_t interval)
+{
+	api_timer_stop();
+	sched_send_interval = interval;
+	if ((g_lorawan_settings.send_repeat_time == 0) || (interval == 0))
+	{
+		sched_cancel(SCHED_SEND);
+		return;
+	}
+	sched_arm(SCHED_SEND, sched_now() + interval);
+}
+
+/**
+ * @brief Check on each STATUS event if the WisBlock API restarted its timer
+ *        after a join or a change of the send interval and take over the periodic send
+ *
+ */
+void sched_send_check(void)
+{
+	api_timer_stop();
+	if (g_lorawan_settings.send_repeat_time != sched_send_setting)
+	{
+		sched_send_setting = g_lorawan_settings.send_repeat_time;
+		sched_send_restart(adapt_interval());
+	}
+	else if (!sched_pending(SCHED_SEND) && (g_lorawan_settings.send_repeat_time != 0))
+	{
+		sched_send_restart(sched_send_interval != 0 ? sched_send_interval : adapt_interval());
+	}
+}
+
+/**
+ * @brief Run the due jobs, called by the app loop on SCHED_DUE
+ *
+ */
+void sched_run(void)
+{
+	// The timer is a one shot timer
+	sched_timer_deadline = 0;
+	uint64_t now = sched_now();
+	sched_entry_s job;
+	while (sched_jobs.pop_due(now, &job))
+	{
+		switch (job.id)
+		{
+		case SCHED_SEND:
+			if ((g_lorawan_settings.send_repeat_time != 0) && (sched_send_interval != 0))
+			{
+				app_event_set(STATUS);
+				// Fixed rate, without drift
+				uint64_t next = job.deadline + sched_send_interval;
+				sched_jobs.arm(SCHED_SEND, next > now ? next : now + sched_send_interval);
+			}
+			break;
+		case SCHED_DELAYED:
+			app_event_set(STATUS);
+			break;
+		case SCHED_BME:
+			read_bme();
+			pipe_done(PIPE_ENV);
+			break;
+		case SCHED_GNSS:
+			gnss_search_timeout();
+			break;
+		case SCHED_PIPE:
+			pipe_timeout();
+			break;
+		}
+	}
+	sched_update_timer();
+}
@@ -0,0 +1,238 @@
+/**
+ * @file scheduler.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Deadline scheduler. A binary heap of jobs ordered by 64 bit deadlines
+ *        in ms, so a single timer for the earliest deadline serves all jobs.
+ *        Header only and without Arduino dependencies.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/** Maximum number of jobs, job IDs are 0 .. SCHED_MAX_JOBS - 1 */
+#define SCHED_MAX_JOBS 8
+/** Heap position of a job that is not armed */
+#define SCHED_IDLE 0xFF
+
+/**
+ * @brief Extends a wrapping 32 bit ms counter to 64 bit.
+ *        Has to be called at least once per wrap of the counter (~49 days).
+ *        Not thread safe, read the counter and call extend() in a critical section.
+ *
+ */
+class sched_clock
+{
+public:
+	sched_clock(void) : _last(0), _high(0) {}
+
+	/**
+	 * @brief Get the 64 bit time
+	 *
+	 * @param now current value of the 32 bit counter
+	 * @return uint64_t time in ms
+	 */
+	uint64_t extend(uint32_t now)
+	{
+		if (now < _last)
+		{
+			_high++;
+		}
+		_last = now;
+		return ((uint64_t)_high << 32) | now;
+	}
+
+private:
+	uint32_t _last;
+	uint32_t _high;
+};
+
+/** Armed job */
+struct sched_entry_s
+{
+	uint64_t deadline;
+	uint8_t id;
+};
+
+/**
+ * @brief Binary min heap of the armed jobs, each job is armed at most once
+ *
+ */
+class sched_heap
+{
+public:
+	sched_heap(void) : _num(0)
+	{
+		for (uint8_t id = 0; id < SCHED_MAX_JOBS; id++)
+		{
+			_pos[id] = SCHED_IDLE;
+		}
+	}
+
+	/**
+	 * @brief Arm a job, an armed job is moved to the new deadline
+	 *
+	 * @param id job ID
+	 * @param deadline time in ms
+	 * @return true if the job is armed
+	 * @return false if the ID is invalid
+	 */
+	bool arm(uint8_t id, uint64_t deadline)
+	{
+		if (id >= SCHED_MAX_JOBS)
+		{
+			return false;
+		}
+		uint8_t pos = _pos[id];
+		if (pos == SCHED_IDLE)
+		{
+			pos = _num++;
+			_heap[pos].id = id;
+			_pos[id] = pos;
+		}
+		_heap[pos].deadline = deadline;
+		down(up(pos));
+		return true;
+	}
+
+	/**
+	 * @brief Remove a job from the heap
+	 *
+	 * @param id job ID
+	 */
+	void cancel(uint8_t id)
+	{
+		if ((id >= SCHED_MAX_JOBS) || (_pos[id] == SCHED_IDLE))
+		{
+			return;
+		}
+		uint8_t pos = _pos[id];
+		_pos[id] = SCHED_IDLE;
+		_num--;
+		if (pos != _num)
+		{
+			// Fill the gap with the last entry
+			_heap[pos] = _heap[_num];
+			_pos[_heap[pos].id] = pos;
+			down(up(pos));
+		}
+	}
+
+	/**
+	 * @brief Check if a job is armed
+	 *
+	 */
+	bool pending(uint8_t id)
+	{
+		return (id < SCHED_MAX_JOBS) && (_pos[id] != SCHED_IDLE);
+	}
+
+	/**
+	 * @brief Deadline of an armed job
+	 *
+	 * @return uint64_t deadline in ms, 0 if the job is not armed
+	 */
+	uint64_t deadline(uint8_t id)
+	{
+		return pending(id) ? _heap[_pos[id]].deadline : 0;
+	}
+
+	/**
+	 * @brief Check if no job is armed
+	 *
+	 */
+	bool empty(void)
+	{
+		return _num == 0;
+	}
+
+	/**
+	 * @brief Earliest deadline, only valid if the heap is not empty
+	 *
+	 */
+	uint64_t earliest(void)
+	{
+		return _heap[0].deadline;
+	}
+
+	/**
+	 * @brief Remove the earliest job if it is due
+	 *
+	 * @param now current time in ms
+	 * @param entry the due job
+	 * @return true if a job was due
+	 */
+	bool pop_due(uint64_t now, sched_entry_s *entry)
+	{
+		if ((_num == 0) || (_heap[0].deadline > now))
+		{
+			return false;
+		}
+		*entry = _heap[0];
+		cancel(entry->id);
+		return true;
+	}
+
+private:
+	/** Order by deadline, same deadlines by job ID */
+	bool before(uint8_t a, uint8_t b)
+	{
+		return (_heap[a].deadline < _heap[b].deadline) ||
+			   ((_heap[a].deadline == _heap[b].deadline) && (_heap[a].id < _heap[b].id));
+	}
+
+	void swap(uint8_t a, uint8_t b)
+	{
+		sched_entry_s entry = _heap[a];
+		_heap[a] = _heap[b];
+		_heap[b] = entry;
+		_pos[_heap[a].id] = a;
+		_pos[_heap[b].id] = b;
+	}
+
+	uint8_t up(uint8_t pos)
+	{
+		while ((pos > 0) && before(pos, (pos - 1) / 2))
+		{
+			swap(pos, (pos - 1) / 2);
+			pos = (pos - 1) / 2;
+		}
+		return pos;
+	}
+
+	void down(uint8_t pos)
+	{
+		while (true)
+		{
+			uint8_t first = pos;
+			uint8_t left = 2 * pos + 1;
+			uint8_t right = left + 1;
+			if ((left < _num) && before(left, first))
+			{
+				first = left;
+			}
+			if ((right < _num) && before(right, first))
+			{
+				first = right;
+			}
+			if (first == pos)
+			{
+				return;
+			}
+			swap(pos, first);
+			pos = first;
+		}
+	}
+
+	sched_entry_s _heap[SCHED_MAX_JOBS];
+	uint8_t _pos[SCHED_MAX_JOBS];
+	uint8_t _num;
+};
+
+#endif
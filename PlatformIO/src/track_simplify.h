@@ -0,0 +1,234 @@
+/**
+ * @file track_simplify.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Streaming track simplification (opening window variant of Douglas-Peucker).
+ *        Integer math only, bounded memory, header only and without Arduino
+ *        dependencies, so it can be used on the device and on a host.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * A point is kept if one of the points between the last kept point (anchor)
+ * and the new point is further away from the line anchor -> new point than
+ * the tolerance. Straight sections collapse to their end points, curves keep
+ * enough points to stay within the tolerance.
+ */
+
+#ifndef TRACK_SIMPLIFY_H
+#define TRACK_SIMPLIFY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tracker_codec.h"
+
+/** Maximum number of points between two kept points */
+#define SIMPLIFY_WINDOW 16
+
+/** Maximum coordinate difference for the distance calculation, ~30 degree */
+#define TS_MAX_DELTA (1LL << 28)
+
+/**
+ * @brief Absolute value
+ *
+ */
+static inline int64_t ts_abs(int64_t value)
+{
+	return value < 0 ? -value : value;
+}
+
+/**
+ * @brief Integer square root
+ *
+ */
+static inline uint32_t ts_isqrt(uint64_t value)
+{
+	uint64_t result = 0;
+	uint64_t bit = 1ULL << 62;
+	while (bit > value)
+	{
+		bit >>= 2;
+	}
+	while (bit != 0)
+	{
+		if (value >= result + bit)
+		{
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		}
+		else
+		{
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)result;
+}
+
+/**
+ * @brief Cosine of a latitude, Bhaskara approximation (error < 0.2 %)
+ *
+ * @param latitude latitude in 1/10000000 degree
+ * @return int32_t cosine in Q15
+ */
+static inline int32_t ts_cos_q15(int32_t latitude)
+{
+	// Latitude in 1/100 degree, 180 degree = 18000
+	int64_t deg = latitude / 100000;
+	int64_t deg2 = deg * deg;
+	return (int32_t)(((324000000LL - 4 * deg2) * 32768) / (324000000LL + deg2));
+}
+
+/**
+ * @brief Streaming track simplification
+ *
+ */
+class track_simplifier
+{
+public:
+	track_simplifier(void) : _has_anchor(false), _window_num(0), _tolerance(0), _cos_q15(32768) {}
+
+	/**
+	 * @brief Set the tolerance
+	 *
+	 * @param meters maximum distance of a dropped point from the simplified track, 0 = keep all points
+	 */
+	void set_tolerance(uint16_t meters)
+	{
+		// 1 m is ~89.83 units of 1/10000000 degree latitude
+		_tolerance = ((int32_t)meters * 8983) / 100;
+	}
+
+	/**
+	 * @brief Forget all points
+	 *
+	 */
+	void reset(void)
+	{
+		_has_anchor = false;
+		_window_num = 0;
+	}
+
+	/**
+	 * @brief Add a point
+	 *
+	 * @param point new point
+	 * @param kept point that has to be kept, valid if true is returned
+	 * @return true if a point has to be kept
+	 */
+	bool add(const tc_point_s &point, tc_point_s &kept)
+	{
+		if ((_tolerance == 0) || !_has_anchor)
+		{
+			set_anchor(point);
+			_window_num = 0;
+			kept = point;
+			return true;
+		}
+		for (uint8_t idx = 0; idx < _window_num; idx++)
+		{
+			if (exceeds(point, _window[idx]))
+			{
+				// The last point of the window is the end of the straight section
+				kept = _window[_window_num - 1];
+				set_anchor(kept);
+				_window[0] = point;
+				_window_num = 1;
+				return true;
+			}
+		}
+		_window[_window_num++] = point;
+		if (_window_num == SIMPLIFY_WINDOW)
+		{
+			// Window is full, keep the newest point to limit the memory
+			kept = point;
+			set_anchor(kept);
+			_window_num = 0;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Keep the newest point, used before the kept points are sent
+	 *
+	 * @param kept newest point, valid if true is returned
+	 * @return true if there was a point that was not yet kept
+	 */
+	bool flush(tc_point_s &kept)
+	{
+		if (_window_num == 0)
+		{
+			return false;
+		}
+		kept = _window[_window_num - 1];
+		set_anchor(kept);
+		_window_num = 0;
+		return true;
+	}
+
+private:
+	/**
+	 * @brief Set the anchor and the longitude scale for its latitude
+	 *
+	 */
+	void set_anchor(const tc_point_s &point)
+	{
+		_anchor = point;
+		_has_anchor = true;
+		_cos_q15 = ts_cos_q15(point.latitude);
+	}
+
+	/**
+	 * @brief Check the distance of a point from the segment anchor -> end
+	 *
+	 * @return true if the distance is larger than the tolerance
+	 */
+	bool exceeds(const tc_point_s &end, const tc_point_s &point)
+	{
+		// Equirectangular projection around the anchor, units of 1/10000000 degree latitude
+		int64_t seg_x = (((int64_t)end.longitude - _anchor.longitude) * _cos_q15) >> 15;
+		int64_t seg_y = (int64_t)end.latitude - _anchor.latitude;
+		int64_t pt_x = (((int64_t)point.longitude - _anchor.longitude) * _cos_q15) >> 15;
+		int64_t pt_y = (int64_t)point.latitude - _anchor.latitude;
+		if ((ts_abs(seg_x) > TS_MAX_DELTA) || (ts_abs(seg_y) > TS_MAX_DELTA) || (ts_abs(pt_x) > TS_MAX_DELTA) || (ts_abs(pt_y) > TS_MAX_DELTA))
+		{
+			// Jump of more than ~30 degree, keep the point and avoid overflows
+			return true;
+		}
+
+		int64_t seg_len2 = seg_x * seg_x + seg_y * seg_y;
+		int64_t dot = seg_x * pt_x + seg_y * pt_y;
+		uint64_t dist2;
+		if ((seg_len2 == 0) || (dot <= 0))
+		{
+			// Before the anchor
+			dist2 = pt_x * pt_x + pt_y * pt_y;
+		}
+		else if (dot >= seg_len2)
+		{
+			// Behind the end point
+			dist2 = (pt_x - seg_x) * (pt_x - seg_x) + (pt_y - seg_y) * (pt_y - seg_y);
+		}
+		else
+		{
+			// Cross track distance = |cross| / |segment|
+			int64_t cross = seg_x * pt_y - seg_y * pt_x;
+			if (cross < 0)
+			{
+				cross = -cross;
+			}
+			return (uint64_t)cross > (uint64_t)_tolerance * ts_isqrt(seg_len2);
+		}
+		return dist2 > (uint64_t)_tolerance * _tolerance;
+	}
+
+	tc_point_s _anchor;
+	bool _has_anchor;
+	tc_point_s _window[SIMPLIFY_WINDOW];
+	uint8_t _window_num;
+	int32_t _tolerance;
+	int32_t _cos_q15;
+};
+
+#endif
@@ -42,6 +42,152 @@
  * 
  */
 
+// compactDecode decodes the compact bit-packed tracker format (AT+GNSS=3)
+// into the same array of objects as lppDecode.
+// The first byte is 0xA4 + frame type, the second byte has the number of
+// queued locations in the upper nibble and the field flags in the lower nibble.
+// Sequenced frames (frame type 1) have a third byte with the sequence number
+// and the reference sequence number. Delta locations can only be rebuilt with
+// the location of the reference frame, they are returned as 'gps_delta' with
+// the offsets in degree and m and the sequence number of the reference frame.
+// Batch frames (frame type 2) have the number of points and the GNSS time of
+// the first point after the header. The points are returned on the channels
+// 30 and up with the time in seconds since 1970-01-01 UTC.
+function compactDecode(bytes) {
+
+	var bit_pos = 16;
+	var lat_step = 180 / (Math.pow(2, 25) - 1);
+	var lon_step = 360 / (Math.pow(2, 26) - 1);
+
+	function getBits(bits) {
+		var value = 0;
+		for (var i = 0; i < bits; i++) {
+			var byte_idx = bit_pos >> 3;
+			if (byte_idx >= bytes.length)
+				throw 'Compact frame too short!';
+			value = value * 2 + ((bytes[byte_idx] >> (7 - (bit_pos & 7))) & 1);
+			bit_pos++;
+		}
+		return value;
+	}
+
+	function getSigned(bits) {
+		var value = getBits(bits);
+		if (value >= Math.pow(2, bits - 1))
+			value -= Math.pow(2, bits);
+		return value;
+	}
+
+	function dequantize(value, range, bits) {
+		var steps = Math.pow(2, bits) - 1;
+		return Math.round(value * 2 * range / steps) - range;
+	}
+
+	function getLocation() {
+		return {
+			'latitude': dequantize(getBits(25), 900000000, 25) / 10000000,
+			'longitude': dequantize(getBits(26), 1800000000, 26) / 10000000,
+			'altitude': getBits(16) - 1000
+		};
+	}
+
+	function getQLocation() {
+		return [getBits(25), getBits(26), getBits(16)];
+	}
+
+	function toLocation(q, time) {
+		return {
+			'latitude': dequantize(q[0], 900000000, 25) / 10000000,
+			'longitude': dequantize(q[1], 1800000000, 26) / 10000000,
+			'altitude': q[2] - 1000,
+			'time': time
+		};
+	}
+
+	if ((bytes[0] & 0xFC) != 0xA4)
+		throw 'Unknown compact frame version!';
+
+	var frame_type = bytes[0] & 0x03;
+	var queued = bytes[1] >> 4;
+	var fields = bytes[1] & 0x0F;
+	var sensors = [];
+
+	if (frame_type > 2)
+		throw 'Unknown compact frame type!: ' + frame_type;
+
+	if (frame_type == 2) {
+		var points = getBits(8);
+		var time = getBits(32);
+		var q = getQLocation();
+		pushLocation(sensors, 30, toLocation(q, time));
+		for (var point = 1; point < points; point++) {
+			if (getBits(1)) {
+				q = getQLocation();
+			}
+			else {
+				var delta_width = 6 + 4 * getBits(2);
+				q = [q[0] + getSigned(delta_width), q[1] + getSigned(delta_width), q[2] + getSigned(8)];
+			}
+			time += getBits(getBits(1) ? 16 : 6);
+			pushLocation(sensors, 30 + point, toLocation(q, time));
+		}
+		fields &= 0x0E;
+	}
+
+	var seq = 0;
+	var ref_seq = 0;
+	if (frame_type == 1) {
+		seq = getBits(4);
+		ref_seq = getBits(4);
+		sensors.push({ 'channel': 11, 'type': 0, 'name': 'sequence', 'value': seq });
+	}
+
+	if (fields & 0x01) {
+		if (seq == ref_seq) {
+			pushLocation(sensors, 10, getLocation());
+		}
+		else {
+			var width = 6 + 4 * getBits(2);
+			sensors.push({
+				'channel': 10, 'type': 137, 'name': 'gps_delta', 'value': {
+					'reference': ref_seq,
+					'latitude': getSigned(width) * lat_step,
+					'longitude': getSigned(width) * lon_step,
+					'altitude': getSigned(8)
+				}
+			});
+		}
+	}
+	if (fields & 0x02) {
+		sensors.push({ 'channel': 1, 'type': 116, 'name': 'voltage', 'value': (getBits(8) * 10 + 2000) / 1000 });
+	}
+	if (fields & 0x04) {
+		sensors.push({
+			'channel': 64, 'type': 113, 'name': 'accelerometer', 'value': {
+				'x': getSigned(10) * 4 / 1000,
+				'y': getSigned(10) * 4 / 1000,
+				'z': getSigned(10) * 4 / 1000
+			}
+		});
+	}
+	if (fields & 0x08) {
+		sensors.push({ 'channel': 6, 'type': 104, 'name': 'humidity', 'value': getBits(8) / 2 });
+		sensors.push({ 'channel': 7, 'type': 103, 'name': 'temperature', 'value': (getBits(11) - 400) / 10 });
+		sensors.push({ 'channel': 8, 'type': 115, 'name': 'barometer', 'value': (getBits(13) + 3000) / 10 });
+		sensors.push({ 'channel': 9, 'type': 2, 'name': 'analog_in', 'value': getBits(16) / 10 });
+	}
+	for (var idx = 0; idx < queued; idx++) {
+		pushLocation(sensors, 20 + idx, getLocation());
+	}
+
+	return sensors;
+}
+
+// pushLocation adds a location to the decoded sensors
+function pushLocation(sensors, channel, location) {
+	sensors.push({ 'channel': channel, 'type': 137, 'name': 'gps', 'value': location });
+}
+
 // lppDecode decodes an array of bytes into an array of ojects, 
 // each one with the channel, the data type and the value.
 function lppDecode(bytes) {
@@ -98,6 +244,11 @@ function lppDecode(bytes) {
 
 	}
 
+	// Compact bit-packed format
+	if ((bytes.length > 1) && ((bytes[0] & 0xF0) == 0xA0)) {
+		return compactDecode(bytes);
+	}
+
 	var sensors = [];
 	var i = 0;
 	while (i < bytes.length) {
@@ -0,0 +1,1107 @@
+/**
+ * @file battery_sim.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Battery life estimator. The scheduling and send cycle code of the firmware
+ *        (send cycle, location rules, packer, batch, scheduler, sensor pipeline,
+ *        adaptive interval, airtime, energy accounting and events) is compiled for
+ *        the host and runs in virtual time. The hardware (GNSS, BME680, LIS3DH,
+ *        LoRa, flash queue) and the join are modeled here, geofences are not simulated.
+ *        The consumption of the energy accounting is integrated against the
+ *        discharge curve of assets/RAK12500-Battery-Test.xls until the battery
+ *        is empty.
+ *
+ *        Build:  g++ -O2 -I tools/battery_sim/host -I tools/battery_sim -I PlatformIO/src -o battery_sim
+ *                tools/battery_sim/battery_sim.cpp tools/battery_sim/host.cpp
+ *                PlatformIO/src/{cycle,location,packer,batch,scheduler,pipeline,adapt,airtime,energy,events}.cpp
+ *        Usage:  battery_sim [options], battery_sim --help
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "host.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+/** Power up time of the GNSS module in ms, init_gnss() waits for it */
+#define SIM_GNSS_BOOT 500
+/** Navigation rate of the GNSS module in ms, the GNSS task reads each epoch */
+#define SIM_GNSS_EPOCH 500
+/** BME680 gas heater time and conversion time in ms */
+#define SIM_BME_HEATER 150
+#define SIM_BME_TIME 190
+/** Time from the end of the uplink to the end of the second RX window in ms */
+#define SIM_RX2_DELAY 2000
+/** Size of the join request without the LoRaWAN header and MIC, time from its end to the join accept in ms */
+#define SIM_JOIN_SIZE 10
+#define SIM_JOIN_DELAY 6000
+/** Start of the tracks of the motion profile, latitude and longitude in degree */
+#define SIM_START_LATITUDE 22.54
+#define SIM_START_LONGITUDE 114.06
+/** Meters per degree latitude */
+#define SIM_M_PER_DEGREE 111320.0
+
+/** Measured runtime of the battery test until the battery protection switched to 1 h */
+#define SIM_REFERENCE_HOURS 141.48
+
+/** Region names, same order as LoRaMacRegion_t */
+static const char *sim_regions[] = {"AS923", "AU915", "CN470", "CN779", "EU433", "EU868", "KR920",
+									"IN865", "US915", "AS923-2", "AS923-3", "AS923-4", "RU864"};
+
+/** Simulation settings */
+struct sim_config_s
+{
+	/** Send interval in s */
+	uint32_t interval = 120;
+	/** Interval table like AT+ADAPT, NULL = fixed interval */
+	const char *adapt = NULL;
+	/** Maximum age of a cached location in minutes like AT+CACHE, 0 = off */
+	uint16_t cache = 0;
+	/** Time to first fix in s, cold start and with ephemeris */
+	uint32_t ttff = 30;
+	uint32_t ttff_hot = 2;
+	/** Time in minutes the GNSS module keeps the ephemeris after a fix, 0 = power is cut */
+	uint32_t hot_time = 0;
+	/** Searches that find a location in % */
+	uint8_t fix_rate = 100;
+	/** LoRaWAN region and datarate */
+	uint8_t region = LORAMAC_REGION_EU868;
+	uint8_t data_rate = 3;
+	/** Distance filter in m and maximum time in minutes like AT+FILTER, 0 = off */
+	uint32_t filter = 0;
+	uint32_t filter_time = 0;
+	/** Compact data format, batch size and track simplification like AT+GNSS=3, AT+BATCH and AT+SIMPLIFY */
+	bool compact = false;
+	uint32_t batch = 0;
+	uint32_t simplify = 0;
+	/** Sensors */
+	bool bme = true;
+	bool acc = true;
+	/** Time between ACC interrupts in s while moving */
+	uint32_t acc_period = 10;
+	/** Battery protection like AT+BATT */
+	bool batt_check = false;
+	/** Battery capacity in mAh */
+	float capacity = 1000.0;
+	/** Empty battery voltage in V, 0 = end of the curve */
+	float cutoff = 0.0;
+	/** Longest simulated time in days */
+	uint32_t days = 3650;
+	/** CPU active time in ms per wake up of the app loop and per navigation epoch */
+	uint32_t cpu_wake = 3;
+	uint32_t cpu_epoch = 2;
+	/** Currents like AT+CURRENT, NULL = defaults */
+	const char *currents = NULL;
+	/** Discharge curve and motion profile */
+	const char *curve = "tools/battery_sim/rak12500_discharge.csv";
+	const char *profile = NULL;
+	/** Compare with the battery test */
+	bool reference = false;
+	/** Print each uplink */
+	bool log = false;
+};
+
+/** Point of the discharge curve */
+struct curve_point_s
+{
+	float dod;
+	float voltage;
+};
+
+/** Segment of the motion profile, valid from the start until the next segment */
+struct profile_segment_s
+{
+	/** Start in minutes of the day */
+	uint32_t start;
+	/** Speed in km/h and heading in degree */
+	float speed;
+	float heading;
+};
+
+static sim_config_s cfg;
+static std::vector<curve_point_s> curve;
+static std::vector<profile_segment_s> profile;
+
+/** Settings of the firmware that are not changed by the simulation */
+bool g_is_helium = false;
+bool g_is_compact = false;
+bool g_gps_prec_6 = true;
+uint8_t g_delta_interval = 0;
+uint8_t g_batch_size = 0;
+uint16_t g_simplify_tolerance = 0;
+uint32_t g_airtime_budget = 0;
+uint16_t g_airtime_window = 60;
+bool g_airtime_payload = false;
+bool g_mem_payload = false;
+bool g_submit_acc = false;
+bool battery_check_enabled = false;
+uint8_t gnss_option = RAK12500_GNSS;
+bool init_result = true;
+bool acc_ok = true;
+bool has_env_sensor = true;
+/** Helium Mapper packet, not used by the simulation */
+WisCayenne g_data_packet(255);
+
+/** GNSS model */
+static bool gnss_searching = false;
+static uint64_t gnss_fix_at = HOST_NEVER;
+static uint64_t gnss_power_on = 0;
+static uint64_t gnss_last_fix = 0;
+static bool gnss_fix_new = false;
+static bool gnss_finished = false;
+static uint16_t gnss_fix_credit = 0;
+
+/** Position of the tracker, dead reckoning of the motion profile, in degree */
+static double sim_latitude = SIM_START_LATITUDE;
+static double sim_longitude = SIM_START_LONGITUDE;
+static uint64_t sim_position_time = 0;
+
+/** LoRa model, end of the RX windows of the running uplink and of the join */
+static uint64_t lora_fin_at = HOST_NEVER;
+static uint64_t join_at = HOST_NEVER;
+
+/** ACC model, time of the next interrupt while moving */
+static uint64_t acc_next = HOST_NEVER;
+
+/** Store and forward queue model, the flash is not modeled */
+static std::deque<fq_record_s> fq_records;
+static uint32_t fq_seq = 0;
+static fq_record_s fq_inflight_fix;
+static bool fq_inflight_has_fix = false;
+static uint8_t fq_inflight_num = 0;
+
+/** Statistics */
+static uint32_t stat_wakes = 0;
+static uint32_t stat_uplinks = 0;
+static uint32_t stat_bytes = 0;
+static uint32_t stat_busy = 0;
+static uint32_t stat_fixes = 0;
+static uint32_t stat_no_fix = 0;
+static uint32_t stat_cached = 0;
+static uint32_t stat_acc = 0;
+
+/**
+ * @brief Battery voltage at a depth of discharge, linear between the curve points
+ *
+ * @param dod depth of discharge in %
+ * @return float voltage in V
+ */
+static float curve_voltage(float dod)
+{
+	if (dod <= curve.front().dod)
+	{
+		return curve.front().voltage;
+	}
+	for (size_t idx = 1; idx < curve.size(); idx++)
+	{
+		if (dod <= curve[idx].dod)
+		{
+			const curve_point_s &low = curve[idx - 1];
+			const curve_point_s &high = curve[idx];
+			return low.voltage + (high.voltage - low.voltage) * (dod - low.dod) / (high.dod - low.dod);
+		}
+	}
+	return curve.back().voltage;
+}
+
+/**
+ * @brief Read the discharge curve, lines <dod %>,<voltage V>
+ *
+ */
+static bool curve_read(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return false;
+	}
+	char line[64];
+	curve_point_s point;
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		if (sscanf(line, "%f,%f", &point.dod, &point.voltage) == 2)
+		{
+			curve.push_back(point);
+		}
+	}
+	fclose(file);
+	return curve.size() >= 2;
+}
+
+/**
+ * @brief Read the motion profile of a day, lines <HH:MM> <speed km/h> [<heading degree>].
+ *        The profile is repeated every day, before the first segment the last one is used.
+ *
+ */
+static bool profile_read(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return false;
+	}
+	char line[128];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		unsigned hour;
+		unsigned minute;
+		profile_segment_s segment = {0, 0.0, 0.0};
+		if ((line[0] == '#') || (sscanf(line, "%u:%u %f %f", &hour, &minute, &segment.speed, &segment.heading) < 3))
+		{
+			continue;
+		}
+		if ((hour > 23) || (minute > 59) || (!profile.empty() && (hour * 60 + minute <= profile.back().start)))
+		{
+			fprintf(stderr, "Profile: wrong or unsorted time %s", line);
+			fclose(file);
+			return false;
+		}
+		segment.start = hour * 60 + minute;
+		profile.push_back(segment);
+	}
+	fclose(file);
+	return true;
+}
+
+/**
+ * @brief Get the motion profile segment at a time
+ *
+ * @param time time in ms
+ * @return const profile_segment_s* segment, NULL if the tracker does not move at all
+ */
+static const profile_segment_s *profile_at(uint64_t time)
+{
+	if (profile.empty())
+	{
+		return NULL;
+	}
+	uint32_t minute = (uint32_t)((time / 60000) % (24 * 60));
+	const profile_segment_s *segment = &profile.back();
+	for (const profile_segment_s &entry : profile)
+	{
+		if (entry.start <= minute)
+		{
+			segment = &entry;
+		}
+	}
+	return segment;
+}
+
+/**
+ * @brief Get the start of the next motion profile segment
+ *
+ * @param time time in ms
+ * @return uint64_t start of the next segment in ms, HOST_NEVER if the tracker does not move at all
+ */
+static uint64_t profile_change(uint64_t time)
+{
+	if (profile.empty())
+	{
+		return HOST_NEVER;
+	}
+	uint64_t day = time - time % (24 * 3600000ULL);
+	uint32_t minute = (uint32_t)((time / 60000) % (24 * 60));
+	for (const profile_segment_s &entry : profile)
+	{
+		if (entry.start > minute)
+		{
+			return day + entry.start * 60000ULL;
+		}
+	}
+	return day + 24 * 3600000ULL + profile.front().start * 60000ULL;
+}
+
+/**
+ * @brief Move the tracker with the speed and heading of the motion profile up to the current time
+ *
+ */
+static void sim_move(void)
+{
+	while (sim_position_time < host_time())
+	{
+		uint64_t step_end = profile_change(sim_position_time);
+		step_end = step_end < host_time() ? step_end : host_time();
+		const profile_segment_s *segment = profile_at(sim_position_time);
+		if ((segment != NULL) && (segment->speed > 0.0))
+		{
+			double distance = segment->speed / 3.6 * (step_end - sim_position_time) / 1000.0;
+			double heading = segment->heading * M_PI / 180.0;
+			sim_latitude += distance * cos(heading) / SIM_M_PER_DEGREE;
+			sim_longitude += distance * sin(heading) / (SIM_M_PER_DEGREE * cos(sim_latitude * M_PI / 180.0));
+			// Keep the track away from the poles and inside the longitude range
+			sim_latitude = sim_latitude > 85.0 ? 85.0 : (sim_latitude < -85.0 ? -85.0 : sim_latitude);
+			sim_longitude = sim_longitude > 180.0 ? sim_longitude - 360.0 : (sim_longitude < -180.0 ? sim_longitude + 360.0 : sim_longitude);
+		}
+		sim_position_time = step_end;
+	}
+}
+
+/**
+ * @brief Battery voltage from the discharge curve and the consumption
+ *
+ * @return float voltage in mV
+ */
+float read_batt(void)
+{
+	return curve_voltage(energy_consumed() * 100.0 / cfg.capacity) * 1000.0;
+}
+
+/**
+ * @brief Start a location search, the GNSS module is powered until the fix or the timeout
+ *
+ */
+void gnss_start_search(void)
+{
+	if (gnss_searching)
+	{
+		return;
+	}
+	gnss_searching = true;
+	sched_arm(SCHED_GNSS, sched_now() + gnss_search_time());
+
+	energy_on(ENERGY_GNSS);
+	gnss_power_on = host_time();
+	bool hot = (cfg.hot_time != 0) && (gnss_last_fix != 0) && ((host_time() - gnss_last_fix) < (uint64_t)cfg.hot_time * 60000);
+
+	// Spread the searches without a location evenly
+	gnss_fix_credit += cfg.fix_rate;
+	if (gnss_fix_credit >= 100)
+	{
+		gnss_fix_credit -= 100;
+		gnss_fix_at = host_time() + SIM_GNSS_BOOT + (hot ? cfg.ttff_hot : cfg.ttff) * 1000;
+	}
+	else
+	{
+		gnss_fix_at = HOST_NEVER;
+	}
+}
+
+/**
+ * @brief Location search finished, the GNSS task powers the module down and wakes the app loop
+ *
+ * @param found true if a location was found
+ */
+static void gnss_finish(bool found)
+{
+	energy_off(ENERGY_GNSS);
+	host_cpu((uint32_t)((host_time() - gnss_power_on) / SIM_GNSS_EPOCH) * cfg.cpu_epoch);
+	gnss_searching = false;
+	gnss_finished = true;
+	gnss_fix_at = HOST_NEVER;
+	if (found)
+	{
+		gnss_fix_new = true;
+		gnss_last_fix = host_time();
+		stat_fixes++;
+	}
+	else
+	{
+		stat_no_fix++;
+	}
+	app_wake(GNSS_FIN);
+}
+
+/**
+ * @brief Stop the location search, called by the scheduler
+ *
+ */
+void gnss_search_timeout(void)
+{
+	if (gnss_searching)
+	{
+		gnss_finish(false);
+	}
+}
+
+/**
+ * @brief Location search finished, the timeout is not needed anymore
+ *
+ */
+void gnss_search_done(void)
+{
+	if (!gnss_searching)
+	{
+		sched_cancel(SCHED_GNSS);
+	}
+}
+
+/**
+ * @brief Take the location of the search, the position, speed and heading are from the motion profile
+ *
+ */
+bool gnss_take_fix(tracker_data_s *data)
+{
+	if (!gnss_fix_new)
+	{
+		return false;
+	}
+	gnss_fix_new = false;
+	sim_move();
+	const profile_segment_s *segment = profile_at(host_time());
+	data->latitude = (int32_t)lround(sim_latitude * 10000000);
+	data->longitude = (int32_t)lround(sim_longitude * 10000000);
+	data->altitude = 0;
+	data->fix_time = (uint32_t)(host_time() / 1000);
+	data->speed = segment != NULL ? segment->speed : 0.0;
+	data->heading = segment != NULL ? segment->heading : 0.0;
+	data->valid |= (1 << PAYLOAD_LOCATION);
+	gnss_cache_fix(data->latitude, data->longitude, data->altitude, data->fix_time);
+	return true;
+}
+
+/**
+ * @brief Start the BME680 conversion, the values are read by the scheduler
+ *
+ */
+bool start_bme(void)
+{
+	energy_add(ENERGY_BME, SIM_BME_HEATER);
+	sched_arm(SCHED_BME, sched_now() + SIM_BME_TIME);
+	return true;
+}
+
+/**
+ * @brief Read the BME680 values, called by the scheduler
+ *
+ */
+bool read_bme(void)
+{
+	g_tracker_data.valid |= 1 << PAYLOAD_ENV;
+	return true;
+}
+
+/**
+ * @brief Read the acceleration, the values are only sent with AT+SENDACC
+ *
+ */
+void read_acc(void)
+{
+	if (g_submit_acc)
+	{
+		g_tracker_data.valid |= 1 << PAYLOAD_ACC;
+	}
+}
+
+/**
+ * @brief Send an uplink, busy until the end of the RX windows of the last uplink
+ *
+ */
+lmh_error_status send_lora_packet(uint8_t *data, uint8_t size, uint8_t fport)
+{
+	(void)data;
+	(void)fport;
+	if (lora_fin_at != HOST_NEVER)
+	{
+		stat_busy++;
+		return LMH_BUSY;
+	}
+	lora_fin_at = host_time() + airtime_toa(size) + SIM_RX2_DELAY;
+	stat_uplinks++;
+	stat_bytes += size;
+	if (cfg.log)
+	{
+		printf("%9.3f h uplink %d bytes, %ld ms, %.3f V\n", host_time() / 3600000.0, size, (long)airtime_toa(size), read_batt() / 1000.0);
+	}
+	return LMH_SUCCESS;
+}
+
+/**
+ * @brief LoRa P2P is not simulated
+ *
+ */
+bool send_p2p_packet(uint8_t *data, uint8_t size)
+{
+	(void)data;
+	(void)size;
+	return false;
+}
+
+/**
+ * @brief Add a location to the queue
+ *
+ */
+void fq_push(int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	fq_record_s record = {fq_seq++, latitude, longitude, altitude};
+	fq_records.push_back(record);
+}
+
+/**
+ * @brief Get the oldest records of the queue
+ *
+ */
+uint8_t fq_peek(fq_record_s *records, uint8_t max_num)
+{
+	uint8_t num = 0;
+	while ((num < max_num) && (num < fq_records.size()))
+	{
+		records[num] = fq_records[num];
+		num++;
+	}
+	return num;
+}
+
+/**
+ * @brief Number of queued records
+ *
+ */
+uint16_t fq_depth(void)
+{
+	return (uint16_t)fq_records.size();
+}
+
+/**
+ * @brief Remember what was sent with the last uplink
+ *
+ */
+void fq_sending(tracker_data_s *data, uint8_t queued_num)
+{
+	fq_inflight_has_fix = (data->valid & (1 << PAYLOAD_LOCATION)) != 0;
+	fq_inflight_fix.latitude = data->latitude;
+	fq_inflight_fix.longitude = data->longitude;
+	fq_inflight_fix.altitude = data->altitude;
+	fq_inflight_num = queued_num;
+}
+
+/**
+ * @brief Release the delivered records or queue the location of a failed uplink
+ *
+ */
+void fq_tx_finished(bool success)
+{
+	if (success)
+	{
+		for (uint8_t idx = 0; (idx < fq_inflight_num) && !fq_records.empty(); idx++)
+		{
+			fq_records.pop_front();
+		}
+	}
+	else if (fq_inflight_has_fix)
+	{
+		fq_push(fq_inflight_fix.latitude, fq_inflight_fix.longitude, fq_inflight_fix.altitude);
+	}
+	fq_inflight_num = 0;
+	fq_inflight_has_fix = false;
+}
+
+/**
+ * @brief Geofences are not simulated
+ *
+ */
+uint32_t geofence_interval(uint32_t next_interval)
+{
+	return next_interval;
+}
+
+bool geofence_event(void)
+{
+	return false;
+}
+
+/**
+ * @brief Helium Mapper and memory statistics are not simulated
+ *
+ */
+bool mapper_skip(void)
+{
+	return false;
+}
+
+void mapper_sent(void)
+{
+}
+
+void mem_payload(tracker_data_s *data)
+{
+	(void)data;
+}
+
+/**
+ * @brief Event handling of the app loop, the send cycle parts of app_event_handler()
+ *        and lora_data_handler() of app.cpp without AT, BLE and the hardware checks
+ *
+ */
+static void app_loop(void)
+{
+	energy_sample();
+
+	if (app_event_take(SCHED_DUE))
+	{
+		sched_run();
+	}
+
+	if (app_event_take(STATUS))
+	{
+		sched_send_check();
+		cycle_status();
+	}
+
+	if (g_lpwan_has_joined && app_event_take(ACC_TRIGGER))
+	{
+		cycle_motion();
+	}
+
+	if (app_event_take(GNSS_FIN))
+	{
+		if (!gnss_finished)
+		{
+			// Cached location, the search was not started
+			stat_cached++;
+		}
+		gnss_finished = false;
+		cycle_location();
+	}
+
+	if (app_event_take(LORA_JOIN_FIN))
+	{
+		g_lpwan_has_joined = true;
+		cycle_start();
+	}
+
+	if (app_event_take(LORA_TX_FIN))
+	{
+		cycle_tx_finished(g_rx_fin_result);
+	}
+}
+
+/**
+ * @brief Parse the interval table like AT+ADAPT, <parked>,<speed>:<interval>[,...]
+ *
+ */
+static bool parse_adapt(const char *str)
+{
+	char *end;
+	g_adapt_settings.parked = (uint32_t)strtoul(str, &end, 0);
+	g_adapt_settings.steps_num = 0;
+	while ((*end == ',') && (g_adapt_settings.steps_num < ADAPT_MAX_STEPS))
+	{
+		adapt_step_s &step = g_adapt_settings.steps[g_adapt_settings.steps_num++];
+		step.speed = (uint16_t)strtoul(end + 1, &end, 0);
+		if (*end != ':')
+		{
+			return false;
+		}
+		step.interval = (uint32_t)strtoul(end + 1, &end, 0);
+		if (step.interval < 10)
+		{
+			return false;
+		}
+	}
+	return (*end == 0) && (g_adapt_settings.steps_num != 0);
+}
+
+/**
+ * @brief Parse the currents like AT+CURRENT, 7 values in uA
+ *
+ */
+static bool parse_currents(const char *str)
+{
+	const char *param = str;
+	for (uint8_t state = 0; state < ENERGY_NUM_STATES; state++)
+	{
+		char *end;
+		g_energy_current[state] = (uint32_t)strtoul(param, &end, 0);
+		if ((end == param) || (*end != (state + 1 < ENERGY_NUM_STATES ? ',' : 0)))
+		{
+			return false;
+		}
+		param = end + 1;
+	}
+	return true;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options]\n"
+		   "  --interval <s>        send interval, default 120\n"
+		   "  --adapt <table>       interval table like AT+ADAPT, <parked>,<speed>:<interval>[,...]\n"
+		   "  --cache <min>         maximum age of a cached location like AT+CACHE, default 0 (off)\n"
+		   "  --ttff <s>            time to first fix of a cold start, default 30\n"
+		   "  --ttff-hot <s>        time to first fix with ephemeris, default 2\n"
+		   "  --hot-time <min>      time the GNSS module keeps the ephemeris, default 0 (power is cut)\n"
+		   "  --fix-rate <%%>        searches that find a location, default 100\n"
+		   "  --region <name>       LoRaWAN region, default EU868\n"
+		   "  --dr <dr>             datarate, default 3\n"
+		   "  --filter <m>[,<min>]  distance filter like AT+FILTER, default 0 (off)\n"
+		   "  --compact             compact data format like AT+GNSS=3, default Cayenne LPP\n"
+		   "  --batch <n>           locations in a batch frame like AT+BATCH (compact format), default 0 (off)\n"
+		   "  --simplify <m>        track simplification of the batch like AT+SIMPLIFY, default 0 (off)\n"
+		   "  --no-bme, --no-acc    sensor not installed\n"
+		   "  --acc-period <s>      time between ACC interrupts while moving, default 10\n"
+		   "  --batt-check          battery protection like AT+BATT=1\n"
+		   "  --capacity <mAh>      battery capacity, default 1000\n"
+		   "  --cutoff <V>          empty battery voltage, default end of the discharge curve\n"
+		   "  --currents <uA,...>   currents like AT+CURRENT, sleep,CPU,GNSS,TX,RX,BME,ACC\n"
+		   "  --cpu-wake <ms>       CPU active time per wake up of the app loop, default 3\n"
+		   "  --cpu-epoch <ms>      CPU active time per GNSS navigation epoch, default 2\n"
+		   "  --days <days>         longest simulated time, default 3650\n"
+		   "  --curve <file>        discharge curve, default tools/battery_sim/rak12500_discharge.csv\n"
+		   "  --profile <file>      motion profile of a day, lines <HH:MM> <speed km/h> [<heading>]\n"
+		   "  --reference           settings of the battery test, compare with the measured runtime\n"
+		   "  --log                 print each uplink\n",
+		   name);
+}
+
+/**
+ * @brief Parse the command line
+ *
+ */
+static bool parse_args(int argc, char **argv)
+{
+	for (int idx = 1; idx < argc; idx++)
+	{
+		std::string arg = argv[idx];
+		const char *value = (idx + 1 < argc) ? argv[idx + 1] : NULL;
+		bool used = true;
+		if (arg == "--no-bme")
+		{
+			cfg.bme = false;
+			used = false;
+		}
+		else if (arg == "--no-acc")
+		{
+			cfg.acc = false;
+			used = false;
+		}
+		else if (arg == "--batt-check")
+		{
+			cfg.batt_check = true;
+			used = false;
+		}
+		else if (arg == "--reference")
+		{
+			// RAK4631, RAK12500, RAK1906, 1000 mAh, 2 minutes, AS923-3
+			cfg.reference = true;
+			cfg.interval = 120;
+			cfg.region = LORAMAC_REGION_AS923_3;
+			cfg.capacity = 1000.0;
+			cfg.bme = true;
+			cfg.acc = false;
+			used = false;
+		}
+		else if (arg == "--log")
+		{
+			cfg.log = true;
+			used = false;
+		}
+		else if (arg == "--compact")
+		{
+			cfg.compact = true;
+			used = false;
+		}
+		else if (value == NULL)
+		{
+			fprintf(stderr, "Missing value of %s\n", arg.c_str());
+			return false;
+		}
+		else if (arg == "--interval")
+		{
+			cfg.interval = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--adapt")
+		{
+			cfg.adapt = value;
+		}
+		else if (arg == "--cache")
+		{
+			cfg.cache = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--ttff")
+		{
+			cfg.ttff = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--ttff-hot")
+		{
+			cfg.ttff_hot = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--hot-time")
+		{
+			cfg.hot_time = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--fix-rate")
+		{
+			cfg.fix_rate = strtoul(value, NULL, 0) > 100 ? 100 : strtoul(value, NULL, 0);
+		}
+		else if (arg == "--region")
+		{
+			size_t region = 0;
+			while ((region < sizeof(sim_regions) / sizeof(sim_regions[0])) && (strcasecmp(value, sim_regions[region]) != 0))
+			{
+				region++;
+			}
+			if (region == sizeof(sim_regions) / sizeof(sim_regions[0]))
+			{
+				fprintf(stderr, "Unknown region %s\n", value);
+				return false;
+			}
+			cfg.region = region;
+		}
+		else if (arg == "--dr")
+		{
+			cfg.data_rate = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--filter")
+		{
+			char *end;
+			cfg.filter = strtoul(value, &end, 0);
+			cfg.filter_time = *end == ',' ? strtoul(end + 1, NULL, 0) : 0;
+		}
+		else if (arg == "--batch")
+		{
+			cfg.batch = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--simplify")
+		{
+			cfg.simplify = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--acc-period")
+		{
+			cfg.acc_period = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--capacity")
+		{
+			cfg.capacity = strtof(value, NULL);
+		}
+		else if (arg == "--cutoff")
+		{
+			cfg.cutoff = strtof(value, NULL);
+		}
+		else if (arg == "--currents")
+		{
+			cfg.currents = value;
+		}
+		else if (arg == "--cpu-wake")
+		{
+			cfg.cpu_wake = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--cpu-epoch")
+		{
+			cfg.cpu_epoch = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--days")
+		{
+			cfg.days = strtoul(value, NULL, 0);
+		}
+		else if (arg == "--curve")
+		{
+			cfg.curve = value;
+		}
+		else if (arg == "--profile")
+		{
+			cfg.profile = value;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		}
+		if (used)
+		{
+			idx++;
+		}
+	}
+	if ((cfg.interval < 10) || (cfg.acc_period == 0) || (cfg.capacity <= 0.0) || (cfg.days == 0))
+	{
+		fprintf(stderr, "Wrong interval, ACC period, capacity or days\n");
+		return false;
+	}
+	if ((cfg.filter > 10000) || (cfg.filter_time > 1440) || (cfg.batch == 1) || (cfg.batch > 32) || (cfg.simplify > 1000))
+	{
+		// Ranges of AT+FILTER, AT+BATCH and AT+SIMPLIFY
+		fprintf(stderr, "Wrong distance filter, batch size or simplification tolerance\n");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Settings and initialization, same order as in setup_app(), init_app() and the join
+ *
+ */
+static bool sim_init(void)
+{
+	g_lorawan_settings.send_repeat_time = cfg.interval * 1000;
+	g_lorawan_settings.lora_region = cfg.region;
+	g_lorawan_settings.data_rate = cfg.data_rate;
+
+	memcpy(g_energy_current, g_energy_default, sizeof(g_energy_current));
+	if ((cfg.currents != NULL) && !parse_currents(cfg.currents))
+	{
+		fprintf(stderr, "Wrong currents %s\n", cfg.currents);
+		return false;
+	}
+	if ((cfg.adapt != NULL) && !parse_adapt(cfg.adapt))
+	{
+		fprintf(stderr, "Wrong interval table %s\n", cfg.adapt);
+		return false;
+	}
+	if (!curve_read(cfg.curve))
+	{
+		fprintf(stderr, "Can not read the discharge curve %s\n", cfg.curve);
+		return false;
+	}
+	if ((cfg.profile != NULL) && !profile_read(cfg.profile))
+	{
+		fprintf(stderr, "Can not read the motion profile %s\n", cfg.profile);
+		return false;
+	}
+	if (cfg.cutoff == 0.0)
+	{
+		cfg.cutoff = curve.back().voltage;
+	}
+
+	g_cache_max_age = cfg.cache;
+	g_filter_distance = cfg.filter;
+	g_filter_time = cfg.filter_time;
+	g_is_compact = cfg.compact;
+	g_batch_size = cfg.batch;
+	g_simplify_tolerance = cfg.simplify;
+	battery_check_enabled = cfg.batt_check;
+	acc_ok = cfg.acc;
+	has_env_sensor = cfg.bme;
+	host_at_log = cfg.log;
+
+	init_energy();
+	init_sched();
+	if (cfg.acc)
+	{
+		energy_on(ENERGY_ACC);
+	}
+	init_cycle();
+
+	// Join request, the join accept arrives in the first RX window
+	energy_add(ENERGY_TX, airtime_toa(SIM_JOIN_SIZE));
+	join_at = host_time() + airtime_toa(SIM_JOIN_SIZE) + SIM_JOIN_DELAY;
+	return true;
+}
+
+/**
+ * @brief Print the settings and the result
+ *
+ */
+static void sim_result(float hours, float consumed, bool empty)
+{
+	char buffer[256];
+	printf("Interval %ld s%s%s, %s DR%d, %s", (long)cfg.interval, cfg.adapt != NULL ? ", adaptive " : "",
+		   cfg.adapt != NULL ? cfg.adapt : "", sim_regions[cfg.region], cfg.data_rate, cfg.compact ? "compact" : "Cayenne LPP");
+	if (cfg.compact && (cfg.batch != 0))
+	{
+		printf(", batch %ld, simplify %ld m", (long)cfg.batch, (long)cfg.simplify);
+	}
+	if (cfg.filter != 0)
+	{
+		printf(", filter %ld m %ld min", (long)cfg.filter, (long)cfg.filter_time);
+	}
+	printf(", BME680 %s, ACC %s, TTFF %ld s, fix rate %d %%\n", cfg.bme ? "on" : "off", cfg.acc ? "on" : "off",
+		   (long)cfg.ttff, cfg.fix_rate);
+
+	float per_day = consumed / hours * 24.0;
+	if (empty)
+	{
+		printf("Runtime %.2f days (%.1f h) until %.2f V with %.0f mAh\n", hours / 24.0, hours, cfg.cutoff, cfg.capacity);
+	}
+	else
+	{
+		// Battery not empty, the runtime is extrapolated from the consumption per day
+		printf("Runtime more than %ld days, about %.0f days with %.0f mAh\n", (long)cfg.days, cfg.capacity / per_day,
+			   cfg.capacity);
+	}
+	printf("Average %.3f mA, %.2f mAh/d\n", consumed / hours, per_day);
+	energy_status(buffer, sizeof(buffer));
+	printf("Energy %s\n", buffer);
+	pipe_status(buffer, sizeof(buffer));
+	printf("Pipeline %s\n", buffer);
+	printf("Uplinks %ld (%ld busy, %.1f bytes), fixes %ld, no fix %ld, cached %ld, ACC interrupts %ld, wake ups %ld\n",
+		   (long)stat_uplinks, (long)stat_busy, stat_uplinks != 0 ? (float)stat_bytes / stat_uplinks : 0.0, (long)stat_fixes,
+		   (long)stat_no_fix, (long)stat_cached, (long)stat_acc, (long)stat_wakes);
+	if (cfg.reference)
+	{
+		printf("Battery test %.1f h (%.3f mA), simulated %+.1f %%\n", SIM_REFERENCE_HOURS, 1000.0 / SIM_REFERENCE_HOURS,
+			   (hours / SIM_REFERENCE_HOURS - 1.0) * 100.0);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if ((argc > 1) && ((strcmp(argv[1], "--help") == 0) || (strcmp(argv[1], "-h") == 0)))
+	{
+		usage(argv[0]);
+		return 0;
+	}
+	if (!parse_args(argc, argv) || !sim_init())
+	{
+		return 1;
+	}
+
+	uint64_t start = host_time();
+	uint64_t end = start + (uint64_t)cfg.days * 24 * 3600000;
+	bool empty = false;
+	while (true)
+	{
+		// The app loop handles the events before it sleeps again
+		while (g_task_event_type != 0)
+		{
+			host_cpu(cfg.cpu_wake);
+			app_loop();
+			stat_wakes++;
+		}
+
+		float consumed = energy_consumed();
+		if ((consumed >= cfg.capacity) || (curve_voltage(consumed * 100.0 / cfg.capacity) < cfg.cutoff))
+		{
+			empty = true;
+			break;
+		}
+		if (host_time() >= end)
+		{
+			break;
+		}
+
+		// Sleep until the next timer or hardware event
+		uint64_t next = host_timer_next();
+		next = gnss_fix_at < next ? gnss_fix_at : next;
+		next = lora_fin_at < next ? lora_fin_at : next;
+		next = join_at < next ? join_at : next;
+		next = acc_next < next ? acc_next : next;
+		next = end < next ? end : next;
+		host_set_time(next);
+
+		host_timer_run();
+		if (host_time() >= gnss_fix_at)
+		{
+			gnss_finish(true);
+		}
+		if (host_time() >= lora_fin_at)
+		{
+			lora_fin_at = HOST_NEVER;
+			app_wake(LORA_TX_FIN);
+		}
+		if (host_time() >= join_at)
+		{
+			// Join accept received, the ACC interrupts are handled from now on
+			join_at = HOST_NEVER;
+			energy_add(ENERGY_RX, airtime_rx());
+			app_wake(LORA_JOIN_FIN);
+			if (cfg.acc)
+			{
+				acc_next = host_time() + cfg.acc_period * 1000;
+			}
+		}
+		if (host_time() >= acc_next)
+		{
+			acc_next += cfg.acc_period * 1000;
+			const profile_segment_s *segment = profile_at(host_time());
+			if ((segment != NULL) && (segment->speed > 0.0))
+			{
+				stat_acc++;
+				app_wake(ACC_TRIGGER);
+			}
+		}
+	}
+
+	sim_result((host_time() - start) / 3600000.0, energy_consumed(), empty);
+	return 0;
+}
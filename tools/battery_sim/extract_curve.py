@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""
+@file extract_curve.py
+@author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+@brief Extract the discharge curve of assets/RAK12500-Battery-Test.xls for the
+       battery simulator. The voltage is sampled over the depth of discharge,
+       0 % is the start of the test, 100 % is the point where the battery
+       protection of the firmware switched to the 1 hour interval (2.90 V).
+       The test used a constant 2 minutes cycle, the time is proportional to
+       the consumed charge.
+
+       Usage:  python3 tools/battery_sim/extract_curve.py [xls] > tools/battery_sim/rak12500_discharge.csv
+@version 0.1
+@date 2026-10-18
+
+@copyright Copyright (c) 2026
+"""
+import sys
+from datetime import datetime
+
+import xlrd
+
+# Voltage in V that activates the battery protection of the firmware
+PROTECTION_VOLTAGE = 2.90
+# Columns with the battery voltage, the test logged it in two channels
+VOLTAGE_COLUMNS = (5, 7)
+# Window in % of the depth of discharge for the median of a curve point
+WINDOW = 1.0
+
+
+def read_samples(path):
+    """Read (hours since start, voltage) pairs"""
+    sheet = xlrd.open_workbook(path).sheet_by_index(0)
+    samples = []
+    start = None
+    for row in range(2, sheet.nrows):
+        values = sheet.row_values(row)
+        voltage = next((values[col] for col in VOLTAGE_COLUMNS if isinstance(values[col], float)), None)
+        if voltage is None:
+            continue
+        time = datetime.strptime(values[0], "%d.%m.%Y %H:%M:%S")
+        if start is None:
+            start = time
+        samples.append(((time - start).total_seconds() / 3600.0, voltage))
+    return samples
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "assets/RAK12500-Battery-Test.xls"
+    samples = read_samples(path)
+    end = next(hours for hours, voltage in samples if voltage < PROTECTION_VOLTAGE)
+    regular = [(hours / end * 100.0, voltage) for hours, voltage in samples if hours <= end]
+
+    sys.stderr.write("%d samples, protection after %.2f h, %.2f h in total\n" % (len(samples), end, samples[-1][0]))
+    sys.stderr.write("Average current of a 1000 mAh battery %.2f mA\n" % (1000.0 / end))
+
+    print("dod_percent,voltage")
+    last = None
+    for dod in range(0, 101):
+        window = sorted(voltage for percent, voltage in regular if abs(percent - dod) <= WINDOW / 2)
+        voltage = window[len(window) // 2] if window else last
+        if dod == 100:
+            # The curve ends at the protection voltage, the median would hide the steep end
+            voltage = regular[-1][1]
+        # Measurement noise, the curve has to fall monotonically
+        if last is not None and voltage > last:
+            voltage = last
+        print("%d,%.3f" % (dod, voltage))
+        last = voltage
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,205 @@
+/**
+ * @file host.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host implementation of the Arduino, FreeRTOS and CMSIS parts used by
+ *        the scheduling code of the firmware. The time is virtual, the timers
+ *        are run by the simulator when it advances the time to their expiry.
+ *        The cycle counter only counts the modeled CPU active time, as on the
+ *        nRF52 where it stops while the CPU sleeps.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "host.h"
+#include <WisBlock-API-V2.h>
+
+/** Maximum number of timers */
+#define HOST_TIMERS 4
+
+/** Software timer */
+struct host_timer_s
+{
+	TimerCallbackFunction_t callback;
+	uint64_t expiry;
+	uint32_t period;
+	bool reload;
+	bool active;
+};
+
+/** Timers, created once and never deleted */
+static host_timer_s host_timers[HOST_TIMERS];
+static uint8_t host_timers_num = 0;
+
+/** Virtual time in ms, the simulation starts after the boot of the device */
+static uint64_t host_now = 1000;
+
+/** Core registers */
+static SCB_Type host_scb;
+static DWT_Type host_dwt;
+static CoreDebug_Type host_core_debug;
+SCB_Type *SCB = &host_scb;
+DWT_Type *DWT = &host_dwt;
+CoreDebug_Type *CoreDebug = &host_core_debug;
+
+/** WisBlock API */
+s_lorawan_settings g_lorawan_settings;
+volatile uint16_t g_task_event_type = 0;
+/** The app loop is woken up by the simulator, the semaphore only has to exist */
+static uint8_t host_sem;
+SemaphoreHandle_t g_task_sem = &host_sem;
+bool g_lpwan_has_joined = false;
+bool g_rx_fin_result = true;
+/** AT output of the firmware is printed only with --log */
+bool host_at_log = false;
+
+/**
+ * @brief Get the virtual time
+ *
+ * @return uint64_t time in ms
+ */
+uint64_t host_time(void)
+{
+	return host_now;
+}
+
+/**
+ * @brief Advance the virtual time, the time never goes back
+ *
+ * @param time time in ms
+ */
+void host_set_time(uint64_t time)
+{
+	if (time > host_now)
+	{
+		host_now = time;
+	}
+}
+
+/**
+ * @brief Get the expiry of the earliest timer
+ *
+ * @return uint64_t time in ms, HOST_NEVER if no timer is armed
+ */
+uint64_t host_timer_next(void)
+{
+	uint64_t next = HOST_NEVER;
+	for (uint8_t idx = 0; idx < host_timers_num; idx++)
+	{
+		if (host_timers[idx].active && (host_timers[idx].expiry < next))
+		{
+			next = host_timers[idx].expiry;
+		}
+	}
+	return next;
+}
+
+/**
+ * @brief Run the callbacks of the expired timers, auto reload timers are armed again
+ *
+ */
+void host_timer_run(void)
+{
+	for (uint8_t idx = 0; idx < host_timers_num; idx++)
+	{
+		if (host_timers[idx].active && (host_timers[idx].expiry <= host_now))
+		{
+			host_timers[idx].active = host_timers[idx].reload;
+			host_timers[idx].expiry += host_timers[idx].period;
+			host_timers[idx].callback(&host_timers[idx]);
+		}
+	}
+}
+
+/**
+ * @brief Count CPU active time in the cycle counter
+ *
+ * @param time time in ms
+ */
+void host_cpu(uint32_t time)
+{
+	DWT->CYCCNT += time * (SystemCoreClock / 1000);
+}
+
+uint32_t millis(void)
+{
+	// Wraps after 49.7 days like on the device
+	return (uint32_t)host_now;
+}
+
+void delay(uint32_t ms)
+{
+	// The task sleeps while it waits
+	host_now += ms;
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t reload, void *id, TimerCallbackFunction_t callback)
+{
+	(void)name;
+	(void)id;
+	if (host_timers_num == HOST_TIMERS)
+	{
+		return NULL;
+	}
+	host_timers[host_timers_num].callback = callback;
+	host_timers[host_timers_num].period = period;
+	host_timers[host_timers_num].reload = reload != pdFALSE;
+	host_timers[host_timers_num].active = false;
+	return &host_timers[host_timers_num++];
+}
+
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t reload, void *id, TimerCallbackFunction_t callback, StaticTimer_t *buffer)
+{
+	(void)buffer;
+	return xTimerCreate(name, period, reload, id, callback);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t wait)
+{
+	(void)wait;
+	timer->period = period;
+	timer->expiry = host_now + period;
+	timer->active = true;
+	return pdPASS;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t wait)
+{
+	(void)wait;
+	timer->expiry = host_now + timer->period;
+	timer->active = true;
+	return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t wait)
+{
+	(void)wait;
+	timer->active = false;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+	(void)sem;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+	(void)sem;
+	(void)woken;
+	return pdTRUE;
+}
+
+void api_timer_stop(void)
+{
+	// The periodic send is handled by the scheduler
+}
+
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t *mib_req)
+{
+	// ADR is not modeled, the datarate of the settings is used
+	mib_req->Param.ChannelsDatarate = g_lorawan_settings.data_rate;
+	return LORAMAC_STATUS_OK;
+}
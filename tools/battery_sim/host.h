@@ -0,0 +1,27 @@
+/**
+ * @file host.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Virtual time of the battery simulator. The firmware code reads the
+ *        time with millis() and arms the scheduler timer, the simulator
+ *        advances the time to the next timer or modeled hardware event.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HOST_H
+#define HOST_H
+
+#include <Arduino.h>
+
+/** No timer armed */
+#define HOST_NEVER 0xFFFFFFFFFFFFFFFFULL
+
+uint64_t host_time(void);
+void host_set_time(uint64_t time);
+uint64_t host_timer_next(void);
+void host_timer_run(void);
+void host_cpu(uint32_t time);
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file Arduino.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host replacement of the Arduino, FreeRTOS and CMSIS parts that are used
+ *        by the scheduling code of the firmware. Time is virtual and advanced
+ *        by the battery simulator, the definitions are in host.cpp.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+typedef uint8_t byte;
+
+uint32_t millis(void);
+void delay(uint32_t ms);
+
+// FreeRTOS, one tick is one ms on the host
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *SemaphoreHandle_t;
+typedef void *TaskHandle_t;
+typedef void *QueueHandle_t;
+typedef struct host_timer_s *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+typedef struct
+{
+	uint8_t unused;
+} StaticTimer_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY 0xFFFFFFFF
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+// The simulation runs in a single thread
+#define taskENTER_CRITICAL() do {} while (0)
+#define taskEXIT_CRITICAL() do {} while (0)
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t reload, void *id, TimerCallbackFunction_t callback);
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t reload, void *id, TimerCallbackFunction_t callback, StaticTimer_t *buffer);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t wait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t wait);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken);
+
+// CMSIS, the cycle counter counts the modeled CPU active time
+typedef struct
+{
+	volatile uint32_t ICSR;
+} SCB_Type;
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+extern SCB_Type *SCB;
+extern DWT_Type *DWT;
+extern CoreDebug_Type *CoreDebug;
+#define SCB_ICSR_VECTACTIVE_Msk 0x1FFUL
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL)
+#define SystemCoreClock 64000000UL
+
+#endif
@@ -0,0 +1 @@
+#include "sensors.h"
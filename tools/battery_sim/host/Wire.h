@@ -0,0 +1,11 @@
+/**
+ * @file Wire.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host replacement, the scheduling code does not use the I2C bus
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
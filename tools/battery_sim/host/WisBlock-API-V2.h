@@ -0,0 +1,110 @@
+/**
+ * @file WisBlock-API-V2.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host replacement of the WisBlock API parts that are used by the
+ *        scheduling and send cycle code of the firmware
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HOST_WISBLOCK_API_H
+#define HOST_WISBLOCK_API_H
+
+#include <Arduino.h>
+
+/** LoRaWAN regions, same order as in the SX126x-Arduino library */
+typedef enum
+{
+	LORAMAC_REGION_AS923 = 0,
+	LORAMAC_REGION_AU915,
+	LORAMAC_REGION_CN470,
+	LORAMAC_REGION_CN779,
+	LORAMAC_REGION_EU433,
+	LORAMAC_REGION_EU868,
+	LORAMAC_REGION_KR920,
+	LORAMAC_REGION_IN865,
+	LORAMAC_REGION_US915,
+	LORAMAC_REGION_AS923_2,
+	LORAMAC_REGION_AS923_3,
+	LORAMAC_REGION_AS923_4,
+	LORAMAC_REGION_RU864
+} LoRaMacRegion_t;
+
+/** Settings that are used by the scheduling code */
+struct s_lorawan_settings
+{
+	uint32_t send_repeat_time = 0;
+	uint8_t data_rate = 3;
+	bool adr_enabled = false;
+	bool confirmed_msg_enabled = false;
+	uint8_t lora_region = LORAMAC_REGION_EU868;
+	bool lorawan_enable = true;
+	uint8_t p2p_bandwidth = 0;
+	uint8_t p2p_sf = 7;
+	uint8_t p2p_cr = 1;
+	uint8_t p2p_preamble_len = 8;
+};
+extern s_lorawan_settings g_lorawan_settings;
+
+/** Events of the app loop */
+#define STATUS 0b0000000000000001
+#define BLE_CONFIG 0b0000000000000010
+#define BLE_DATA 0b0000000000000100
+#define LORA_DATA 0b0000000000001000
+#define LORA_TX_FIN 0b0000000000010000
+#define AT_CMD 0b0000000000100000
+#define LORA_JOIN_FIN 0b0000000001000000
+extern volatile uint16_t g_task_event_type;
+extern SemaphoreHandle_t g_task_sem;
+extern bool g_lpwan_has_joined;
+extern bool g_rx_fin_result;
+
+void api_timer_stop(void);
+float read_batt(void);
+
+/** LoRaWAN and LoRa P2P send, modeled by the simulator */
+typedef enum
+{
+	LMH_SUCCESS = 0,
+	LMH_BUSY = -1,
+	LMH_ERROR = -2
+} lmh_error_status;
+lmh_error_status send_lora_packet(uint8_t *data, uint8_t size, uint8_t fport = 0);
+bool send_p2p_packet(uint8_t *data, uint8_t size);
+
+/** Datarate request of the LoRaMac */
+typedef enum
+{
+	LORAMAC_STATUS_OK = 0,
+	LORAMAC_STATUS_SERVICE_UNKNOWN
+} LoRaMacStatus_t;
+typedef enum
+{
+	MIB_CHANNELS_DATARATE = 0
+} Mib_t;
+typedef union
+{
+	int8_t ChannelsDatarate;
+} MibParam_t;
+typedef struct
+{
+	Mib_t Type;
+	MibParam_t Param;
+} MibRequestConfirm_t;
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t *mib_req);
+
+/** AT output of the firmware, printed with --log */
+extern bool host_at_log;
+#define PRINTF(...) printf(__VA_ARGS__)
+#define AT_PRINTF(...)              \
+	do                              \
+	{                               \
+		if (host_at_log)            \
+		{                           \
+			printf(__VA_ARGS__);    \
+		}                           \
+	} while (0)
+
+#endif
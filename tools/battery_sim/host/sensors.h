@@ -0,0 +1,22 @@
+/**
+ * @file sensors.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host replacement of the sensor libraries. app.h only declares
+ *        objects of these classes, the simulated code does not use them.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HOST_SENSORS_H
+#define HOST_SENSORS_H
+
+#include <Arduino.h>
+
+class LIS3DH;
+class TinyGPSPlus;
+class SFE_UBLOX_GNSS;
+class Adafruit_BME680;
+
+#endif
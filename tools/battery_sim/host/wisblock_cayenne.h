@@ -0,0 +1,70 @@
+/**
+ * @file wisblock_cayenne.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host replacement of the Cayenne LPP packet of the WisBlock API.
+ *        Only the size of the packet is built, the data bytes stay 0.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HOST_WISBLOCK_CAYENNE_H
+#define HOST_WISBLOCK_CAYENNE_H
+
+#include "sensors.h"
+
+/** Data size of the locations */
+#define LPP_GPS4_SIZE 9
+#define LPP_GPS6_SIZE 11
+
+/** Channels of the tracker values */
+#define LPP_CHANNEL_GPS 10
+#define LPP_CHANNEL_BATT 1
+#define LPP_CHANNEL_HUMID 6
+#define LPP_CHANNEL_TEMP 7
+#define LPP_CHANNEL_PRESS 8
+#define LPP_CHANNEL_GAS 9
+
+/** Cayenne LPP packet, each value has 2 bytes channel and type */
+class WisCayenne
+{
+public:
+	WisCayenne(uint8_t size) : max_size(size) {}
+
+	void reset(void) { cursor = 0; }
+	uint8_t getSize(void) { return cursor; }
+	uint8_t *getBuffer(void) { return buffer; }
+
+	uint8_t addDigitalInput(uint8_t, uint32_t) { return add(1); }
+	uint8_t addAnalogInput(uint8_t, float) { return add(2); }
+	uint8_t addGenericSensor(uint8_t, float) { return add(4); }
+	uint8_t addTemperature(uint8_t, float) { return add(2); }
+	uint8_t addRelativeHumidity(uint8_t, float) { return add(1); }
+	uint8_t addAccelerometer(uint8_t, float, float, float) { return add(6); }
+	uint8_t addBarometricPressure(uint8_t, float) { return add(2); }
+	uint8_t addVoltage(uint8_t, float) { return add(2); }
+	uint8_t addGNSS_4(uint8_t, int32_t, int32_t, int32_t) { return add(LPP_GPS4_SIZE); }
+	uint8_t addGNSS_6(uint8_t, int32_t, int32_t, int32_t) { return add(LPP_GPS6_SIZE); }
+
+private:
+	/**
+	 * @brief Add a value of the data size, 0 if it does not fit
+	 *
+	 */
+	uint8_t add(uint8_t size)
+	{
+		if (cursor + 2 + size > max_size)
+		{
+			return 0;
+		}
+		cursor += 2 + size;
+		return cursor;
+	}
+
+	uint8_t buffer[255] = {0};
+	uint8_t max_size;
+	uint8_t cursor = 0;
+};
+
+#endif
@@ -0,0 +1,631 @@
+/**
+ * @file codec_test.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host round-trip test and throughput benchmark of the compact payload
+ *        format in PlatformIO/src/tracker_codec.h.
+ *
+ *        Full, sequenced and batch frames are encoded and decoded with a
+ *        randomized sweep over latitude, longitude, altitude and the sensor
+ *        values. Each decoded value has to be within the quantization step of
+ *        the format. The resync test runs the delta mode of packer.cpp against
+ *        the decoder with lost uplinks, lost ACKs and frames that are acknowledged
+ *        but never reach the decoder. The decoder has to report a missing
+ *        reference instead of a wrong location and recover on the next keyframe,
+ *        the keyframe interval has to be kept. Afterwards the encode and decode
+ *        throughput is measured.
+ *
+ *        Build:  g++ -O2 -I PlatformIO/src -o codec_test tools/codec_test.cpp
+ *        Usage:  codec_test [--count <frames>] [--seed <seed>]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "tracker_codec.h"
+
+/** Maximum error of a decoded location, half a quantization step (1/10000000 degree, mm) */
+#define MAX_LAT_ERROR 27
+#define MAX_LON_ERROR 54
+#define MAX_ALT_ERROR 500
+/** Maximum error of the sensor values in record units */
+#define MAX_BATTERY_ERROR 5
+#define MAX_ACC_ERROR 3
+/** Size of the frame buffer, a LoRaWAN payload is at most 242 bytes, batch frames are tested without limit */
+#define FRAME_BUFFER 4096
+
+static std::mt19937 rng;
+static uint32_t failures = 0;
+
+/**
+ * @brief Random integer in [low, high]
+ *
+ */
+static int32_t random_int(int32_t low, int32_t high)
+{
+	return std::uniform_int_distribution<int32_t>(low, high)(rng);
+}
+
+/**
+ * @brief Random record with all fields in the range of the format
+ *
+ */
+static tc_record_s random_record(uint8_t fields)
+{
+	tc_record_s record;
+	record.fields = fields;
+	record.latitude = random_int(-900000000, 900000000);
+	record.longitude = random_int(-1800000000, 1800000000);
+	record.altitude = random_int(-1000000, 64535000);
+	record.battery = (uint16_t)random_int(2000, 4550);
+	record.acc_x = (int16_t)random_int(-2048, 2044);
+	record.acc_y = (int16_t)random_int(-2048, 2044);
+	record.acc_z = (int16_t)random_int(-2048, 2044);
+	record.humidity = (uint8_t)random_int(0, 255);
+	record.temperature = (int16_t)random_int(-400, 1647);
+	record.pressure = (uint16_t)random_int(3000, 11191);
+	record.gas = (uint16_t)random_int(0, 65535);
+	return record;
+}
+
+/**
+ * @brief Report a failed check
+ *
+ */
+static bool check(bool condition, const char *test, uint32_t frame, const char *what)
+{
+	if (!condition)
+	{
+		if (failures < 20)
+		{
+			printf("FAIL %s frame %lu: %s\n", test, (unsigned long)frame, what);
+		}
+		failures++;
+	}
+	return condition;
+}
+
+/**
+ * @brief Compare a decoded location with the encoded one
+ *
+ */
+static void check_location(const char *test, uint32_t frame, int32_t latitude, int32_t longitude, int32_t altitude,
+						   int32_t dec_latitude, int32_t dec_longitude, int32_t dec_altitude)
+{
+	check(labs((long)latitude - dec_latitude) <= MAX_LAT_ERROR, test, frame, "latitude");
+	check(labs((long)longitude - dec_longitude) <= MAX_LON_ERROR, test, frame, "longitude");
+	check(labs((long)altitude - dec_altitude) <= MAX_ALT_ERROR, test, frame, "altitude");
+}
+
+/**
+ * @brief Compare the decoded values of a record with the encoded ones
+ *
+ */
+static void check_record(const char *test, uint32_t frame, const tc_record_s &sent, const tc_record_s &received, bool location)
+{
+	check(sent.fields == received.fields, test, frame, "fields");
+	if (location && (sent.fields & TC_FIELD_LOCATION))
+	{
+		check_location(test, frame, sent.latitude, sent.longitude, sent.altitude, received.latitude, received.longitude, received.altitude);
+	}
+	if (sent.fields & TC_FIELD_BATTERY)
+	{
+		check(abs(sent.battery - received.battery) <= MAX_BATTERY_ERROR, test, frame, "battery");
+	}
+	if (sent.fields & TC_FIELD_ACC)
+	{
+		check(abs(sent.acc_x - received.acc_x) <= MAX_ACC_ERROR, test, frame, "acc x");
+		check(abs(sent.acc_y - received.acc_y) <= MAX_ACC_ERROR, test, frame, "acc y");
+		check(abs(sent.acc_z - received.acc_z) <= MAX_ACC_ERROR, test, frame, "acc z");
+	}
+	if (sent.fields & TC_FIELD_ENV)
+	{
+		check(sent.humidity == received.humidity, test, frame, "humidity");
+		check(sent.temperature == received.temperature, test, frame, "temperature");
+		check(sent.pressure == received.pressure, test, frame, "pressure");
+		check(sent.gas == received.gas, test, frame, "gas");
+	}
+}
+
+/**
+ * @brief Full frames with random fields and queued locations
+ *
+ */
+static void test_full(uint32_t count)
+{
+	uint8_t buffer[FRAME_BUFFER];
+	for (uint32_t frame = 0; frame < count; frame++)
+	{
+		tc_record_s record = random_record((uint8_t)random_int(1, 15));
+		tc_location_s queued[TC_MAX_QUEUED];
+		uint8_t queued_num = (uint8_t)random_int(0, TC_MAX_QUEUED);
+		for (uint8_t idx = 0; idx < queued_num; idx++)
+		{
+			tc_record_s location = random_record(TC_FIELD_LOCATION);
+			queued[idx] = {location.latitude, location.longitude, location.altitude};
+		}
+		size_t size = tc_encode(record, queued, queued_num, buffer, sizeof(buffer));
+		if (!check(size == tc_frame_size(record.fields, queued_num), "full", frame, "frame size"))
+		{
+			continue;
+		}
+
+		tc_record_s decoded;
+		tc_location_s dec_queued[TC_MAX_QUEUED];
+		uint8_t dec_queued_num;
+		if (!check(tc_decode(buffer, size, decoded, dec_queued, dec_queued_num), "full", frame, "decode"))
+		{
+			continue;
+		}
+		check_record("full", frame, record, decoded, true);
+		if (check(dec_queued_num == queued_num, "full", frame, "queued number"))
+		{
+			for (uint8_t idx = 0; idx < queued_num; idx++)
+			{
+				check_location("full", frame, queued[idx].latitude, queued[idx].longitude, queued[idx].altitude,
+							   dec_queued[idx].latitude, dec_queued[idx].longitude, dec_queued[idx].altitude);
+			}
+		}
+
+		// The last byte holds at least one bit, a truncated frame is rejected
+		check(!tc_decode(buffer, size - 1, decoded, NULL, dec_queued_num), "full", frame, "truncated frame accepted");
+	}
+	printf("Full frames:      %lu round trips\n", (unsigned long)count);
+}
+
+/**
+ * @brief Next point of a random walk, mostly small steps, sometimes a jump
+ *        that does not fit into a delta
+ *
+ */
+static void random_step(int32_t &latitude, int32_t &longitude, int32_t &altitude)
+{
+	int32_t step = random_int(0, 9) == 0 ? 20000000 : (int32_t)(1 << random_int(4, 20));
+	latitude = tc_clamp(latitude + random_int(-step, step), -900000000, 900000000);
+	longitude = tc_clamp(longitude + random_int(-step, step), -1800000000, 1800000000);
+	altitude = tc_clamp(altitude + random_int(-200000, 200000), -1000000, 64535000);
+}
+
+/**
+ * @brief Sequenced frames, each frame is a delta against the previous frame
+ *        or a keyframe if the delta is too large
+ *
+ */
+static void test_sequenced(uint32_t count)
+{
+	uint8_t buffer[FRAME_BUFFER];
+	tc_decoder decoder;
+	tc_sequence_s sequence = {0, 0, {0, 0, 0}};
+	bool ref_valid = false;
+	uint32_t deltas = 0;
+	tc_record_s record = random_record(TC_FIELD_LOCATION | TC_FIELD_BATTERY);
+	for (uint32_t frame = 0; frame < count; frame++)
+	{
+		random_step(record.latitude, record.longitude, record.altitude);
+		record.fields = TC_FIELD_LOCATION | (uint8_t)(random_int(0, 7) << 1);
+		record.battery = (uint16_t)random_int(2000, 4550);
+
+		sequence.seq = (uint8_t)(frame % TC_SEQ_NUM);
+		if (!ref_valid || (tc_location_bits(&sequence, record.latitude, record.longitude, record.altitude) == TC_LOCATION_BITS))
+		{
+			sequence.ref_seq = sequence.seq;
+		}
+		size_t location_bits = tc_location_bits(&sequence, record.latitude, record.longitude, record.altitude);
+		size_t size = tc_encode(record, NULL, 0, buffer, sizeof(buffer), &sequence);
+		if (!check(size == tc_frame_size(record.fields, 0, location_bits, true), "sequenced", frame, "frame size"))
+		{
+			continue;
+		}
+		deltas += sequence.seq != sequence.ref_seq ? 1 : 0;
+
+		tc_record_s decoded;
+		uint8_t queued_num;
+		if (check(decoder.decode(buffer, size, decoded, NULL, queued_num), "sequenced", frame, "decode"))
+		{
+			check_record("sequenced", frame, record, decoded, true);
+		}
+
+		// The frame is the reference of the next frame
+		sequence.ref_seq = sequence.seq;
+		sequence.ref = tc_quantize_location(record.latitude, record.longitude, record.altitude);
+		ref_valid = true;
+	}
+	printf("Sequenced frames: %lu round trips, %lu deltas\n", (unsigned long)count, (unsigned long)deltas);
+}
+
+/** Result of an uplink in the resync test */
+enum link_result
+{
+	/** Received by the decoder, the confirmed uplink is acknowledged */
+	LINK_ACKED,
+	/** Lost, the confirmed uplink is not acknowledged */
+	LINK_LOST,
+	/** Received by the decoder, but the ACK is lost */
+	LINK_ACK_LOST,
+	/** Acknowledged by the network server, but not forwarded to the decoder */
+	LINK_DROPPED
+};
+
+/**
+ * @brief Device and server side of the delta mode, the device part does the same as
+ *        pack_compact(), pack_sent(), pack_tx_finished() and pack_acked() in packer.cpp
+ *
+ */
+struct delta_link_s
+{
+	tc_delta_encoder encoder;
+	tc_decoder decoder;
+	uint8_t interval;
+	/** Current location */
+	tc_record_s record;
+	/** Result of the last frame */
+	bool keyframe;
+	bool decoded;
+	bool missing_ref;
+
+	/**
+	 * @brief Send the current location
+	 *
+	 */
+	void send(link_result result, uint32_t frame)
+	{
+		uint8_t buffer[FRAME_BUFFER];
+		size_t location_bits = encoder.prepare(interval, record.latitude, record.longitude, record.altitude);
+		keyframe = encoder.sequence.seq == encoder.sequence.ref_seq;
+		size_t size = tc_encode(record, NULL, 0, buffer, sizeof(buffer), &encoder.sequence);
+		check(size == tc_frame_size(record.fields, 0, location_bits, true), "resync", frame, "frame size");
+
+		// Enqueued
+		encoder.sent(true, record.latitude, record.longitude, record.altitude);
+
+		decoded = false;
+		missing_ref = false;
+		if ((result == LINK_ACKED) || (result == LINK_ACK_LOST))
+		{
+			tc_record_s received;
+			uint8_t queued_num;
+			decoded = decoder.decode(buffer, size, received, NULL, queued_num);
+			missing_ref = decoder.missing_ref;
+			if (decoded)
+			{
+				// A decoded frame never has a location from a stale reference
+				check_record("resync", frame, record, received, true);
+			}
+			else
+			{
+				check(missing_ref, "resync", frame, "frame rejected without missing reference");
+			}
+		}
+
+		// TX finished of a confirmed uplink
+		if ((result == LINK_LOST) || (result == LINK_ACK_LOST))
+		{
+			encoder.lost();
+		}
+		else
+		{
+			encoder.acked();
+		}
+	}
+};
+
+/**
+ * @brief Fixed sequence of lost frames with the expected keyframes and decoder results
+ *
+ */
+static void test_resync_cases(void)
+{
+	delta_link_s link;
+	link.interval = 4;
+	link.record = random_record(TC_FIELD_LOCATION);
+	uint32_t frame = 0;
+
+	// Fill the history of the decoder with all sequence numbers
+	for (; frame < 2 * TC_SEQ_NUM; frame++)
+	{
+		random_step(link.record.latitude, link.record.longitude, link.record.altitude);
+		link.record.latitude = link.record.latitude / 4096 * 4096;
+		link.send(LINK_ACKED, frame);
+		check(link.decoded, "resync", frame, "warm up decode");
+	}
+
+	// Keyframe cadence, at most interval - 1 delta frames follow a keyframe
+	uint8_t deltas = 0;
+	for (uint32_t end = frame + 4 * link.interval; frame < end; frame++)
+	{
+		link.record.latitude += 1000;
+		link.send(LINK_ACKED, frame);
+		deltas = link.keyframe ? 0 : deltas + 1;
+		check(deltas < link.interval, "resync", frame, "keyframe interval exceeded");
+		check(link.keyframe == (link.encoder.since_key == 0), "resync", frame, "frames since keyframe");
+	}
+	// Start with a keyframe
+	while (link.encoder.since_key + 1 < link.interval)
+	{
+		link.send(LINK_ACKED, frame++);
+	}
+	link.send(LINK_ACKED, frame++);
+	check(link.keyframe && link.decoded, "resync", frame, "keyframe expected");
+
+	// Uplink lost: the decoder does not see it, the device sends a keyframe next
+	link.record.latitude += 1000;
+	link.send(LINK_ACKED, frame++);
+	check(!link.keyframe && link.decoded, "resync", frame, "delta expected");
+	link.send(LINK_LOST, frame++);
+	link.send(LINK_ACKED, frame++);
+	check(link.keyframe && link.decoded, "resync", frame, "keyframe after a lost uplink");
+
+	// ACK lost: the decoder has the frame, the device does not know it and sends a keyframe
+	link.send(LINK_ACK_LOST, frame++);
+	check(link.decoded, "resync", frame, "frame with lost ACK");
+	link.send(LINK_ACKED, frame++);
+	check(link.keyframe && link.decoded, "resync", frame, "keyframe after a lost ACK");
+
+	// Frame acknowledged but not forwarded to the decoder: the device sends deltas against it,
+	// the decoder has an entry of the same sequence number from TC_SEQ_NUM frames ago and must not use it
+	link.send(LINK_DROPPED, frame++);
+	bool recovered = false;
+	uint8_t missing = 0;
+	for (uint8_t idx = 0; (idx < link.interval) && !recovered; idx++)
+	{
+		link.record.latitude += 1000;
+		link.send(LINK_ACKED, frame++);
+		if (link.keyframe)
+		{
+			check(link.decoded, "resync", frame, "no recovery on the keyframe");
+			recovered = true;
+		}
+		else
+		{
+			check(!link.decoded && link.missing_ref, "resync", frame, "delta against a stale reference decoded");
+			missing++;
+		}
+	}
+	check(recovered && (missing != 0), "resync", frame, "missing reference and recovery");
+	link.record.latitude += 1000;
+	link.send(LINK_ACKED, frame++);
+	check(!link.keyframe && link.decoded, "resync", frame, "delta after the recovery");
+
+	// Without ACKs only keyframes are sent
+	for (uint8_t idx = 0; idx < TC_SEQ_NUM; idx++)
+	{
+		link.send(LINK_LOST, frame++);
+		check(link.keyframe || (idx == 0), "resync", frame, "keyframe without ACK");
+	}
+
+	// Keyframe interval 1 sends only keyframes
+	link.interval = 1;
+	for (uint8_t idx = 0; idx < TC_SEQ_NUM; idx++)
+	{
+		link.send(LINK_ACKED, frame++);
+		check(link.keyframe && link.decoded, "resync", frame, "keyframe interval 1");
+	}
+}
+
+/**
+ * @brief Random losses, each received frame is decoded correctly or rejected with a missing
+ *        reference, the decoder recovers on each keyframe
+ *
+ */
+static void test_resync(uint32_t count)
+{
+	test_resync_cases();
+
+	uint32_t deltas = 0;
+	uint32_t missing = 0;
+	uint32_t lost = 0;
+	for (uint8_t interval = 2; interval < TC_SEQ_NUM; interval++)
+	{
+		delta_link_s link;
+		link.interval = interval;
+		link.record = random_record(TC_FIELD_LOCATION | TC_FIELD_BATTERY);
+		uint8_t run = 0;
+		for (uint32_t frame = 0; frame < count / (TC_SEQ_NUM - 2); frame++)
+		{
+			random_step(link.record.latitude, link.record.longitude, link.record.altitude);
+			int32_t chance = random_int(0, 99);
+			link_result result = chance < 70 ? LINK_ACKED : (chance < 80 ? LINK_LOST : (chance < 90 ? LINK_ACK_LOST : LINK_DROPPED));
+			link.send(result, frame);
+
+			run = link.keyframe ? 0 : run + 1;
+			check(run < interval, "resync", frame, "keyframe interval exceeded");
+			if (link.keyframe && ((result == LINK_ACKED) || (result == LINK_ACK_LOST)))
+			{
+				check(link.decoded, "resync", frame, "no recovery on a keyframe");
+			}
+			deltas += link.keyframe ? 0 : 1;
+			missing += link.missing_ref ? 1 : 0;
+			lost += (result != LINK_ACKED) ? 1 : 0;
+		}
+	}
+	printf("Resync:           %lu frames, %lu lost, %lu deltas, %lu missing references\n", (unsigned long)count,
+		   (unsigned long)lost, (unsigned long)deltas, (unsigned long)missing);
+}
+
+/**
+ * @brief Random batch of points of a random walk
+ *
+ */
+static uint8_t random_batch(tc_point_s *points)
+{
+	uint8_t points_num = (uint8_t)random_int(1, TC_MAX_POINTS);
+	tc_record_s start = random_record(TC_FIELD_LOCATION);
+	points[0] = {(uint32_t)random_int(0, 0x7FFFFFFF), start.latitude, start.longitude, start.altitude};
+	for (uint8_t idx = 1; idx < points_num; idx++)
+	{
+		points[idx] = points[idx - 1];
+		points[idx].time += random_int(0, 3) == 0 ? random_int(64, 0xFFFF) : random_int(0, 63);
+		random_step(points[idx].latitude, points[idx].longitude, points[idx].altitude);
+	}
+	return points_num;
+}
+
+/**
+ * @brief Batch frames with up to TC_MAX_POINTS points
+ *
+ */
+static void test_batch(uint32_t count)
+{
+	uint8_t buffer[FRAME_BUFFER];
+	tc_point_s points[TC_MAX_POINTS];
+	tc_point_s dec_points[TC_MAX_POINTS];
+	uint32_t total_points = 0;
+	for (uint32_t frame = 0; frame < count; frame++)
+	{
+		tc_record_s record = random_record((uint8_t)random_int(0, 15));
+		uint8_t points_num = random_batch(points);
+		total_points += points_num;
+
+		size_t point_bits = 0;
+		for (uint8_t idx = 0; idx < points_num; idx++)
+		{
+			point_bits += tc_point_bits(idx == 0 ? NULL : &points[idx - 1], points[idx]);
+		}
+		size_t size = tc_encode_batch(record, points, points_num, buffer, sizeof(buffer));
+		if (!check(size == tc_batch_size(record.fields, point_bits), "batch", frame, "frame size"))
+		{
+			continue;
+		}
+
+		tc_record_s decoded;
+		uint8_t dec_points_num;
+		if (!check(tc_decode_batch(buffer, size, decoded, dec_points, dec_points_num), "batch", frame, "decode"))
+		{
+			continue;
+		}
+		record.fields |= TC_FIELD_LOCATION;
+		check_record("batch", frame, record, decoded, false);
+		if (!check(dec_points_num == points_num, "batch", frame, "point number"))
+		{
+			continue;
+		}
+		for (uint8_t idx = 0; idx < points_num; idx++)
+		{
+			check(dec_points[idx].time == points[idx].time, "batch", frame, "time");
+			check_location("batch", frame, points[idx].latitude, points[idx].longitude, points[idx].altitude,
+						   dec_points[idx].latitude, dec_points[idx].longitude, dec_points[idx].altitude);
+		}
+	}
+	printf("Batch frames:     %lu round trips, %lu points\n", (unsigned long)count, (unsigned long)total_points);
+}
+
+/**
+ * @brief Encode and decode throughput of full frames with all fields and of batch frames
+ *
+ */
+static void benchmark(uint32_t count)
+{
+	typedef std::chrono::steady_clock clock;
+	std::vector<tc_record_s> records;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		records.push_back(random_record(TC_FIELD_LOCATION | TC_FIELD_BATTERY | TC_FIELD_ACC | TC_FIELD_ENV));
+	}
+	std::vector<uint8_t> frames(count * 32);
+	size_t frame_size = tc_frame_size(TC_FIELD_LOCATION | TC_FIELD_BATTERY | TC_FIELD_ACC | TC_FIELD_ENV, 0);
+
+	clock::time_point start = clock::now();
+	size_t bytes = 0;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		bytes += tc_encode(records[idx], NULL, 0, &frames[idx * 32], 32);
+	}
+	double encode_s = std::chrono::duration<double>(clock::now() - start).count();
+
+	start = clock::now();
+	uint32_t decoded_num = 0;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		tc_record_s record;
+		uint8_t queued_num;
+		decoded_num += tc_decode(&frames[idx * 32], frame_size, record, NULL, queued_num) ? 1 : 0;
+	}
+	double decode_s = std::chrono::duration<double>(clock::now() - start).count();
+	check(decoded_num == count, "benchmark", 0, "decode");
+
+	printf("\nFull frame, %zu bytes (all fields):\n", frame_size);
+	printf("  encode %10.0f frames/s %8.2f MB/s\n", count / encode_s, bytes / encode_s / 1e6);
+	printf("  decode %10.0f frames/s %8.2f MB/s\n", count / decode_s, bytes / decode_s / 1e6);
+
+	// Batch frames, the delta search dominates the encoder
+	uint32_t batch_count = count / 100 + 1;
+	std::vector<std::vector<tc_point_s>> batches(batch_count);
+	uint32_t total_points = 0;
+	for (std::vector<tc_point_s> &batch : batches)
+	{
+		batch.resize(TC_MAX_POINTS);
+		batch.resize(random_batch(batch.data()));
+		total_points += batch.size();
+	}
+	std::vector<uint8_t> buffer(batch_count * FRAME_BUFFER);
+	std::vector<size_t> sizes(batch_count);
+	tc_record_s record = random_record(TC_FIELD_BATTERY);
+
+	start = clock::now();
+	bytes = 0;
+	for (uint32_t idx = 0; idx < batch_count; idx++)
+	{
+		sizes[idx] = tc_encode_batch(record, batches[idx].data(), (uint8_t)batches[idx].size(), &buffer[idx * FRAME_BUFFER], FRAME_BUFFER);
+		bytes += sizes[idx];
+	}
+	encode_s = std::chrono::duration<double>(clock::now() - start).count();
+
+	start = clock::now();
+	decoded_num = 0;
+	tc_point_s points[TC_MAX_POINTS];
+	for (uint32_t idx = 0; idx < batch_count; idx++)
+	{
+		uint8_t points_num;
+		decoded_num += tc_decode_batch(&buffer[idx * FRAME_BUFFER], sizes[idx], record, points, points_num) ? 1 : 0;
+	}
+	decode_s = std::chrono::duration<double>(clock::now() - start).count();
+	check(decoded_num == batch_count, "benchmark", 0, "batch decode");
+
+	printf("Batch frame, %.1f points, %.1f bytes average:\n", (double)total_points / batch_count, (double)bytes / batch_count);
+	printf("  encode %10.0f points/s %8.2f MB/s\n", total_points / encode_s, bytes / encode_s / 1e6);
+	printf("  decode %10.0f points/s %8.2f MB/s\n", total_points / decode_s, bytes / decode_s / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t count = 100000;
+	uint32_t seed = 1;
+	for (int idx = 1; idx + 1 < argc; idx += 2)
+	{
+		if (strcmp(argv[idx], "--count") == 0)
+		{
+			count = strtoul(argv[idx + 1], NULL, 0);
+		}
+		else if (strcmp(argv[idx], "--seed") == 0)
+		{
+			seed = strtoul(argv[idx + 1], NULL, 0);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--count <frames>] [--seed <seed>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (count == 0)
+	{
+		count = 1;
+	}
+	rng.seed(seed);
+
+	test_full(count);
+	test_sequenced(count);
+	test_resync(count);
+	test_batch(count / 100 + 1);
+	benchmark(count);
+
+	printf("\n%s, %lu failures\n", failures == 0 ? "PASSED" : "FAILED", (unsigned long)failures);
+	return failures == 0 ? 0 : 1;
+}
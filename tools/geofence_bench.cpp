@@ -0,0 +1,384 @@
+/**
+ * @file geofence_bench.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host benchmark of the geofence index in PlatformIO/src/geofence.h.
+ *
+ *        Random circles and polygons are generated for each number of fences
+ *        and packed with tools/geofence_pack.py for each grid size. The index
+ *        is loaded with gf_index and the time of query() is measured for a set
+ *        of random locations, half of them close to a fence. The reads of the
+ *        index per query are counted as well, on the device each read is a
+ *        seek and read of the file in the internal flash.
+ *        The result of each query is compared with the index with a single
+ *        grid cell, which checks all fences.
+ *
+ *        Build:  g++ -O2 -I PlatformIO/src -o geofence_bench tools/geofence_bench.cpp
+ *        Usage:  geofence_bench [--fences 10,100,1000] [--grids 1,4,16,64] [--queries <num>]
+ *                               [--seed <seed>] [--pack tools/geofence_pack.py] [--tmp /tmp]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "geofence.h"
+
+/** Center and size of the area of the fences in degree */
+#define AREA_LAT 14.5
+#define AREA_LON 121.0
+#define AREA_SIZE 0.2
+/** Radius of the fences in m */
+#define MIN_RADIUS 50
+#define MAX_RADIUS 1000
+/** Number of vertices of the polygons */
+#define MIN_VERTICES 3
+#define MAX_VERTICES 12
+/** Size of the result buffer, larger than FENCE_MAX_INSIDE of the firmware to compare complete results */
+#define MAX_INSIDE 64
+/** Meters per degree latitude */
+#define M_PER_DEGREE 111320.0
+
+static std::mt19937 rng;
+static uint32_t failures = 0;
+
+/**
+ * @brief Reads the index from a buffer and counts the reads
+ *
+ */
+class buffer_reader : public gf_reader
+{
+public:
+	buffer_reader(const std::vector<uint8_t> &data) : reads(0), bytes(0), _data(data) {}
+
+	bool read(uint32_t offset, void *buffer, size_t len)
+	{
+		reads++;
+		bytes += len;
+		if ((offset + len) > _data.size())
+		{
+			return false;
+		}
+		memcpy(buffer, &_data[offset], len);
+		return true;
+	}
+
+	uint64_t reads;
+	uint64_t bytes;
+
+private:
+	const std::vector<uint8_t> &_data;
+};
+
+/** Generated fence, center and radius in degree and m */
+struct fence_s
+{
+	double latitude;
+	double longitude;
+	double radius;
+	/** Vertices as latitude/longitude pairs, empty for a circle */
+	std::vector<double> vertices;
+	bool home;
+};
+
+/** Query location in 1/10000000 degree */
+struct location_s
+{
+	int32_t latitude;
+	int32_t longitude;
+};
+
+/**
+ * @brief Random value in [low, high)
+ *
+ */
+static double random_real(double low, double high)
+{
+	return std::uniform_real_distribution<double>(low, high)(rng);
+}
+
+/**
+ * @brief Random fences in the area, every second fence is a polygon with the
+ *        vertices on a random radius around the center
+ *
+ */
+static std::vector<fence_s> random_fences(uint32_t num)
+{
+	std::vector<fence_s> fences(num);
+	for (uint32_t idx = 0; idx < num; idx++)
+	{
+		fence_s &fence = fences[idx];
+		fence.latitude = AREA_LAT + random_real(-AREA_SIZE / 2, AREA_SIZE / 2);
+		fence.longitude = AREA_LON + random_real(-AREA_SIZE / 2, AREA_SIZE / 2);
+		fence.radius = random_real(MIN_RADIUS, MAX_RADIUS);
+		fence.home = random_real(0, 1) < 0.1;
+		if ((idx & 1) != 0)
+		{
+			int vertex_num = MIN_VERTICES + (int)random_real(0, MAX_VERTICES - MIN_VERTICES + 1);
+			double cos_lat = cos(fence.latitude * M_PI / 180.0);
+			for (int vertex = 0; vertex < vertex_num; vertex++)
+			{
+				double angle = 2 * M_PI * (vertex + random_real(0, 0.8)) / vertex_num;
+				double radius = fence.radius * random_real(0.3, 1.0) / M_PER_DEGREE;
+				fence.vertices.push_back(fence.latitude + radius * sin(angle));
+				fence.vertices.push_back(fence.longitude + radius * cos(angle) / cos_lat);
+			}
+		}
+	}
+	return fences;
+}
+
+/**
+ * @brief Random locations, half of them in the area and half of them close to a fence
+ *
+ */
+static std::vector<location_s> random_locations(const std::vector<fence_s> &fences, uint32_t num)
+{
+	std::vector<location_s> locations(num);
+	for (uint32_t idx = 0; idx < num; idx++)
+	{
+		double latitude = AREA_LAT + random_real(-AREA_SIZE * 0.6, AREA_SIZE * 0.6);
+		double longitude = AREA_LON + random_real(-AREA_SIZE * 0.6, AREA_SIZE * 0.6);
+		if ((idx & 1) != 0)
+		{
+			const fence_s &fence = fences[(size_t)random_real(0, fences.size())];
+			double radius = fence.radius * 1.5 / M_PER_DEGREE;
+			latitude = fence.latitude + random_real(-radius, radius);
+			longitude = fence.longitude + random_real(-radius, radius) / cos(fence.latitude * M_PI / 180.0);
+		}
+		locations[idx].latitude = (int32_t)lround(latitude * 10000000);
+		locations[idx].longitude = (int32_t)lround(longitude * 10000000);
+	}
+	return locations;
+}
+
+/**
+ * @brief Write the fences in the JSON format of geofence_pack.py
+ *
+ */
+static bool write_json(const std::string &path, const std::vector<fence_s> &fences)
+{
+	FILE *file = fopen(path.c_str(), "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+	fprintf(file, "{\n\"home_interval\": 60,\n\"fences\": [\n");
+	for (size_t idx = 0; idx < fences.size(); idx++)
+	{
+		const fence_s &fence = fences[idx];
+		fprintf(file, "{\"id\": %u, ", (unsigned)(idx + 1));
+		if (fence.vertices.empty())
+		{
+			fprintf(file, "\"circle\": [%.7f, %.7f, %.0f]", fence.latitude, fence.longitude, fence.radius);
+		}
+		else
+		{
+			fprintf(file, "\"polygon\": [");
+			for (size_t vertex = 0; vertex < fence.vertices.size(); vertex += 2)
+			{
+				fprintf(file, "%s[%.7f, %.7f]", vertex == 0 ? "" : ", ", fence.vertices[vertex], fence.vertices[vertex + 1]);
+			}
+			fprintf(file, "]");
+		}
+		fprintf(file, ", \"home\": %s}%s\n", fence.home ? "true" : "false", idx + 1 < fences.size() ? "," : "");
+	}
+	fprintf(file, "]\n}\n");
+	return fclose(file) == 0;
+}
+
+/**
+ * @brief Pack the fences with geofence_pack.py
+ *
+ * @return false if the script failed, e.g. too many candidates for the grid size
+ */
+static bool pack(const std::string &script, const std::string &json, const std::string &bin, uint32_t grid, std::vector<uint8_t> &index)
+{
+	std::string command = "python3 " + script + " " + json + " --grid " + std::to_string(grid) + " --bin " + bin + " > /dev/null 2>&1";
+	if (system(command.c_str()) != 0)
+	{
+		return false;
+	}
+	std::ifstream file(bin, std::ios::binary);
+	index.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !index.empty();
+}
+
+/**
+ * @brief Query all locations
+ *
+ * @param results sorted IDs of the fences of each location, appended
+ */
+static void query_all(gf_index &index, const std::vector<location_s> &locations, std::vector<std::vector<uint16_t>> &results)
+{
+	uint16_t ids[MAX_INSIDE];
+	for (const location_s &location : locations)
+	{
+		bool home;
+		uint8_t num = index.query(location.latitude, location.longitude, ids, MAX_INSIDE, &home);
+		std::sort(ids, ids + num);
+		results.push_back(std::vector<uint16_t>(ids, ids + num));
+	}
+}
+
+/**
+ * @brief Split a comma separated list of numbers
+ *
+ */
+static std::vector<uint32_t> parse_list(const char *text)
+{
+	std::vector<uint32_t> values;
+	while (*text != 0)
+	{
+		char *end;
+		values.push_back(strtoul(text, &end, 0));
+		text = *end == ',' ? end + 1 : end + strlen(end);
+	}
+	return values;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<uint32_t> fence_nums = {10, 100, 1000};
+	std::vector<uint32_t> grids = {1, 4, 16, 64};
+	uint32_t query_num = 100000;
+	uint32_t seed = 1;
+	std::string script = "tools/geofence_pack.py";
+	std::string tmp = "/tmp";
+	for (int idx = 1; idx + 1 < argc; idx += 2)
+	{
+		if (strcmp(argv[idx], "--fences") == 0)
+		{
+			fence_nums = parse_list(argv[idx + 1]);
+		}
+		else if (strcmp(argv[idx], "--grids") == 0)
+		{
+			grids = parse_list(argv[idx + 1]);
+		}
+		else if (strcmp(argv[idx], "--queries") == 0)
+		{
+			query_num = strtoul(argv[idx + 1], NULL, 0);
+		}
+		else if (strcmp(argv[idx], "--seed") == 0)
+		{
+			seed = strtoul(argv[idx + 1], NULL, 0);
+		}
+		else if (strcmp(argv[idx], "--pack") == 0)
+		{
+			script = argv[idx + 1];
+		}
+		else if (strcmp(argv[idx], "--tmp") == 0)
+		{
+			tmp = argv[idx + 1];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--fences 10,100,1000] [--grids 1,4,16,64] [--queries <num>] [--seed <seed>] [--pack <geofence_pack.py>] [--tmp <dir>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (query_num == 0)
+	{
+		query_num = 1;
+	}
+	rng.seed(seed);
+	std::string json = tmp + "/geofence_bench.json";
+	std::string bin = tmp + "/geofence_bench.bin";
+
+	printf("Fences  Grid  Index bytes  Candidates  Inside/query  Reads/query  Bytes/query  ns/query\n");
+	for (uint32_t fence_num : fence_nums)
+	{
+		if ((fence_num == 0) || (fence_num > 0xFFFF))
+		{
+			fprintf(stderr, "Number of fences %lu out of range\n", (unsigned long)fence_num);
+			return 1;
+		}
+		std::vector<fence_s> fences = random_fences(fence_num);
+		std::vector<location_s> locations = random_locations(fences, query_num);
+		if (!write_json(json, fences))
+		{
+			fprintf(stderr, "Can't write %s\n", json.c_str());
+			return 1;
+		}
+
+		// The index with a single cell checks all fences
+		std::vector<uint8_t> data;
+		std::vector<std::vector<uint16_t>> expected;
+		gf_index index;
+		buffer_reader all_reader(data);
+		if (!pack(script, json, bin, 1, data) || !index.load(&all_reader, data.size()))
+		{
+			fprintf(stderr, "Packing %lu fences with %s failed\n", (unsigned long)fence_num, script.c_str());
+			return 1;
+		}
+		query_all(index, locations, expected);
+
+		for (uint32_t grid : grids)
+		{
+			buffer_reader reader(data);
+			if (!pack(script, json, bin, grid, data) || !index.load(&reader, data.size()))
+			{
+				printf("%6lu  %4lu  skipped, too many candidates for the grid size\n", (unsigned long)fence_num, (unsigned long)grid);
+				continue;
+			}
+			const gf_header_s &header = index.header();
+			uint16_t candidates;
+			memcpy(&candidates, &data[sizeof(gf_header_s) + (size_t)header.cols * header.rows * 2], 2);
+
+			// Check the results
+			std::vector<std::vector<uint16_t>> results;
+			query_all(index, locations, results);
+			uint64_t inside = 0;
+			for (uint32_t idx = 0; idx < query_num; idx++)
+			{
+				inside += results[idx].size();
+				if (results[idx] != expected[idx])
+				{
+					if (failures < 20)
+					{
+						printf("FAIL %lu fences, grid %lu: query %lu found %lu fences instead of %lu\n", (unsigned long)fence_num,
+							   (unsigned long)grid, (unsigned long)idx, (unsigned long)results[idx].size(), (unsigned long)expected[idx].size());
+					}
+					failures++;
+				}
+			}
+
+			// Time the queries
+			uint16_t ids[MAX_INSIDE];
+			uint32_t sum = 0;
+			reader.reads = 0;
+			reader.bytes = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (const location_s &location : locations)
+			{
+				bool home;
+				sum += index.query(location.latitude, location.longitude, ids, MAX_INSIDE, &home);
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			printf("%6lu  %4u  %11lu  %10u  %12.2f  %11.1f  %11.1f  %8.1f\n", (unsigned long)fence_num, header.cols,
+				   (unsigned long)data.size(), candidates, (double)inside / query_num, (double)reader.reads / query_num,
+				   (double)reader.bytes / query_num, seconds * 1e9 / query_num);
+			if (sum != inside)
+			{
+				failures++;
+			}
+		}
+	}
+	remove(json.c_str());
+	remove(bin.c_str());
+
+	printf("\n%s, %lu failures\n", failures == 0 ? "PASSED" : "FAILED", (unsigned long)failures);
+	return failures == 0 ? 0 : 1;
+}
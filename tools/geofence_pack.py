@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Build the geofence index for the tracker and create the AT commands to upload it.
+
+The fences are read from a JSON file:
+{
+    "home_interval": 60,
+    "fences": [
+        {"id": 1, "circle": [14.4213, 121.0069, 150], "home": true},
+        {"id": 2, "polygon": [[14.42, 121.00], [14.43, 121.00], [14.43, 121.01]]}
+    ]
+}
+Circles are latitude, longitude and radius in m, polygons are a list of latitude/longitude pairs.
+home_interval is the send interval in minutes inside a home fence, 0 = unchanged.
+
+Usage:
+    geofence_pack.py fences.json [--grid 16] [--bin index.bin] [--chunk 64]
+The AT commands are written to stdout and can be sent over USB or BLE.
+"""
+
+import argparse
+import json
+import math
+import struct
+import sys
+
+GF_MAGIC = 0x31494647
+GF_TYPE_CIRCLE = 0
+GF_TYPE_POLYGON = 1
+GF_FLAG_HOME = 0x01
+
+
+def to_fixed(value):
+    return int(round(value * 10000000))
+
+
+def fence_bbox(fence):
+    """Bounding box of a fence in 1/10000000 degree: lat_min, lon_min, lat_max, lon_max"""
+    if "circle" in fence:
+        lat, lon, radius = fence["circle"]
+        d_lat = radius / 111320.0
+        d_lon = radius / (111320.0 * max(math.cos(math.radians(lat)), 0.01))
+        return (to_fixed(lat - d_lat), to_fixed(lon - d_lon), to_fixed(lat + d_lat), to_fixed(lon + d_lon))
+    lats = [to_fixed(v[0]) for v in fence["polygon"]]
+    lons = [to_fixed(v[1]) for v in fence["polygon"]]
+    return (min(lats), min(lons), max(lats), max(lons))
+
+
+def fence_record(fence):
+    flags = GF_FLAG_HOME if fence.get("home", False) else 0
+    if "circle" in fence:
+        lat, lon, radius = fence["circle"]
+        return struct.pack("<BBHiiI", GF_TYPE_CIRCLE, flags, fence["id"], to_fixed(lat), to_fixed(lon), int(radius))
+    vertices = fence["polygon"]
+    if len(vertices) < 3:
+        raise ValueError("Polygon %d needs at least 3 vertices" % fence["id"])
+    record = struct.pack("<BBHiiI", GF_TYPE_POLYGON, flags, fence["id"], len(vertices), 0, 0)
+    for lat, lon in vertices:
+        record += struct.pack("<ii", to_fixed(lat), to_fixed(lon))
+    return record
+
+
+def build_index(config, grid):
+    fences = config["fences"]
+    if not fences:
+        raise ValueError("No fences")
+    boxes = [fence_bbox(f) for f in fences]
+    lat_min = min(b[0] for b in boxes)
+    lon_min = min(b[1] for b in boxes)
+    lat_max = max(b[2] for b in boxes)
+    lon_max = max(b[3] for b in boxes)
+
+    cols = rows = max(1, min(grid, 255))
+    cell_lat = (lat_max - lat_min) // rows + 1
+    cell_lon = (lon_max - lon_min) // cols + 1
+
+    # Candidates of each cell
+    cells = [[] for _ in range(cols * rows)]
+    for num, box in enumerate(boxes):
+        row_0 = (box[0] - lat_min) // cell_lat
+        row_1 = min((box[2] - lat_min) // cell_lat, rows - 1)
+        col_0 = (box[1] - lon_min) // cell_lon
+        col_1 = min((box[3] - lon_min) // cell_lon, cols - 1)
+        for row in range(row_0, row_1 + 1):
+            for col in range(col_0, col_1 + 1):
+                cells[row * cols + col].append(num)
+
+    cell_table = []
+    candidates = []
+    for cell in cells:
+        cell_table.append(len(candidates))
+        candidates += cell
+    cell_table.append(len(candidates))
+    if len(candidates) > 0xFFFF:
+        raise ValueError("Too many candidates, use a smaller grid")
+
+    header = struct.pack("<IHBBHHiiii", GF_MAGIC, len(fences), cols, rows, config.get("home_interval", 0), 0,
+                         lat_min, lon_min, cell_lat, cell_lon)
+    body = header
+    body += struct.pack("<%dH" % len(cell_table), *cell_table)
+    body += struct.pack("<%dH" % len(candidates), *candidates)
+
+    records = [fence_record(f) for f in fences]
+    offset = len(body) + 4 * len(records)
+    offsets = []
+    for record in records:
+        offsets.append(offset)
+        offset += len(record)
+    body += struct.pack("<%dI" % len(offsets), *offsets)
+    for record in records:
+        body += record
+    return body, len(candidates)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the geofence index and the AT upload commands")
+    parser.add_argument("fences", help="JSON file with the fences")
+    parser.add_argument("--grid", type=int, default=16, help="grid cells per side (1..255)")
+    parser.add_argument("--bin", help="write the index to this file")
+    parser.add_argument("--chunk", type=int, default=64, help="bytes per AT command (1..128)")
+    args = parser.parse_args()
+
+    with open(args.fences) as json_file:
+        config = json.load(json_file)
+    index, candidates = build_index(config, args.grid)
+    sys.stderr.write("%d fences, %d candidates, %d bytes\n" % (len(config["fences"]), candidates, len(index)))
+
+    if args.bin:
+        with open(args.bin, "wb") as bin_file:
+            bin_file.write(index)
+
+    chunk = max(1, min(args.chunk, 128))
+    for offset in range(0, len(index), chunk):
+        print("AT+FENCE=%d,%s" % (offset, index[offset:offset + chunk].hex().upper()))
+    print("AT+FENCE=1")
+
+
+if __name__ == "__main__":
+    main()
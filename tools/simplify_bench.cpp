@@ -0,0 +1,242 @@
+/**
+ * @file simplify_bench.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host benchmark of the track simplification in PlatformIO/src/track_simplify.h.
+ *
+ *        The locations of a track are simplified with a set of tolerances
+ *        (AT+SIMPLIFY), the same way batch.cpp adds them to the batch. For
+ *        each tolerance the number of received and kept locations, the maximum
+ *        and mean cross track error of the received locations against the
+ *        simplified track and the time per location are printed. A maximum
+ *        error above the tolerance is reported as failure.
+ *
+ *        The track is a CSV file with the columns time (s), latitude and
+ *        longitude (degree) and altitude (m), see tools/track_sample.csv.
+ *
+ *        Build:  g++ -O2 -I PlatformIO/src -o simplify_bench tools/simplify_bench.cpp
+ *        Usage:  simplify_bench [track.csv] [--tolerances 0,5,10,20,50,100] [--batch <locations>]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "track_simplify.h"
+
+/** Meters per degree latitude */
+#define M_PER_DEGREE 111320.0
+/** Allowed error above the tolerance in m, the integer math approximates the cosine and the square root */
+#define ERROR_MARGIN 1.0
+/** Minimum number of simplified locations for the time measurement */
+#define TIMING_POINTS 1000000
+
+static uint32_t failures = 0;
+
+/**
+ * @brief Read the track
+ *
+ * @return false if the file can't be read or has no locations
+ */
+static bool read_track(const char *path, std::vector<tc_point_s> &track)
+{
+	std::ifstream file(path);
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream fields(line);
+		double time, latitude, longitude, altitude;
+		char comma[3];
+		if (!(fields >> time >> comma[0] >> latitude >> comma[1] >> longitude >> comma[2] >> altitude))
+		{
+			// Header or empty line
+			continue;
+		}
+		tc_point_s point;
+		point.time = (uint32_t)time;
+		point.latitude = (int32_t)lround(latitude * 10000000);
+		point.longitude = (int32_t)lround(longitude * 10000000);
+		point.altitude = (int32_t)lround(altitude * 1000);
+		track.push_back(point);
+	}
+	return !track.empty();
+}
+
+/**
+ * @brief Simplify the track like batch_add() and batch_simplify_flush() in batch.cpp
+ *
+ * @param batch flush after this number of kept locations, 0 = only at the end of the track
+ * @return std::vector<tc_point_s> kept locations
+ */
+static std::vector<tc_point_s> simplify(const std::vector<tc_point_s> &track, uint16_t tolerance, uint32_t batch)
+{
+	track_simplifier simplifier;
+	simplifier.set_tolerance(tolerance);
+	std::vector<tc_point_s> kept_points;
+	uint32_t batch_num = 0;
+	tc_point_s kept;
+	for (const tc_point_s &point : track)
+	{
+		if (simplifier.add(point, kept))
+		{
+			kept_points.push_back(kept);
+			batch_num++;
+		}
+		if ((batch != 0) && (batch_num >= batch))
+		{
+			if (simplifier.flush(kept))
+			{
+				kept_points.push_back(kept);
+			}
+			batch_num = 0;
+		}
+	}
+	if (simplifier.flush(kept))
+	{
+		kept_points.push_back(kept);
+	}
+	return kept_points;
+}
+
+/**
+ * @brief Distance of a location from a segment in m, equirectangular projection around the start
+ *
+ */
+static double segment_distance(const tc_point_s &start, const tc_point_s &end, const tc_point_s &point)
+{
+	double scale = cos(start.latitude / 1e7 * M_PI / 180.0);
+	double seg_x = (end.longitude - (double)start.longitude) * scale;
+	double seg_y = end.latitude - (double)start.latitude;
+	double pt_x = (point.longitude - (double)start.longitude) * scale;
+	double pt_y = point.latitude - (double)start.latitude;
+	double seg_len2 = seg_x * seg_x + seg_y * seg_y;
+	double ratio = seg_len2 == 0 ? 0 : (seg_x * pt_x + seg_y * pt_y) / seg_len2;
+	ratio = ratio < 0 ? 0 : (ratio > 1 ? 1 : ratio);
+	double d_x = pt_x - ratio * seg_x;
+	double d_y = pt_y - ratio * seg_y;
+	return sqrt(d_x * d_x + d_y * d_y) / 1e7 * M_PER_DEGREE;
+}
+
+/**
+ * @brief Cross track error of each received location against the simplified track.
+ *        The kept locations are a subset of the track in the same order, each
+ *        location is compared with the segment between the kept locations before
+ *        and after it.
+ *
+ */
+static void track_error(const std::vector<tc_point_s> &track, const std::vector<tc_point_s> &kept, double &max_error, double &mean_error)
+{
+	max_error = 0;
+	mean_error = 0;
+	size_t segment = 0;
+	for (const tc_point_s &point : track)
+	{
+		while ((segment + 1 < kept.size()) && (kept[segment].time <= point.time) && (kept[segment + 1].time < point.time))
+		{
+			segment++;
+		}
+		const tc_point_s &start = kept[segment];
+		const tc_point_s &end = segment + 1 < kept.size() ? kept[segment + 1] : kept[segment];
+		double error = segment_distance(start, end, point);
+		max_error = error > max_error ? error : max_error;
+		mean_error += error;
+	}
+	mean_error /= track.size();
+}
+
+/**
+ * @brief Split a comma separated list of numbers
+ *
+ */
+static std::vector<uint32_t> parse_list(const char *text)
+{
+	std::vector<uint32_t> values;
+	while (*text != 0)
+	{
+		char *end;
+		values.push_back(strtoul(text, &end, 0));
+		text = *end == ',' ? end + 1 : end + strlen(end);
+	}
+	return values;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = "tools/track_sample.csv";
+	std::vector<uint32_t> tolerances = {0, 5, 10, 20, 50, 100};
+	uint32_t batch = 0;
+	for (int idx = 1; idx < argc; idx++)
+	{
+		if ((strcmp(argv[idx], "--tolerances") == 0) && (idx + 1 < argc))
+		{
+			tolerances = parse_list(argv[++idx]);
+		}
+		else if ((strcmp(argv[idx], "--batch") == 0) && (idx + 1 < argc))
+		{
+			batch = strtoul(argv[++idx], NULL, 0);
+		}
+		else if (argv[idx][0] != '-')
+		{
+			path = argv[idx];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [track.csv] [--tolerances 0,5,10,20,50,100] [--batch <locations>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<tc_point_s> track;
+	if (!read_track(path, track))
+	{
+		fprintf(stderr, "Can't read a track from %s\n", path);
+		return 1;
+	}
+	printf("%s: %lu locations, %lu s\n\n", path, (unsigned long)track.size(), (unsigned long)(track.back().time - track.front().time));
+
+	printf("Tolerance m  Locations in  Kept  Kept %%  Max error m  Mean error m  ns/location\n");
+	for (uint32_t tolerance : tolerances)
+	{
+		if (tolerance > 1000)
+		{
+			// Range of AT+SIMPLIFY
+			fprintf(stderr, "Tolerance %lu m out of range\n", (unsigned long)tolerance);
+			return 1;
+		}
+		std::vector<tc_point_s> kept = simplify(track, tolerance, batch);
+		double max_error;
+		double mean_error;
+		track_error(track, kept, max_error, mean_error);
+
+		uint32_t repeat = TIMING_POINTS / track.size() + 1;
+		size_t sum = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t idx = 0; idx < repeat; idx++)
+		{
+			sum += simplify(track, tolerance, batch).size();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		printf("%11lu  %12lu  %4lu  %6.1f  %11.2f  %12.2f  %11.1f\n", (unsigned long)tolerance, (unsigned long)track.size(),
+			   (unsigned long)kept.size(), 100.0 * kept.size() / track.size(), max_error, mean_error,
+			   seconds * 1e9 / ((double)repeat * track.size()));
+		if ((max_error > tolerance + ERROR_MARGIN) || (sum != repeat * kept.size()) || (kept.back().time != track.back().time))
+		{
+			printf("FAIL tolerance %lu m\n", (unsigned long)tolerance);
+			failures++;
+		}
+	}
+
+	printf("\n%s, %lu failures\n", failures == 0 ? "PASSED" : "FAILED", (unsigned long)failures);
+	return failures == 0 ? 0 : 1;
+}
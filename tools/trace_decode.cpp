@@ -0,0 +1,264 @@
+/**
+ * @file trace_decode.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Decode the latency trace of the tracker and print the latency
+ *        histograms of the stages of the motion to uplink path.
+ *
+ *        The trace is dumped with AT+TRACE=1, the input is either the captured
+ *        log of the serial or BLE terminal (the +TRACE: lines are used) or the
+ *        binary dump.
+ *
+ *        Build:  g++ -O2 -o trace_decode tools/trace_decode.cpp
+ *        Usage:  trace_decode trace.log [--events]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/** Marker of the dump, "TRC1" */
+#define TRACE_MAGIC 0x31435254
+/** Size of the dump header and of an entry */
+#define TRACE_HEADER_SIZE 12
+#define TRACE_ENTRY_SIZE 8
+/** Maximum difference in ms between the cycle counter and the millisecond time
+ *  if the CPU did not sleep between two trace points */
+#define TRACE_SLEEP_TOLERANCE 2.0
+/** Number of histogram buckets, powers of 2 in ms */
+#define HIST_BUCKETS 20
+
+/** Trace points, same IDs as enum trace_id in app.h */
+enum trace_id
+{
+	TRACE_ACC_ISR = 1,
+	TRACE_LOOP_WAKE,
+	TRACE_GNSS_START,
+	TRACE_NAV_EPOCH,
+	TRACE_FIX,
+	TRACE_BME_DONE,
+	TRACE_LORA_SEND,
+	TRACE_LORA_TX_FIN,
+	TRACE_NUM_IDS
+};
+
+static const char *trace_names[TRACE_NUM_IDS] = {"?", "ACC_ISR", "LOOP_WAKE", "GNSS_START", "NAV_EPOCH",
+												 "FIX", "BME_DONE", "LORA_SEND", "LORA_TX_FIN"};
+
+/** Stage of the motion to uplink path, from the first trace point after the last end to the end */
+struct stage_s
+{
+	const char *name;
+	uint8_t from;
+	uint8_t to;
+};
+
+static const stage_s stages[] = {
+	{"ACC ISR -> loop wake", TRACE_ACC_ISR, TRACE_LOOP_WAKE},
+	{"GNSS start -> first epoch", TRACE_GNSS_START, TRACE_NAV_EPOCH},
+	{"First epoch -> fix", TRACE_NAV_EPOCH, TRACE_FIX},
+	{"GNSS start -> fix", TRACE_GNSS_START, TRACE_FIX},
+	{"GNSS start -> BME done", TRACE_GNSS_START, TRACE_BME_DONE},
+	{"Fix -> LoRa enqueue", TRACE_FIX, TRACE_LORA_SEND},
+	{"LoRa enqueue -> TX finished", TRACE_LORA_SEND, TRACE_LORA_TX_FIN},
+	{"Motion -> uplink enqueue", TRACE_ACC_ISR, TRACE_LORA_SEND},
+	{"Motion -> TX finished", TRACE_ACC_ISR, TRACE_LORA_TX_FIN},
+};
+
+/** Decoded trace point */
+struct entry_s
+{
+	uint32_t cycles;
+	uint32_t ms;
+	uint8_t id;
+};
+
+static uint32_t get_u32(const uint8_t *data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * @brief Read the dump, binary or the hex of the +TRACE: lines
+ *
+ */
+static bool read_dump(const char *path, std::vector<uint8_t> &dump)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	std::stringstream content;
+	content << file.rdbuf();
+	std::string text = content.str();
+
+	if ((text.size() >= 4) && (get_u32((const uint8_t *)text.data()) == TRACE_MAGIC))
+	{
+		dump.assign(text.begin(), text.end());
+		return true;
+	}
+
+	// Captured log, a new dump starts with the header line
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		size_t pos = line.find("+TRACE:");
+		if (pos == std::string::npos)
+		{
+			continue;
+		}
+		std::string hex = line.substr(pos + 7);
+		std::vector<uint8_t> bytes;
+		for (size_t idx = 0; idx + 1 < hex.size(); idx += 2)
+		{
+			if (!isxdigit((unsigned char)hex[idx]) || !isxdigit((unsigned char)hex[idx + 1]))
+			{
+				break;
+			}
+			bytes.push_back((uint8_t)strtoul(hex.substr(idx, 2).c_str(), NULL, 16));
+		}
+		if ((bytes.size() == TRACE_HEADER_SIZE) && (get_u32(bytes.data()) == TRACE_MAGIC))
+		{
+			dump.clear();
+		}
+		dump.insert(dump.end(), bytes.begin(), bytes.end());
+	}
+	return dump.size() >= TRACE_HEADER_SIZE;
+}
+
+/**
+ * @brief Time between two trace points in ms. The cycle counter is used if the
+ *        CPU did not sleep in between, otherwise the millisecond time.
+ *
+ */
+static double trace_delta(const entry_s &from, const entry_s &to, double cycles_per_ms)
+{
+	double ms = (double)((to.ms - from.ms) & 0x00FFFFFF);
+	double cycle_ms = (double)(uint32_t)(to.cycles - from.cycles) / cycles_per_ms;
+	if (fabs(cycle_ms - ms) <= TRACE_SLEEP_TOLERANCE)
+	{
+		return cycle_ms;
+	}
+	return ms;
+}
+
+/**
+ * @brief Print the latencies of a stage as a histogram with power of 2 buckets
+ *
+ */
+static void print_stage(const stage_s &stage, std::vector<double> &latencies)
+{
+	printf("\n%s: ", stage.name);
+	if (latencies.empty())
+	{
+		printf("no samples\n");
+		return;
+	}
+	std::sort(latencies.begin(), latencies.end());
+	double sum = 0;
+	for (double latency : latencies)
+	{
+		sum += latency;
+	}
+	size_t num = latencies.size();
+	printf("%zu samples, min %.3f ms, median %.3f ms, avg %.3f ms, p95 %.3f ms, max %.3f ms\n", num, latencies.front(),
+		   latencies[num / 2], sum / num, latencies[std::min(num - 1, (num * 95) / 100)], latencies.back());
+
+	size_t buckets[HIST_BUCKETS] = {0};
+	for (double latency : latencies)
+	{
+		int bucket = latency < 1.0 ? 0 : (int)log2(latency) + 1;
+		buckets[std::min(bucket, HIST_BUCKETS - 1)]++;
+	}
+	size_t max_count = *std::max_element(buckets, buckets + HIST_BUCKETS);
+	int first = 0;
+	int last = HIST_BUCKETS - 1;
+	while (buckets[first] == 0)
+	{
+		first++;
+	}
+	while (buckets[last] == 0)
+	{
+		last--;
+	}
+	for (int bucket = first; bucket <= last; bucket++)
+	{
+		double low = bucket == 0 ? 0.0 : pow(2.0, bucket - 1);
+		int bar = (int)((buckets[bucket] * 40 + max_count - 1) / max_count);
+		printf("  %8.0f .. %8.0f ms %5zu %s\n", low, pow(2.0, bucket), buckets[bucket], std::string(bar, '#').c_str());
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <trace.log|trace.bin> [--events]\n", argv[0]);
+		return 1;
+	}
+	bool list_events = (argc > 2) && (strcmp(argv[2], "--events") == 0);
+
+	std::vector<uint8_t> dump;
+	if (!read_dump(argv[1], dump) || (get_u32(dump.data()) != TRACE_MAGIC))
+	{
+		fprintf(stderr, "No trace dump found in %s\n", argv[1]);
+		return 1;
+	}
+	uint32_t cpu_hz = get_u32(&dump[4]);
+	uint32_t total = get_u32(&dump[8]);
+	double cycles_per_ms = cpu_hz / 1000.0;
+
+	std::vector<entry_s> entries;
+	for (size_t pos = TRACE_HEADER_SIZE; pos + TRACE_ENTRY_SIZE <= dump.size(); pos += TRACE_ENTRY_SIZE)
+	{
+		uint32_t ms_id = get_u32(&dump[pos + 4]);
+		entries.push_back({get_u32(&dump[pos]), ms_id & 0x00FFFFFF, (uint8_t)(ms_id >> 24)});
+	}
+	printf("%zu trace points, %lu lost, CPU %lu Hz\n", entries.size(),
+		   (unsigned long)(total > entries.size() ? total - entries.size() : 0), (unsigned long)cpu_hz);
+
+	if (list_events)
+	{
+		for (size_t idx = 0; idx < entries.size(); idx++)
+		{
+			double delta = idx == 0 ? 0.0 : trace_delta(entries[idx - 1], entries[idx], cycles_per_ms);
+			uint8_t id = entries[idx].id < TRACE_NUM_IDS ? entries[idx].id : 0;
+			printf("%10lu ms %-12s +%.3f ms\n", (unsigned long)entries[idx].ms, trace_names[id], delta);
+		}
+	}
+
+	// Each end point is paired with the first start point after the previous end point
+	for (const stage_s &stage : stages)
+	{
+		std::vector<double> latencies;
+		long start = -1;
+		for (size_t idx = 0; idx < entries.size(); idx++)
+		{
+			if ((entries[idx].id == stage.from) && (start < 0))
+			{
+				start = (long)idx;
+			}
+			else if (entries[idx].id == stage.to)
+			{
+				if (start >= 0)
+				{
+					latencies.push_back(trace_delta(entries[start], entries[idx], cycles_per_ms));
+				}
+				start = -1;
+			}
+		}
+		print_stage(stage, latencies);
+	}
+	return 0;
+}